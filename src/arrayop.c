@@ -23,6 +23,7 @@
 #include "id.h"
 #include "module.h"
 #include "init.h"
+#include "server.h"
 
 extern int binary(const char *p , const char **tab, int high);
 
@@ -369,6 +370,8 @@ Expression *BinExp::arrayOp(Scope *sc)
         }
         *pfd = fd;      // cache symbol in hash table
     }
+    if (global.params.server)
+        Server::use(sc, fd);
 
     /* Call the function fd(arguments)
      */
@@ -661,6 +661,7 @@ struct Config
 #define TARGET_PentiumPro       7
 #define TARGET_PentiumII        8
 #define TARGET_AMD64            9       (32 or 64 bit mode)
+#define TARGET_Modern          10       // out of order cores (scheduler only)
 
     short versionint;           // intermediate file version (= VERSIONINT)
     int defstructalign;         // struct alignment specified by command line
@@ -831,6 +832,8 @@ struct Config
 #define CFG4dependent        0x2000000  // dependent / non-dependent lookup
 #define CFG4wchar_is_long    0x4000000  // wchar_t is 4 bytes
 #define CFG4underscore       0x8000000  // prepend _ for C mangling
+#define CFG4regcolor         0x10000000 // assign register variables by coloring
+                                        // their live ranges (-regcolor)
 #define CFGX4           (CFG4optimized | CFG4fastfloat | CFG4fdivcall | \
                          CFG4tempinst | CFG4cacheph | CFG4notempexp | \
                          CFG4stackalign | CFG4dependent)
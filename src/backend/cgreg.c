@@ -34,13 +34,30 @@ STATIC void el_weights(int bi,elem *e,unsigned weight);
 #endif
 
 static int __cdecl weight_compare(const void *e1,const void *e2);
+static int __cdecl reg_compare(const void *e1,const void *e2);
 
 static int nretblocks;
 
 static vec_t regrange[REGMAX];
 
-static int *weights;
-#define WEIGHTS(bi,si)  weights[bi * globsym.top + si]
+/* The weight of each symbol's uses in each block, for just the blocks
+ * it is used in. The entries for a symbol are chained in increasing
+ * block order.
+ */
+
+struct Weight
+{
+    int bi;                     // block index
+    int weight;                 // of the symbol's uses in block bi
+    int next;                   // entry for the next block, -1 if none
+};
+
+static Weight *weights;         // entries for all the symbols
+static size_t weightstop;       // entries used in weights[]
+static size_t weightsmax;       // entries allocated in weights[]
+static int *weightsfirst;       // [Ssymnum] first entry for the symbol, -1 if none
+static int *weightslast;        // [Ssymnum] last entry for the symbol
+static size_t weightsnsyms;     // globsym.top when they were computed
 
 /******************************************
  */
@@ -50,10 +67,13 @@ void cgreg_init()
     if (!(config.flags4 & CFG4optimized))
         return;
 
-    // Use calloc() instead because sometimes the alloc is too large
     //printf("1weights: dfotop = %d, globsym.top = %d\n", dfotop, globsym.top);
-    weights = (int *) calloc(1,dfotop * globsym.top * sizeof(weights[0]));
-    assert(weights);
+    weightsnsyms = globsym.top;
+    weightsfirst = (int *) malloc((weightsnsyms + 1) * 2 * sizeof(int));
+    assert(weightsfirst);
+    weightslast = weightsfirst + weightsnsyms + 1;
+    memset(weightsfirst,-1,(weightsnsyms + 1) * 2 * sizeof(int));
+    weightstop = 0;
 
     nretblocks = 0;
     for (int bi = 0; bi < dfotop; bi++)
@@ -150,6 +170,12 @@ void cgreg_term()
 
         free(weights);
         weights = NULL;
+        weightstop = 0;
+        weightsmax = 0;
+        free(weightsfirst);
+        weightsfirst = NULL;
+        weightslast = NULL;
+        weightsnsyms = 0;
     }
 }
 
@@ -178,6 +204,56 @@ void cgreg_used(unsigned bi,regm_t used)
     }
 }
 
+/*************************
+ * Add weight to symbol si's weight in block bi, bi being the
+ * latest block anything has been added for.
+ */
+
+STATIC void weights_add(int bi,int si,int weight)
+{
+    assert((unsigned)si < weightsnsyms);
+    int last = weightslast[si];
+    if (last != -1 && weights[last].bi == bi)
+    {   weights[last].weight += weight;
+        return;
+    }
+    assert(last == -1 || weights[last].bi < bi);
+
+    if (weightstop == weightsmax)
+    {   // Use realloc() because sometimes the alloc is too large
+        weightsmax = weightsmax ? weightsmax * 2 : 64;
+        weights = (Weight *) realloc(weights,weightsmax * sizeof(weights[0]));
+        assert(weights);
+    }
+    Weight *w = &weights[weightstop];
+    w->bi = bi;
+    w->weight = weight;
+    w->next = -1;
+    if (last == -1)
+        weightsfirst[si] = weightstop;
+    else
+        weights[last].next = weightstop;
+    weightslast[si] = weightstop;
+    weightstop++;
+}
+
+/*************************
+ * Return the weight of a symbol in block bi. The blocks must be asked
+ * for in increasing order.
+ * Input:
+ *      *pwi    the symbol's entry in weights[] to start looking at,
+ *              updated to skip the blocks before bi
+ */
+
+STATIC int weights_get(int *pwi,int bi)
+{
+    int wi = *pwi;
+    while (wi != -1 && weights[wi].bi < bi)
+        wi = weights[wi].next;
+    *pwi = wi;
+    return (wi != -1 && weights[wi].bi == bi) ? weights[wi].weight : 0;
+}
+
 /*************************
  * Run through a tree calculating symbol weights.
  */
@@ -222,8 +298,8 @@ STATIC void el_weights(int bi,elem *e,unsigned weight)
                     {
                         s->Sweight += weight;
                         //printf("adding %d weight to '%s' (block %d, Ssymnum %d), giving Sweight %d\n",weight,s->Sident,bi,s->Ssymnum,s->Sweight);
-                        if (weights)
-                            WEIGHTS(bi,s->Ssymnum) += weight;
+                        if (weightsfirst && weight)
+                            weights_add(bi,s->Ssymnum,weight);
                     }
                     break;
             }
@@ -246,6 +322,7 @@ int cgreg_benefit(Symbol *s,int reg, Symbol *retsym)
     int bi;
     int gotoepilog;
     int retsym_cnt;
+    int wi;
 
     //printf("cgreg_benefit(s = '%s', reg = %d)\n", s->Sident, reg);
 
@@ -260,6 +337,8 @@ Lagain:
     //printf("again\n");
     benefit = 0;
     retsym_cnt = 0;
+    assert((unsigned)si < weightsnsyms);
+    wi = weightsfirst[si];
 
 #if 0 // causes assert failure in std.range(4488) from std.parallelism's unit tests
     // If s is passed in a register to the function, favor that register
@@ -288,8 +367,9 @@ Lagain:
                 goto Lcant;             // can't assign to register
         }
         if (vec_testbit(bi,s->Slvreg))
-        {   benefit += WEIGHTS(bi,si);
-            //printf("WEIGHTS(%d,%d) = %d, benefit = %d\n",bi,si,WEIGHTS(bi,si),benefit);
+        {   int weight = weights_get(&wi,bi);
+            benefit += weight;
+            //printf("weight(%d,%d) = %d, benefit = %d\n",bi,si,weight,benefit);
             inout = 1;
 
             if (s == retsym && (reg == dst_integer_reg || reg == dst_float_reg) && b->BC == BCretexp)
@@ -742,6 +822,104 @@ struct Reg              // data for trial register assignment
     int benefit;
 };
 
+/******************************************
+ * Find the register, or register pair, that gives the most benefit
+ * for putting u->sym in.
+ * Output:
+ *      u->benefit      the benefit, 0 if no register gives any
+ *      u->reglsw, u->regmsw    the register(s), if benefit is > 0
+ *      v               the blocks u->sym would be in the register for
+ */
+
+STATIC void cgreg_bestreg(Reg *u, Symbol *retsym, vec_t v)
+{
+    symbol *s = u->sym;
+
+    unsigned dst_integer_reg;
+    unsigned dst_float_reg;
+    cgreg_dst_regs(&dst_integer_reg, &dst_float_reg);
+
+    tym_t ty = s->ty();
+
+    #ifdef DEBUG
+        if (debugr)
+        {   printf("symbol '%3s', ty x%x weight x%x\n   ",
+            s->Sident,ty,s->Sweight);
+            vec_println(s->Srange);
+        }
+    #endif
+
+    // Select sequence of registers to try to map s onto
+    char *pseq;                     // sequence to try for LSW
+    char *pseqmsw = NULL;           // sequence to try for MSW, NULL if none
+    cgreg_set_priorities(ty, &pseq, &pseqmsw);
+
+    u->benefit = 0;
+    for (int i = 0; pseq[i] != NOREG; i++)
+    {
+        unsigned reg = pseq[i];
+
+        // Symbols used as return values should only be mapped into return value registers
+        if (s == retsym && !(reg == dst_integer_reg || reg == dst_float_reg))
+            continue;
+
+        // If BP isn't available, can't assign to it
+        if (reg == BP && !(allregs & mBP))
+            continue;
+
+#if 0 && TARGET_LINUX
+        // Need EBX for static pointer
+        if (reg == BX && !(allregs & mBX))
+            continue;
+#endif
+
+        if (s->Sflags & GTbyte &&
+            !(mask[reg] & BYTEREGS))
+                continue;
+
+        int benefit = cgreg_benefit(s,reg,retsym);
+
+        #ifdef DEBUG
+        if (debugr)
+        {   printf(" %s",regstring[reg]);
+            vec_print(regrange[reg]);
+            printf(" %d\n",benefit);
+        }
+        #endif
+
+        if (benefit > u->benefit)
+        {   // successful assigning of lsw
+            unsigned regmsw = NOREG;
+
+            // Now assign MSW
+            if (pseqmsw)
+            {
+                for (unsigned regj = 0; 1; regj++)
+                {
+                    regmsw = pseqmsw[regj];
+                    if (regmsw == NOREG)
+                        goto Ltried;                // tried and failed to assign MSW
+                    if (regmsw == reg)              // can't assign msw and lsw to same reg
+                        continue;
+                    #ifdef DEBUG
+                    if (debugr)
+                    {   printf(".%s",regstring[regmsw]);
+                        vec_println(regrange[regmsw]);
+                    }
+                    #endif
+                    if (vec_disjoint(s->Slvreg,regrange[regmsw]))
+                        break;
+                }
+            }
+            vec_copy(v,s->Slvreg);
+            u->benefit = benefit;
+            u->reglsw = reg;
+            u->regmsw = regmsw;
+        }
+Ltried: ;
+    }
+}
+
 int cgreg_assign(Symbol *retsym)
 {
     int flag = FALSE;                   // assume no changes
@@ -815,6 +993,13 @@ int cgreg_assign(Symbol *retsym)
     Reg t;
     t.sym = NULL;
     t.benefit = 0;
+    // With CFG4regcolor, all the symbols that would benefit
+    Reg *cands = NULL;
+    size_t ncands = 0;
+    if (config.flags4 & CFG4regcolor)
+    {   cands = (Reg *) malloc(globsym.top * sizeof(Reg) + 1);
+        assert(cands);
+    }
     for (size_t si = 0; si < globsym.top; si++)
     {   symbol *s = globsym.tab[si];
 
@@ -840,93 +1025,39 @@ int cgreg_assign(Symbol *retsym)
             continue;
         }
 
-        tym_t ty = s->ty();
-
-        #ifdef DEBUG
-            if (debugr)
-            {   printf("symbol '%3s', ty x%x weight x%x\n   ",
-                s->Sident,ty,s->Sweight);
-                vec_println(s->Srange);
-            }
-        #endif
-
-        // Select sequence of registers to try to map s onto
-        char *pseq;                     // sequence to try for LSW
-        char *pseqmsw = NULL;           // sequence to try for MSW, NULL if none
-        cgreg_set_priorities(ty, &pseq, &pseqmsw);
-
-        u.benefit = 0;
-        for (int i = 0; pseq[i] != NOREG; i++)
-        {
-            unsigned reg = pseq[i];
-
-            // Symbols used as return values should only be mapped into return value registers
-            if (s == retsym && !(reg == dst_integer_reg || reg == dst_float_reg))
-                continue;
-
-            // If BP isn't available, can't assign to it
-            if (reg == BP && !(allregs & mBP))
-                continue;
-
-#if 0 && TARGET_LINUX
-            // Need EBX for static pointer
-            if (reg == BX && !(allregs & mBX))
-                continue;
-#endif
-
-            if (s->Sflags & GTbyte &&
-                !(mask[reg] & BYTEREGS))
-                    continue;
-
-            int benefit = cgreg_benefit(s,reg,retsym);
-
-            #ifdef DEBUG
-            if (debugr)
-            {   printf(" %s",regstring[reg]);
-                vec_print(regrange[reg]);
-                printf(" %d\n",benefit);
-            }
-            #endif
-
-            if (benefit > u.benefit)
-            {   // successful assigning of lsw
-                unsigned regmsw = NOREG;
-
-                // Now assign MSW
-                if (pseqmsw)
-                {
-                    for (unsigned regj = 0; 1; regj++)
-                    {
-                        regmsw = pseqmsw[regj];
-                        if (regmsw == NOREG)
-                            goto Ltried;                // tried and failed to assign MSW
-                        if (regmsw == reg)              // can't assign msw and lsw to same reg
-                            continue;
-                        #ifdef DEBUG
-                        if (debugr)
-                        {   printf(".%s",regstring[regmsw]);
-                            vec_println(regrange[regmsw]);
-                        }
-                        #endif
-                        if (vec_disjoint(s->Slvreg,regrange[regmsw]))
-                            break;
-                    }
-                }
-                vec_copy(v,s->Slvreg);
-                u.benefit = benefit;
-                u.reglsw = reg;
-                u.regmsw = regmsw;
-            }
-Ltried:     ;
-        }
+        cgreg_bestreg(&u,retsym,v);
 
+        if (cands && u.benefit > 0)
+            cands[ncands++] = u;
         if (u.benefit > t.benefit)
         {   t = u;
             vec_copy(t.sym->Slvreg,v);
         }
     }
 
-    if (t.sym && t.benefit > 0)
+    if (cands)
+    {
+        /* Color the live ranges of all the candidates at once, most
+         * deserving first, rather than one symbol per code gen pass.
+         * Mapping a symbol adds its blocks to regrange[] for its register,
+         * so the benefit of each later candidate is figured with the
+         * earlier ones as interference.
+         */
+        qsort(cands,ncands,sizeof(Reg),reg_compare);
+        for (size_t i = 0; i < ncands; i++)
+        {   Reg u = cands[i];
+
+            cgreg_bestreg(&u,retsym,v);
+            if (u.benefit > 0)
+            {
+                vec_copy(u.sym->Slvreg,v);
+                cgreg_map(u.sym,u.regmsw,u.reglsw);
+                flag = TRUE;
+            }
+        }
+        free(cands);
+    }
+    else if (t.sym && t.benefit > 0)
     {
         cgreg_map(t.sym,t.regmsw,t.reglsw);
         flag = TRUE;
@@ -979,5 +1110,17 @@ static int __cdecl weight_compare(const void *e1,const void *e2)
     return (*psp2)->Sweight - (*psp1)->Sweight;
 }
 
+//////////////////////////////////////
+// Qsort() comparison routine for array of Reg's, most benefit first.
+
+static int __cdecl reg_compare(const void *e1,const void *e2)
+{   Reg *r1 = (Reg *)e1;
+    Reg *r2 = (Reg *)e2;
+
+    if (r1->benefit != r2->benefit)
+        return r2->benefit - r1->benefit;
+    return r1->sym->Ssymnum - r2->sym->Ssymnum;
+}
+
 
 #endif
@@ -34,6 +34,9 @@ static char __file__[] = __FILE__;      /* for tassert.h                */
 #define PRO     (config.target_cpu >= TARGET_PentiumPro)
 #endif
 
+// If we use the scheduler for out of order cores
+#define OOO     (config.target_scheduler >= TARGET_Modern)
+
 // Struct where we gather information about an instruction
 struct Cinfo
 {
@@ -75,6 +78,7 @@ struct Cinfo
 code *simpleops(code *c,regm_t scratch);
 code *schedule(code *c,regm_t scratch);
 code *peephole(code *c,regm_t scratch);
+code *schedule_ooo(code *c);
 
 /*****************************************
  * Do Pentium optimizations.
@@ -105,11 +109,15 @@ void cgsched_block(block* b)
         config.target_cpu >= TARGET_Pentium &&
         b->BC != BCasm)
     {
-        regm_t scratch = allregs;
+        if (OOO)
+            b->Bcode = schedule_ooo(b->Bcode);
+        else
+        {   regm_t scratch = allregs;
 
-        scratch &= ~(b->Bregcon.used | b->Bregcon.params | mfuncreg);
-        scratch &= ~(b->Bregcon.immed.mval | b->Bregcon.cse.mval);
-        cgsched_pentium(&b->Bcode,scratch);
+            scratch &= ~(b->Bregcon.used | b->Bregcon.params | mfuncreg);
+            scratch &= ~(b->Bregcon.immed.mval | b->Bregcon.cse.mval);
+            cgsched_pentium(&b->Bcode,scratch);
+        }
         //printf("after schedule:\n"); WRcodlst(b->Bcode);
     }
 }
@@ -1168,6 +1176,205 @@ STATIC int pair_class(code *c)
     return pc;
 }
 
+/******************************************
+ * Return mask getinfo() uses for register reg of instruction c.
+ * Input:
+ *      byte    !=0 if it's a byte register
+ *      xmm     !=0 if it's an XMM register
+ */
+
+STATIC unsigned regmask(code *c,unsigned reg,unsigned byte,int xmm)
+{
+    if (xmm)
+        // XMM4..XMM7 would collide with EA, R, N and B, so move them up
+        return reg < 4 ? mask[XMM0 + reg] : reg < 8 ? 1 << (24 + reg) : N;
+    if (byte && !c->Irex)
+        reg &= 3;                       // AH..BH are part of AX..BX
+    return mask[reg];
+}
+
+/******************************************
+ * For the out of order scheduler, determine what the 0x0F opcodes the code
+ * generator uses for integer and scalar floating point code read and write.
+ * Output:
+ *      *pr,*pw         read and write masks, as in oprw[][]
+ *      *pxmmreg        set if reg field is an XMM register
+ *      *pxmmrm         set if rm field is an XMM register
+ * Returns:
+ *      0 if it's not one of them
+ */
+
+STATIC int getinfo0F(code *c,unsigned *pr,unsigned *pw,int *pxmmreg,int *pxmmrm)
+{
+    unsigned op2 = c->Iop & 0xFF;
+    unsigned pfx = (c->Iop >> 16) & 0xFF;
+    int mod3 = (c->Irm & 0xC0) == 0xC0;
+    unsigned r,w;
+
+    if (((c->Iop >> 8) & 0xFF) != 0x0F ||
+        pfx && pfx != 0x66 && pfx != 0xF2 && pfx != 0xF3 ||
+        c->Iop & 0xFF000000 ||
+        c->Iflags & (CFvex | CFvex3))
+        return 0;
+    if (!pfx)
+    {
+        switch (op2)
+        {
+            case 0xB6:                          // MOVZX r,EA8
+            case 0xBE:                          // MOVSX r,EA8
+                r = EA|B;
+                w = R;
+                goto Lgpr;
+            case 0xB7:                          // MOVZX r,EA16
+            case 0xBF:                          // MOVSX r,EA16
+                r = EA;
+                w = R;
+                goto Lgpr;
+            case 0xAF:                          // IMUL r,EA
+                r = R|EA;
+                w = R|F;
+                goto Lgpr;
+        }
+        if ((op2 & 0xF0) == 0x40)               // CMOVcc r,EA
+        {   r = F|R|EA;
+            w = R;
+            goto Lgpr;
+        }
+        if ((op2 & 0xF0) == 0x90)               // SETcc EA8
+        {   r = F;
+            w = EA|B;
+            goto Lgpr;
+        }
+    }
+    if (pfx == 0xF2 || pfx == 0xF3)             // scalar
+    {
+        switch (op2)
+        {
+            case 0x10:                          // LODSD, LODSS
+                r = mod3 ? R|EA : EA;           // register form merges
+                w = R;
+                goto Lxmm;
+            case 0x11:                          // STOSD, STOSS
+                r = mod3 ? R|EA : R;
+                w = EA;
+                goto Lxmm;
+            case 0x51:                          // SQRT
+            case 0x58:                          // ADD
+            case 0x59:                          // MUL
+            case 0x5A:                          // CVTSD2SS, CVTSS2SD
+            case 0x5C:                          // SUB
+            case 0x5D:                          // MIN
+            case 0x5E:                          // DIV
+            case 0x5F:                          // MAX
+                r = R|EA;
+                w = R;
+                goto Lxmm;
+            case 0x2A:                          // CVTSI2SD xmm,EA
+                *pxmmreg = 1;
+                r = R|EA;
+                w = R;
+                goto Lgpr;
+            case 0x2C:                          // CVTTSD2SI r,xmm
+            case 0x2D:                          // CVTSD2SI r,xmm
+                *pxmmrm = 1;
+                r = EA;
+                w = R;
+                goto Lgpr;
+        }
+        if (pfx == 0xF3)
+        {   switch (op2)
+            {   case 0x6F:                      // LODDQU
+                case 0x7E:                      // LODQ
+                    r = EA;
+                    w = R;
+                    goto Lxmm;
+                case 0x7F:                      // STODQU
+                    r = R;
+                    w = EA;
+                    goto Lxmm;
+            }
+        }
+        return 0;
+    }
+    // Packed, no prefix or 0x66
+    switch (op2)
+    {
+        case 0x28:                              // LODAPS, LODAPD
+            r = EA;
+            w = R;
+            goto Lxmm;
+        case 0x29:                              // STOAPS, STOAPD
+            r = R;
+            w = EA;
+            goto Lxmm;
+        case 0x2E:                              // UCOMISS, UCOMISD
+        case 0x2F:                              // COMISS, COMISD
+            r = R|EA;
+            w = F;
+            goto Lxmm;
+        case 0x54:                              // AND
+        case 0x55:                              // ANDN
+        case 0x56:                              // OR
+        case 0x57:                              // XOR
+        case 0x58:                              // ADD
+        case 0x59:                              // MUL
+        case 0x5A:                              // CVTPS2PD, CVTPD2PS
+        case 0x5C:                              // SUB
+        case 0x5E:                              // DIV
+            r = R|EA;
+            w = R;
+            goto Lxmm;
+        case 0x50:                              // MOVMSKPS, MOVMSKPD r,xmm
+            *pxmmrm = 1;
+            r = EA;
+            w = R;
+            goto Lgpr;
+    }
+    if (pfx == 0x66)
+    {   switch (op2)
+        {
+            case 0x6F:                          // LODDQA
+                r = EA;
+                w = R;
+                goto Lxmm;
+            case 0x7F:                          // STODQA
+            case 0xD6:                          // STOQ
+                r = R;
+                w = EA;
+                goto Lxmm;
+            case 0x6E:                          // LODD xmm,EA
+                *pxmmreg = 1;
+                r = EA;
+                w = R;
+                goto Lgpr;
+            case 0x7E:                          // STOD EA,xmm
+                *pxmmreg = 1;
+                r = R;
+                w = EA;
+                goto Lgpr;
+            case 0xD4:                          // PADDQ
+            case 0xD5:                          // PMULLW
+            case 0xDB:                          // PAND
+            case 0xEB:                          // POR
+            case 0xEF:                          // PXOR
+            case 0xF8: case 0xF9: case 0xFA: case 0xFB:         // PSUBx
+            case 0xFC: case 0xFD: case 0xFE:                    // PADDx
+                r = R|EA;
+                w = R;
+                goto Lxmm;
+        }
+    }
+    return 0;
+
+Lxmm:
+    *pxmmreg = 1;
+    *pxmmrm = 1;
+Lgpr:
+    *pr = r;
+    *pw = w;
+    return 1;
+}
+
 /******************************************
  * For an instruction, determine what is read
  * and what is written, and what is used for addressing.
@@ -1192,10 +1399,13 @@ STATIC void getinfo(Cinfo *ci,code *c)
     unsigned char op;
     unsigned char op2;
     unsigned char irm,mod,reg,rm;
+    unsigned rexr,rexx,rexb;
     unsigned a32;
     int pc;
     unsigned r,w;
-    int sz = I32 ? 4 : 2;
+    int xmmreg = 0;                     // reg field is an XMM register
+    int xmmrm = 0;                      // rm field is an XMM register
+    int sz = I16 ? 2 : 4;
 
     ci->r = 0;
     ci->w = 0;
@@ -1204,19 +1414,39 @@ STATIC void getinfo(Cinfo *ci,code *c)
     if ((c->Iop & 0xFF00) == 0x0F00)
         op = 0x0F;
     //printf("\tgetinfo %x, op %x \n",c,op);
+    if (OOO && c->Iop > 0xFF && op != 0x0F && op != ESCAPE)
+        op = 0x0F;                      // 0x0F 0x38, 0x0F 0x3A and prefixes
     pc = pentcycl[op];
-    a32 = I32;
+    a32 = !I16;
     if (c->Iflags & CFaddrsize)
         a32 ^= 1;
     if (c->Iflags & CFopsize)
         sz ^= 2 | 4;
+    if (c->Irex & REX_W)
+        sz = 8;
     irm = c->Irm;
     mod = (irm >> 6) & 3;
     reg = (irm >> 3) & 7;
     rm = irm & 7;
+    rexr = (c->Irex & REX_R) ? 8 : 0;   // R8..R15 in 64 bit code
+    rexx = (c->Irex & REX_X) ? 8 : 0;
+    rexb = (c->Irex & REX_B) ? 8 : 0;
 
     r = oprw[op][0];
     w = oprw[op][1];
+    if (c->Irex)
+    {   // REX changes which register is in the opcode
+        unsigned x = (op & 7) | rexb;
+
+        if ((op & 0xF8) == 0x50)                // PUSH reg
+            r = mSP | mask[x];
+        else if ((op & 0xF8) == 0x58)           // POP reg
+            w = mSP | mask[x];
+        else if ((op & 0xF8) == 0x90 && x)      // XCHG EAX,reg
+            r = w = mAX | mask[x];
+        else if ((op & 0xF0) == 0xB0)           // MOV reg,imm
+            w = mask[x];
+    }
 
     switch (op)
     {
@@ -1237,7 +1467,7 @@ STATIC void getinfo(Cinfo *ci,code *c)
         case 0x06:
         case 0x9C:
         Lpush:
-            ci->spadjust = -sz;
+            ci->spadjust = I64 ? -8 : -sz;
             ci->a |= mSP;
             break;
 
@@ -1254,7 +1484,7 @@ STATIC void getinfo(Cinfo *ci,code *c)
         case 0x17:
         case 0x9D:                              // POPF
         Lpop:
-            ci->spadjust = sz;
+            ci->spadjust = I64 ? 8 : sz;
             ci->a |= mSP;
             break;
 
@@ -1322,6 +1552,22 @@ STATIC void getinfo(Cinfo *ci,code *c)
         case 0xF6:
             r = grprw[3][reg][0];               // Grp 3, byte version
             w = grprw[3][reg][1];
+            if (OOO)
+                r |= B;                         // MUL..IDIV are byte too
+            break;
+
+        case 0x84:                              // TEST EA,r8
+        case 0x86:                              // XCHG EA,r8
+        case 0xFE:                              // INC/DEC EA8
+            if (OOO)
+                r |= B;                         // oprw[] forgets they're byte
+            break;
+
+        case 0x63:
+            if (OOO && I64)                     // MOVSXD r,EA32
+            {   r = EA;
+                w = R;
+            }
             break;
 
         case 0xF7:
@@ -1337,6 +1583,11 @@ STATIC void getinfo(Cinfo *ci,code *c)
                 ci->w = N;
                 goto Lret;
             }
+            if (OOO && getinfo0F(c,&r,&w,&xmmreg,&xmmrm))
+            {   if (xmmreg || xmmrm)
+                    sz = 16;                    // largest the EA can be
+                break;
+            }
             ci->r = N;
             ci->w = N;          // copout for now
             goto Lret;
@@ -1375,6 +1626,8 @@ STATIC void getinfo(Cinfo *ci,code *c)
         case 0xC1:
             if (reg == 2 || reg == 3)           // if RCL or RCR
                 c->Iflags |= CFpsw;             // always test for flags
+            if (OOO && !(op & 1))
+                r |= B;                         // shift EA8
             break;
 
         case 0xD8:
@@ -1553,9 +1806,9 @@ STATIC void getinfo(Cinfo *ci,code *c)
     ci->r = r & ~(R | EA);
     ci->w = w & ~(R | EA);
     if (r & R)
-        ci->r |= mask[(r & B) ? (reg & 3) : reg];
+        ci->r |= regmask(c,reg | rexr,r & B,xmmreg);
     if (w & R)
-        ci->w |= mask[(w & B) ? (reg & 3) : reg];
+        ci->w |= regmask(c,reg | rexr,w & B,xmmreg);
 
     // OR in bits for EA addressing mode
     if ((r | w) & EA)
@@ -1569,13 +1822,13 @@ STATIC void getinfo(Cinfo *ci,code *c)
                 {
                     if (rm == 4)
                     {   sib = c->Isib;
-                        if ((sib & modregrm(0,7,0)) != modregrm(0,4,0))
-                            ci->a |= mask[(sib >> 3) & 7];      // index register
+                        if ((sib & modregrm(0,7,0)) != modregrm(0,4,0) || rexx)
+                            ci->a |= mask[((sib >> 3) & 7) | rexx];     // index register
                         if ((sib & 7) != 5)
-                            ci->a |= mask[sib & 7];             // base register
+                            ci->a |= mask[(sib & 7) | rexb];    // base register
                     }
                     else if (rm != 5)
-                        ci->a |= mask[rm];
+                        ci->a |= mask[rm | rexb];
                 }
                 else
                 {   static unsigned char ea16[8] = {mBX|mSI,mBX|mDI,mBP|mSI,mBP|mDI,mSI,mDI,0,mBX};
@@ -1589,12 +1842,12 @@ STATIC void getinfo(Cinfo *ci,code *c)
                 {
                     if (rm == 4)
                     {   sib = c->Isib;
-                        if ((sib & modregrm(0,7,0)) != modregrm(0,4,0))
-                            ci->a |= mask[(sib >> 3) & 7];      // index register
-                        ci->a |= mask[sib & 7];                 // base register
+                        if ((sib & modregrm(0,7,0)) != modregrm(0,4,0) || rexx)
+                            ci->a |= mask[((sib >> 3) & 7) | rexx];     // index register
+                        ci->a |= mask[(sib & 7) | rexb];        // base register
                     }
                     else
-                        ci->a |= mask[rm];
+                        ci->a |= mask[rm | rexb];
                 }
                 else
                 {   static unsigned char ea16[8] = {mBX|mSI,mBX|mDI,mBP|mSI,mBP|mDI,mSI,mDI,mBP,mBX};
@@ -1611,9 +1864,9 @@ STATIC void getinfo(Cinfo *ci,code *c)
 
             case 3:
                 if (r & EA)
-                    ci->r |= mask[(r & B) ? (rm & 3) : rm];
+                    ci->r |= regmask(c,rm | rexb,r & B,xmmrm);
                 if (w & EA)
-                    ci->w |= mask[(w & B) ? (rm & 3) : rm];
+                    ci->w |= regmask(c,rm | rexb,w & B,xmmrm);
                 break;
         }
         // Adjust sibmodrm so that addressing modes can be compared simply
@@ -1899,7 +2152,8 @@ if (c2->IEVpointer1 + sz2 <= c1->IEVpointer1) printf("t5\n");
         }
 
         // If referring to distinct types, then no dependency
-        if (c1->Irex && c2->Irex && c1->Irex != c2->Irex)
+        // (in 64 bit code Irex is the REX prefix instead)
+        if (!I64 && c1->Irex && c2->Irex && c1->Irex != c2->Irex)
             goto Lswap;
 
         ifl1 = c1->IFL1;
@@ -2745,6 +2999,373 @@ code *schedule(code *c,regm_t scratch)
 
 /**************************************************************************/
 
+/* Out of order cores reorder instructions themselves, across many basic
+ * blocks, so there are no pipes or decoders to fill. Instead the
+ * scheduler for them:
+ *  o   starts loads and other long latency instructions as soon as
+ *      their operands are ready, ahead of work that doesn't wait on them
+ *  o   leaves the instruction setting the flags for a conditional jump
+ *      right before the jump, where the core fuses the two into one
+ *      micro-op
+ *  o   counts writing part of a register, or INC and DEC writing part of
+ *      the flags, then reading all of it as extra latency, for the merge
+ * It reorders only runs of instructions conflict() allows to be swapped,
+ * between jump targets, jumps, calls and the like.
+ */
+
+#define OOOMAX          64      // most instructions in a run
+#define OOOWIDTH        4       // instructions issued per clock
+#define OOOLOAD         4       // clocks for a load from the L1 cache
+#define OOOMERGE        2       // clocks to merge a partial register or flags
+
+/******************************************
+ * Clocks before the result of ci is available.
+ */
+
+STATIC int ooo_latency(Cinfo *ci)
+{
+    code *c = ci->c;
+    unsigned op = c->Iop & 0xFF;
+    unsigned reg = (c->Irm >> 3) & 7;
+    int lat = 1;
+
+    if ((c->Iop & 0xFF00) == 0x0F00)
+    {
+        switch (op)
+        {
+            case 0xAF:                  // IMUL r,EA
+                lat = 3;
+                break;
+            case 0x58:                  // ADD
+            case 0x59:                  // MUL
+            case 0x5C:                  // SUB
+            case 0x5A:                  // CVTSD2SS, CVTSS2SD
+            case 0x2A:                  // CVTSI2SD
+            case 0x2C:                  // CVTTSD2SI
+            case 0x2D:                  // CVTSD2SI
+                lat = 4;
+                break;
+            case 0x5E:                  // DIV
+                lat = 14;
+                break;
+            case 0x51:                  // SQRT
+                lat = 18;
+                break;
+        }
+    }
+    else
+    {
+        switch (op)
+        {
+            case 0x69:
+            case 0x6B:                  // IMUL r,EA,imm
+                lat = 3;
+                break;
+            case 0xF6:
+            case 0xF7:
+                if (reg == 4 || reg == 5)       // MUL, IMUL
+                    lat = 3;
+                else if (reg >= 6)              // DIV, IDIV
+                    lat = 26;
+                break;
+            case 0xD8:
+            case 0xDA:
+            case 0xDC:
+            case 0xDE:
+                if (reg == 1)                   // FMUL
+                    lat = 5;
+                else if (reg >= 6)              // FDIV
+                    lat = 20;
+                else
+                    lat = 3;
+                break;
+            case 0xD9:
+                if (c->Irm == 0xFA)             // FSQRT
+                    lat = 20;
+                break;
+        }
+    }
+    if (ci->r & mMEM)                   // LEA doesn't have mMEM
+        lat += OOOLOAD;
+    return lat;
+}
+
+/******************************************
+ * Determine if c, setting the flags for the conditional jump right after
+ * it, is fused with the jump into one micro-op: CMP or TEST, except of
+ * memory with an immediate, and on Sandy Bridge and later also ADD, SUB
+ * and AND of a register.
+ */
+
+STATIC int ooo_fusible(code *c)
+{
+    unsigned reg = (c->Irm >> 3) & 7;
+    int mem = (c->Irm & 0xC0) != 0xC0;
+
+    switch (c->Iop)
+    {
+        case 0x38: case 0x39: case 0x3A: case 0x3B:     // CMP
+        case 0x84: case 0x85:                           // TEST
+        case 0x3C: case 0x3D:                           // CMP EAX,imm
+        case 0xA8: case 0xA9:                           // TEST EAX,imm
+        case 0x02: case 0x03: case 0x04: case 0x05:     // ADD reg
+        case 0x22: case 0x23: case 0x24: case 0x25:     // AND reg
+        case 0x2A: case 0x2B: case 0x2C: case 0x2D:     // SUB reg
+            return 1;
+
+        case 0x00: case 0x01:                           // ADD EA,reg
+        case 0x20: case 0x21:                           // AND EA,reg
+        case 0x28: case 0x29:                           // SUB EA,reg
+            return !mem;
+
+        case 0x80: case 0x81: case 0x83:                // Grp 1 EA,imm
+            return !mem && (reg == 7 || reg == 0 || reg == 4 || reg == 5);
+
+        case 0xF6: case 0xF7:                           // TEST EA,imm
+            return !mem && reg == 0;
+    }
+    return 0;
+}
+
+/******************************************
+ * Determine if c is INC or DEC, which leave the carry flag alone.
+ */
+
+STATIC int ooo_incdec(code *c)
+{
+    return (c->Iop & 0xF0) == 0x40 && !I64 ||
+           (c->Iop == 0xFE || c->Iop == 0xFF) && (c->Irm & modregrm(0,6,0)) == 0;
+}
+
+/******************************************
+ * Determine if c reads the carry flag.
+ */
+
+STATIC int ooo_readscf(code *c)
+{
+    unsigned op = c->Iop;
+    unsigned reg = (c->Irm >> 3) & 7;
+    unsigned cc;
+
+    if ((op & 0xF0) == 0x70 ||                  // Jcc
+        (op & 0xFFF0) == 0x0F80 ||              // Jcc
+        (op & 0xFFF0) == 0x0F90 ||              // SETcc
+        (op & 0xFFF0) == 0x0F40)                // CMOVcc
+    {   cc = op & 0x0E;
+        return cc == 2 || cc == 6;              // B, AE, BE, A
+    }
+    if (op >= 0x10 && op < 0x20)                // ADC, SBB
+        return (op & 7) < 6;
+    if (op == 0x80 || op == 0x81 || op == 0x83) // ADC, SBB EA,imm
+        return reg == 2 || reg == 3;
+    if ((op & 0xFC) == 0xD0 || (op & 0xFE) == 0xC0)     // RCL, RCR
+        return reg == 2 || reg == 3;
+    return 0;
+}
+
+/******************************************
+ * Clocks from ci1 to ci2 that comes after it, if ci2 reads
+ * what ci1 writes.
+ */
+
+STATIC int ooo_edge(Cinfo *ci1,Cinfo *ci2,int lat1)
+{
+    unsigned raw = ci1->w & ci2->r & ~N;
+    int wsz;
+
+    if (!raw)
+        return 0;                       // the core renames the registers
+    wsz = (ci1->w & B) ? 1 : ci1->sz;
+    if (raw & 0xFFFF && wsz < 4 && ci2->sz > wsz ||
+        raw & F && ooo_incdec(ci1->c) && ooo_readscf(ci2->c))
+        lat1 += OOOMERGE;
+    return lat1;
+}
+
+/******************************************
+ * Schedule the run ci[0..n], which are all swappable as far as their
+ * kinds go, and append it to *pctail.
+ * Input:
+ *      term    if !NULL, the unswappable instruction ending the run
+ * Returns:
+ *      new tail
+ */
+
+STATIC code **ooo_run(code **pctail,Cinfo *ci,int n,Cinfo *term)
+{
+    unsigned char dep[OOOMAX][OOOMAX];  // dep[i][j]: i must come before j
+    int lat[OOOMAX];
+    int height[OOOMAX];                 // clocks from start to end of run
+    int earliest[OOOMAX];               // first clock operands are ready
+    int npred[OOOMAX];
+    char done[OOOMAX];
+    int flagw = -1;                     // last instruction writing flags
+    int fused = -1;                     // fused with the jump ending the run
+    int i,j,k;
+
+    memset(dep,0,sizeof(dep));
+    for (j = 0; j < n; j++)
+    {
+        lat[j] = ooo_latency(&ci[j]);
+        for (i = 0; i < j; i++)
+            if (conflict(&ci[i],&ci[j],0))
+                dep[i][j] = 1;
+
+        // The flags an instruction reads must be set by the same instruction
+        // as before. conflict() lets two instructions that set flags nobody
+        // is marked as needing be swapped, so pin them before that one.
+        if (ci[j].r & F && flagw >= 0)
+            for (i = 0; i < flagw; i++)
+                if (ci[i].w & F)
+                    dep[i][flagw] = 1;
+        if (ci[j].w & F)
+            flagw = j;
+    }
+    if (flagw >= 0)                     // flags may be read after the run
+        for (i = 0; i < flagw; i++)
+            if (ci[i].w & F)
+                dep[i][flagw] = 1;
+
+    // A jump target stays first
+    if (n && ci[0].c->Iflags & (CFtarg | CFtarg2))
+        for (j = 1; j < n; j++)
+            dep[0][j] = 1;
+
+    // Heights, counting the conditional jump ending the run
+    for (i = n; --i >= 0;)
+    {   int h = lat[i];
+        int nsucc = 0;
+
+        for (j = i + 1; j < n; j++)
+            if (dep[i][j])
+            {   int e = ooo_edge(&ci[i],&ci[j],lat[i]) + height[j];
+                if (e > h)
+                    h = e;
+                nsucc++;
+            }
+        if (i == flagw && term && term->r & F)
+        {
+            if (!nsucc && ooo_fusible(ci[i].c))
+                fused = i;
+            else if (ooo_incdec(ci[i].c) && ooo_readscf(term->c))
+                h += OOOMERGE;
+        }
+        height[i] = h;
+    }
+
+    // List schedule, taking the highest of the instructions whose
+    // operands are ready the soonest
+    for (j = 0; j < n; j++)
+    {   npred[j] = 0;
+        for (i = 0; i < j; i++)
+            npred[j] += dep[i][j];
+        earliest[j] = 0;
+        done[j] = 0;
+    }
+    int clock = 0;
+    int issued = 0;
+    for (k = 0; k < n; k++)
+    {   int best = -1;
+        int bestclock = 0;
+
+        for (j = 0; j < n; j++)
+        {   int t;
+
+            if (done[j] || npred[j] || j == fused && k < n - 1)
+                continue;
+            t = earliest[j] > clock ? earliest[j] : clock;
+            if (best < 0 || t < bestclock ||
+                t == bestclock && height[j] > height[best])
+            {   best = j;
+                bestclock = t;
+            }
+        }
+        assert(best >= 0 && best < n);
+
+        if (bestclock > clock)
+        {   clock = bestclock;
+            issued = 0;
+        }
+        if (++issued == OOOWIDTH)
+        {   clock++;
+            issued = 0;
+        }
+        done[best] = 1;
+        for (j = best + 1; j < n; j++)
+            if (dep[best][j])
+            {   int t = bestclock + ooo_edge(&ci[best],&ci[j],lat[best]);
+
+                npred[j]--;
+                if (t > earliest[j])
+                    earliest[j] = t;
+            }
+
+        // Append best, with the NOPs and line numbers that follow it
+        code *c = ci[best].c;
+        *pctail = c;
+        while (code_next(c))
+            c = code_next(c);
+        pctail = &code_next(c);
+    }
+    return pctail;
+}
+
+/******************************
+ * Schedule instructions for out of order cores.
+ */
+
+code *schedule_ooo(code *c)
+{
+    code *cresult = NULL;
+    code **pctail = &cresult;
+    Cinfo ci[OOOMAX];
+
+    while (c)
+    {
+        if ((c->Iop == NOP ||
+             ((c->Iop & 0xFF) == ESCAPE && c->Iop != (ESCAPE | ESCadjfpu)) ||
+             c->Iflags & CFclassinit) &&
+            !(c->Iflags & (CFtarg | CFtarg2)))
+        {   code *cn;
+
+            // Just append this instruction to pctail and go to the next one
+            *pctail = c;
+            cn = code_next(c);
+            code_next(c) = NULL;
+            pctail = &code_next(c);
+            c = cn;
+            continue;
+        }
+
+        // Gather the run up to an instruction that can't be swapped
+        int n = 0;
+        code *term = NULL;
+        while (c && n < OOOMAX)
+        {
+            if (n && c->Iflags & (CFtarg | CFtarg2))
+                break;
+            getinfo(&ci[n],c);
+            if ((ci[n].r | ci[n].w) & N)
+            {   term = c;
+                break;
+            }
+            n++;
+            c = csnip(c);
+        }
+        pctail = ooo_run(pctail,ci,n,term ? &ci[n] : NULL);
+        if (term)
+        {   c = csnip(term);
+            *pctail = term;
+            while (code_next(term))
+                term = code_next(term);
+            pctail = &code_next(term);
+        }
+    }
+    return cresult;
+}
+
+/**************************************************************************/
+
 /********************************************
  * Replace any occurrence of r1 in EA with r2.
  */
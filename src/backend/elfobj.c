@@ -115,6 +115,7 @@ static void obj_rtinit();
 static IDXSYM elf_addsym(IDXSTR sym, targ_size_t val, unsigned sz,
                         unsigned typ,unsigned bind,IDXSEC sec);
 static long elf_align(targ_size_t size, long offset);
+static IDXSTR elf_sharestr(IDXSTR idx);
 
 // The object file is built is several separate pieces
 
@@ -135,10 +136,23 @@ static Outbuffer *section_names;
 // Hash table for section_names
 AArray *section_names_hashtable;
 
-/* ====================== Cached Strings in section_names ================= */
+// String Table  - String table for all other names
+static Outbuffer *symtab_strings;
+
+// Hash table for symtab_strings
+static AArray *symtab_strings_hashtable;
+
+/* ============== Cached Strings in section_names and symtab_strings ======== */
+
+/* Keys are IDXSTR offsets of 0 terminated strings in *strtab.
+ */
 
 struct TypeInfo_Idxstr : TypeInfo
 {
+    Outbuffer **strtab;         // string table the keys index into
+
+    TypeInfo_Idxstr(Outbuffer **strtab) : strtab(strtab) { }
+
     const char* toString();
     hash_t getHash(void *p);
     int equals(void *p1, void *p2);
@@ -147,7 +161,8 @@ struct TypeInfo_Idxstr : TypeInfo
     void swap(void *p1, void *p2);
 };
 
-TypeInfo_Idxstr ti_idxstr;
+TypeInfo_Idxstr ti_idxstr(&section_names);
+static TypeInfo_Idxstr ti_symstr(&symtab_strings);
 
 const char* TypeInfo_Idxstr::toString()
 {
@@ -158,7 +173,7 @@ hash_t TypeInfo_Idxstr::getHash(void *p)
 {
     IDXSTR a = *(IDXSTR *)p;
     hash_t hash = 0;
-    for (const char *s = (char *)(section_names->buf + a);
+    for (const char *s = (char *)((*strtab)->buf + a);
          *s;
          s++)
     {
@@ -171,8 +186,8 @@ int TypeInfo_Idxstr::equals(void *p1, void *p2)
 {
     IDXSTR a1 = *(IDXSTR*)p1;
     IDXSTR a2 = *(IDXSTR*)p2;
-    const char *s1 = (char *)(section_names->buf + a1);
-    const char *s2 = (char *)(section_names->buf + a2);
+    const char *s1 = (char *)((*strtab)->buf + a1);
+    const char *s2 = (char *)((*strtab)->buf + a2);
 
     return strcmp(s1, s2) == 0;
 }
@@ -181,8 +196,8 @@ int TypeInfo_Idxstr::compare(void *p1, void *p2)
 {
     IDXSTR a1 = *(IDXSTR*)p1;
     IDXSTR a2 = *(IDXSTR*)p2;
-    const char *s1 = (char *)(section_names->buf + a1);
-    const char *s2 = (char *)(section_names->buf + a2);
+    const char *s1 = (char *)((*strtab)->buf + a1);
+    const char *s2 = (char *)((*strtab)->buf + a2);
 
     return strcmp(s1, s2);
 }
@@ -200,10 +215,6 @@ void TypeInfo_Idxstr::swap(void *p1, void *p2)
 
 /* ======================================================================== */
 
-// String Table  - String table for all other names
-static Outbuffer *symtab_strings;
-
-
 // Section Headers
 Outbuffer  *SECbuf;             // Buffer to build section table in
 #define SecHdrTab ((Elf32_Shdr *)SECbuf->buf)
@@ -308,6 +319,7 @@ int elf_getsegment2(IDXSEC shtidx, IDXSYM symidx, IDXSEC relidx);
  *      str     =       string to add
  *
  * Returns index into the specified string table.
+ * Strings for symtab_strings are only added once.
  */
 
 IDXSTR Obj::addstr(Outbuffer *strtab, const char *str)
@@ -316,61 +328,29 @@ IDXSTR Obj::addstr(Outbuffer *strtab, const char *str)
     IDXSTR idx = strtab->size();        // remember starting offset
     strtab->writeString(str);
     //dbg_printf("\tidx %d, new size %d\n",idx,strtab->size());
+    if (strtab == symtab_strings)
+        idx = elf_sharestr(idx);
     return idx;
 }
 
 /*******************************
- * Find a string in a string table
- * Input:
- *      strtab  =       string table for entry
- *      str     =       string to find
- *
- * Returns index into the specified string table or 0.
+ * The string at the end of symtab_strings starting at idx
+ * has just been added. If it was already there, remove it
+ * again and use the existing one.
+ * Returns:
+ *      index of the string in symtab_strings
  */
 
-static IDXSTR elf_findstr(Outbuffer *strtab, const char *str, const char *suffix)
+static IDXSTR elf_sharestr(IDXSTR idx)
 {
-    //printf("elf_findstr(strtab = %p, str = %s, suffix = %s\n", strtab, str ? str : "", suffix ? suffix : "");
-
-    size_t len = strlen(str);
-
-    // Combine str~suffix and have buf point to the combination
-#ifdef DEBUG
-    char tmpbuf[25];    // to exercise the alloca() code path
-#else
-    char tmpbuf[1024];  // the alloca() code path is slow
-#endif
-    const char *buf;
-    if (suffix)
-    {
-        size_t suffixlen = strlen(suffix);
-        if (len + suffixlen >= sizeof(tmpbuf))
-        {
-             buf = (char *)alloca(len + suffixlen + 1);
-             assert(buf);
-        }
-        else
-        {
-             buf = tmpbuf;
-        }
-        memcpy((char *)buf, str, len);
-        memcpy((char *)buf + len, suffix, suffixlen + 1);
-        len += suffixlen;
-    }
-    else
-        buf = str;
-
-    // Linear search, slow
-    const char *ent = (char *)strtab->buf+1;
-    const char *pend = ent+strtab->size() - 1;
-    while (ent + len < pend)
-    {
-        if (memcmp(buf, ent, len + 1) == 0)
-            return ent - (const char *)strtab->buf;
-        ent = (const char *)memchr(ent, 0, pend - ent);
-        ent += 1;
+    IDXSTR *pidx = (IDXSTR *)symtab_strings_hashtable->get(&idx);
+    if (*pidx)
+    {   // Already there
+        symtab_strings->setsize(idx);
+        return *pidx;
     }
-    return 0;                   // never found match
+    *pidx = idx;
+    return idx;
 }
 
 /*******************************
@@ -431,7 +411,7 @@ static IDXSTR elf_addmangled(Symbol *s)
     if (destr != dest)                  // if we resized result
         mem_free(destr);
     //dbg_printf("\telf_addmagled symtab_strings %s namidx %d len %d size %d\n",name, namidx,len,symtab_strings->size());
-    return namidx;
+    return elf_sharestr(namidx);
 }
 
 /*******************************
@@ -663,6 +643,9 @@ Obj *Obj::init(Outbuffer *objbuf, const char *filename, const char *csegname)
         symtab_strings->reserve(2048);
         symtab_strings->writeByte(0);
     }
+    if (symtab_strings_hashtable)
+        delete symtab_strings_hashtable;
+    symtab_strings_hashtable = new AArray(&ti_symstr, sizeof(IDXSTR));
 
     if (SECbuf)
         SECbuf->setsize(0);
@@ -975,6 +958,100 @@ void *elf_renumbersyms()
     return symtab;
 }
 
+/***************************
+ * Tail merging of symtab_strings: a string that is the end of
+ * another one (such as "Z" and "_D3foo3BarZ") is not stored separately,
+ * but points into the middle of the longer one.
+ */
+
+struct MergeStr
+{
+    const unsigned char *end;   // terminating 0 of the string
+    unsigned len;               // strlen of the string
+    IDXSTR idx;                 // index in symtab_strings
+};
+
+/* Order by the reversed strings, so each string is followed by
+ * the ones it is a suffix of.
+ */
+static int mergestr_cmp(const void *p1, const void *p2)
+{
+    const MergeStr *m1 = (const MergeStr *)p1;
+    const MergeStr *m2 = (const MergeStr *)p2;
+    unsigned n = m1->len < m2->len ? m1->len : m2->len;
+    for (unsigned i = 1; i <= n; i++)
+    {
+        int c = *(m1->end - i) - *(m2->end - i);
+        if (c)
+            return c;
+    }
+    if (m1->len != m2->len)
+        return m1->len < m2->len ? -1 : 1;
+    return m1->idx < m2->idx ? -1 : (m1->idx > m2->idx);
+}
+
+/***************************
+ * Rebuild symtab_strings with the strings referenced by symtab
+ * tail merged, and point the symbols at the new indices.
+ * Input:
+ *      symtab  =       symbol table as returned by elf_renumbersyms()
+ */
+
+static void elf_mergestrings(void *symtab)
+{
+    size_t symsize = I64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+    // st_name is the first member of both Elf32_Sym and Elf64_Sym
+    #define ST_NAME(i) (*(elf_u32_f32 *)((char *)symtab + (i) * symsize))
+
+    MergeStr *strs = (MergeStr *)util_malloc(sizeof(MergeStr), symbol_idx + 1);
+    int nstrs = 0;
+    for (int i = 0; i < symbol_idx; i++)
+    {
+        IDXSTR idx = ST_NAME(i);
+        if (!idx)
+            continue;
+        MergeStr *m = &strs[nstrs++];
+        m->idx = idx;
+        m->len = strlen((char *)symtab_strings->buf + idx);
+        m->end = symtab_strings->buf + idx + m->len;
+    }
+    qsort(strs, nstrs, sizeof(MergeStr), &mergestr_cmp);
+
+    // Maps old indices to new ones
+    IDXSTR *remap = (IDXSTR *)util_malloc(sizeof(IDXSTR), symtab_strings->size());
+
+    Outbuffer *merged = new Outbuffer(symtab_strings->size());
+    merged->writeByte(0);
+    for (int i = nstrs; i--; )
+    {
+        MergeStr *m = &strs[i];
+        MergeStr *mnext = &strs[i + 1];
+        if (i + 1 < nstrs &&
+            m->len <= mnext->len &&
+            memcmp(m->end - m->len, mnext->end - m->len, m->len) == 0)
+        {   // Suffix of the next one
+            remap[m->idx] = remap[mnext->idx] + mnext->len - m->len;
+        }
+        else
+        {
+            remap[m->idx] = merged->size();
+            merged->write(m->end - m->len, m->len + 1);
+        }
+    }
+
+    for (int i = 0; i < symbol_idx; i++)
+    {
+        if (ST_NAME(i))
+            ST_NAME(i) = remap[ST_NAME(i)];
+    }
+    #undef ST_NAME
+
+    util_free(remap);
+    util_free(strs);
+    delete symtab_strings;
+    symtab_strings = merged;
+}
+
 
 /***************************
  * Fixup and terminate object file.
@@ -1042,6 +1119,7 @@ void Obj::term(const char *objfilename)
     Elf32_Shdr *sechdr;
     seg_data *seg;
     void *symtab = elf_renumbersyms();
+    elf_mergestrings(symtab);
     FILE *fd = NULL;
 
     // Output the ELF Header
@@ -54,7 +54,69 @@ STATIC void accumlv(vec_t GEN , vec_t KILL , elem *n);
 STATIC void accumvbe(vec_t GEN , vec_t KILL , elem *n);
 STATIC void accumrd(vec_t GEN , vec_t KILL , elem *n);
 STATIC void flowaecp(void);
+STATIC void flowsolve(int forward, int (*transfer)(block *b));
+STATIC int rdtransfer(block *b);
+STATIC int aecptransfer(block *b);
+STATIC int lvtransfer(block *b);
+STATIC int vbetransfer(block *b);
 
+/******************* WORKLIST SOLVER ***********************/
+
+static int flowfwd;             // the problem being solved is forward
+static vec_t flowpending;       // blocks to revisit, by position
+
+/*************************************
+ * Queue block b to be revisited by flowsolve().
+ */
+
+STATIC void flowqueue(block *b)
+{
+        unsigned i = b->Bdfoidx;
+
+        if (i < dfotop && dfo[i] == b)  // blocks not in dfo[] never change
+            vec_setbit(flowfwd ? i : dfotop - 1 - i,flowpending);
+}
+
+/*************************************
+ * Solve a data flow problem, starting from the sets the caller
+ * initialized. Each block is visited once, then again only when
+ * the sets of its predecessors (forward problems) or successors
+ * (backward problems) have changed. Forward problems visit the
+ * blocks in dfo[] order, which is reverse postorder, backward
+ * problems in the reverse of it.
+ * Input:
+ *      forward         !=0 for a forward problem
+ *      transfer        recomputes the sets for b, returns !=0 if
+ *                      what b passes on changed
+ */
+
+STATIC void flowsolve(int forward, int (*transfer)(block *b))
+{       size_t i;
+
+        flowfwd = forward;
+        flowpending = vec_calloc(dfotop);
+        vec_set(flowpending);           // visit every block at least once
+        while ((i = vec_index(0,flowpending)) < dfotop)
+        {
+            // Sweep once over what is queued; what is queued behind
+            // the sweep waits for the next one
+            for (; i < dfotop; i = vec_index(i + 1,flowpending))
+            {   block *b;
+                list_t bl;
+
+                vec_clearbit(i,flowpending);
+                b = dfo[forward ? i : dfotop - 1 - i];
+                if ((*transfer)(b))
+                {
+                    for (bl = forward ? b->Bsucc : b->Bpred; bl; bl = list_next(bl))
+                        flowqueue(list_block(bl));
+                }
+            }
+        }
+        vec_free(flowpending);
+        flowpending = NULL;
+}
+
 /***************** REACHING DEFINITIONS *********************/
 
 /************************************
@@ -69,9 +131,7 @@ STATIC void flowaecp(void);
  */
 
 void flowrd()
-{       register vec_t tmp;
-        register unsigned i;
-        register bool anychng;
+{       register unsigned i;
 
         rdgenkill();            /* Compute Bgen and Bkill for RDs       */
         if (deftop == 0)        /* if no definition elems               */
@@ -80,40 +140,12 @@ void flowrd()
         /* The transfer equation is:                                    */
         /*      Bin = union of Bouts of all predecessors of B.          */
         /*      Bout = (Bin - Bkill) | Bgen                             */
-        /* Using Ullman's algorithm:                                    */
+        /* Using a worklist:                                            */
 
         for (i = 0; i < dfotop; i++)
                 vec_copy(dfo[i]->Boutrd,dfo[i]->Bgen);
 
-        tmp = vec_calloc(deftop);
-        do
-        {       anychng = FALSE;
-                for (i = 0; i < dfotop; i++)    /* for each block       */
-                {       register block *b;
-                        register list_t bp;
-
-                        b = dfo[i];
-
-                        /* Binrd = union of Boutrds of all predecessors of b */
-                        vec_clear(b->Binrd);
-                        if (b->BC != BCcatch /*&& b->BC != BCjcatch*/)
-                        {
-                            /* Set Binrd to 0 to account for:
-                             * i = 0;
-                             * try { i = 1; throw; } catch () { x = i; }
-                             */
-                            for (bp = b->Bpred; bp; bp = list_next(bp))
-                                vec_orass(b->Binrd,list_block(bp)->Boutrd);
-                        }
-                        /* Bout = (Bin - Bkill) | Bgen */
-                        vec_sub(tmp,b->Binrd,b->Bkill);
-                        vec_orass(tmp,b->Bgen);
-                        if (!anychng)
-                                anychng = !vec_equal(tmp,b->Boutrd);
-                        vec_copy(b->Boutrd,tmp);
-                }
-        } while (anychng);              /* while any changes to Boutrd  */
-        vec_free(tmp);
+        flowsolve(TRUE,rdtransfer);
 
 #if 0
         dbg_printf("Reaching definitions\n");
@@ -129,6 +161,30 @@ void flowrd()
 #endif
 }
 
+/***************************
+ * Recompute Binrd and Boutrd for b.
+ * Returns:
+ *      !=0 if Boutrd changed
+ */
+
+STATIC int rdtransfer(block *b)
+{       register list_t bp;
+
+        /* Binrd = union of Boutrds of all predecessors of b */
+        vec_clear(b->Binrd);
+        if (b->BC != BCcatch /*&& b->BC != BCjcatch*/)
+        {
+            /* Set Binrd to 0 to account for:
+             * i = 0;
+             * try { i = 1; throw; } catch () { x = i; }
+             */
+            for (bp = b->Bpred; bp; bp = list_next(bp))
+                vec_orass(b->Binrd,list_block(bp)->Boutrd);
+        }
+        /* Bout = (Bin - Bkill) | Bgen */
+        return vec_subor(b->Boutrd,b->Binrd,b->Bkill,b->Bgen);
+}
+
 /***************************
  * Compute Bgen and Bkill for RDs.
  */
@@ -348,9 +404,7 @@ void flowcp()
  */
 
 STATIC void flowaecp()
-{       vec_t tmp;
-        register unsigned i;
-        bool anychng;
+{       register unsigned i;
 
         aecpgenkill();          /* Compute Bgen and Bkill for AEs or CPs */
         if (exptop <= 1)        /* if no expressions                    */
@@ -359,7 +413,7 @@ STATIC void flowaecp()
         /* The transfer equation is:                    */
         /*      Bin = & Bout(all predecessors P of B)   */
         /*      Bout = (Bin - Bkill) | Bgen             */
-        /* Using Ullman's algorithm:                    */
+        /* Using a worklist:                            */
 
         vec_clear(startblock->Bin);
         vec_copy(startblock->Bout,startblock->Bgen); /* these never change */
@@ -381,81 +435,52 @@ STATIC void flowaecp()
                 }
         }
 
-        tmp = vec_calloc(exptop);
-        do
-        {   anychng = FALSE;
+        flowsolve(TRUE,aecptransfer);
+}
 
-            // For all blocks except startblock
-            for (i = 1; i < dfotop; i++)
-            {   block *b = dfo[i];
-                list_t bl = b->Bpred;
-                block *bp;
+/*****************************************
+ * Recompute Bin, Bout and Bout2 for b, for AEs or CPs.
+ * Returns:
+ *      !=0 if Bout or Bout2 changed
+ */
 
-                // Bin = & of Bout of all predecessors
-                // Bout = (Bin - Bkill) | Bgen
+STATIC int aecptransfer(block *b)
+{       list_t bl = b->Bpred;
+        block *bp;
+        int changed;
 
-                assert(bl);     // it must have predecessors
-                bp = list_block(bl);
-                if (bp->BC == BCiftrue && list_block(bp->Bsucc) != b)
-                    vec_copy(b->Bin,bp->Bout2);
-                else
-                    vec_copy(b->Bin,bp->Bout);
-                while (TRUE)
-                {   bl = list_next(bl);
-                    if (!bl)
-                        break;
-                    bp = list_block(bl);
-                    if (bp->BC == BCiftrue && list_block(bp->Bsucc) != b)
-                        vec_andass(b->Bin,bp->Bout2);
-                    else
-                        vec_andass(b->Bin,bp->Bout);
-                }
+        if (b == startblock)
+            return FALSE;               // its sets never change
 
-                if (anychng)
-                {   vec_sub(b->Bout,b->Bin,b->Bkill);
-                    vec_orass(b->Bout,b->Bgen);
-                }
-                else
-                {   vec_sub(tmp,b->Bin,b->Bkill);
-                    vec_orass(tmp,b->Bgen);
-                    if (!vec_equal(tmp,b->Bout))
-                    {   // Swap Bout and tmp instead of
-                        // copying tmp over Bout
-                        vec_t v;
-
-                        v = tmp;
-                        tmp = b->Bout;
-                        b->Bout = v;
-                        anychng = TRUE;
-                    }
-                }
+        // Bin = & of Bout of all predecessors
+        // Bout = (Bin - Bkill) | Bgen
 
-                if (b->BC == BCiftrue)
-                {   // Bout2 = (Bin - Bkill2) | Bgen2
-                    if (anychng)
-                    {   vec_sub(b->Bout2,b->Bin,b->Bkill2);
-                        vec_orass(b->Bout2,b->Bgen2);
-                    }
-                    else
-                    {   vec_sub(tmp,b->Bin,b->Bkill2);
-                        vec_orass(tmp,b->Bgen2);
-                        if (!vec_equal(tmp,b->Bout2))
-                        {   // Swap Bout and tmp instead of
-                            // copying tmp over Bout2
-                            vec_t v;
-
-                            v = tmp;
-                            tmp = b->Bout2;
-                            b->Bout2 = v;
-                            anychng = TRUE;
-                        }
-                    }
-                }
-            }
-        } while (anychng);
-        vec_free(tmp);
+        assert(bl);     // it must have predecessors
+        bp = list_block(bl);
+        if (bp->BC == BCiftrue && list_block(bp->Bsucc) != b)
+            vec_copy(b->Bin,bp->Bout2);
+        else
+            vec_copy(b->Bin,bp->Bout);
+        while (TRUE)
+        {   bl = list_next(bl);
+            if (!bl)
+                break;
+            bp = list_block(bl);
+            if (bp->BC == BCiftrue && list_block(bp->Bsucc) != b)
+                vec_andass(b->Bin,bp->Bout2);
+            else
+                vec_andass(b->Bin,bp->Bout);
+        }
+
+        changed = vec_subor(b->Bout,b->Bin,b->Bkill,b->Bgen);
+
+        if (b->BC == BCiftrue)
+        {   // Bout2 = (Bin - Bkill2) | Bgen2
+            changed |= vec_subor(b->Bout2,b->Bin,b->Bkill2,b->Bgen2);
+        }
+        return changed;
 }
-
+
 /******************************
  * A variable to avoid parameter overhead to asgexpelems().
  */
@@ -1134,11 +1159,10 @@ STATIC void accumaecpx(elem *n)
  * Note that Bgen & Bkill = 0.
  */
 
+static vec_t livexit;            // variables live on exit from the function
+
 void flowlv()
-{       vec_t tmp,livexit;
-        register unsigned i;
-        bool anychng;
-        unsigned cnt;
+{       register unsigned i;
 
         lvgenkill();            /* compute Bgen and Bkill for LVs.      */
         //assert(globsym.top);  /* should be at least some symbols      */
@@ -1155,47 +1179,16 @@ void flowlv()
         /* The transfer equation is:                            */
         /*      Bin = (Bout - Bkill) | Bgen                     */
         /*      Bout = union of Bin of all successors to B.     */
-        /* Using Ullman's algorithm:                            */
+        /* Using a worklist, in reverse DFO order:              */
 
         for (i = 0; i < dfotop; i++)            /* for each block B     */
         {
                 vec_copy(dfo[i]->Binlv,dfo[i]->Bgen);   /* Binlv = Bgen */
         }
 
-        tmp = vec_calloc(globsym.top);
-        cnt = 0;
-        do
-        {       anychng = FALSE;
-
-                /* For each block B in reverse DFO order        */
-                for (i = dfotop; i--;)
-                {       register block *b = dfo[i];
-                        register list_t bl = b->Bsucc;
-
-                        /* Bout = union of Bins of all successors to B. */
-                        if (bl)
-                        {       vec_copy(b->Boutlv,list_block(bl)->Binlv);
-                                while ((bl = list_next(bl)) != NULL)
-                                {   vec_orass(b->Boutlv,list_block(bl)->Binlv);
-                                }
-                        }
-                        else /* no successors, Boutlv = livexit */
-                        {   //assert(b->BC==BCret||b->BC==BCretexp||b->BC==BCexit);
-                            vec_copy(b->Boutlv,livexit);
-                        }
-
-                        /* Bin = (Bout - Bkill) | Bgen                  */
-                        vec_sub(tmp,b->Boutlv,b->Bkill);
-                        vec_orass(tmp,b->Bgen);
-                        if (!anychng)
-                                anychng = !vec_equal(tmp,b->Binlv);
-                        vec_copy(b->Binlv,tmp);
-                }
-                cnt++;
-                assert(cnt < 50);
-        } while (anychng);
-        vec_free(tmp);
+        flowsolve(FALSE,lvtransfer);
         vec_free(livexit);
+        livexit = NULL;
 #if 0
         dbg_printf("Live variables\n");
         for (i = 0; i < dfotop; i++)
@@ -1211,6 +1204,31 @@ void flowlv()
 #endif
 }
 
+/*********************************
+ * Recompute Boutlv and Binlv for b.
+ * Returns:
+ *      !=0 if Binlv changed
+ */
+
+STATIC int lvtransfer(block *b)
+{       register list_t bl = b->Bsucc;
+
+        /* Bout = union of Bins of all successors to B. */
+        if (bl)
+        {       vec_copy(b->Boutlv,list_block(bl)->Binlv);
+                while ((bl = list_next(bl)) != NULL)
+                {   vec_orass(b->Boutlv,list_block(bl)->Binlv);
+                }
+        }
+        else /* no successors, Boutlv = livexit */
+        {   //assert(b->BC==BCret||b->BC==BCretexp||b->BC==BCexit);
+            vec_copy(b->Boutlv,livexit);
+        }
+
+        /* Bin = (Bout - Bkill) | Bgen                  */
+        return vec_subor(b->Binlv,b->Boutlv,b->Bkill,b->Bgen);
+}
+
 /***********************************
  * Compute Bgen and Bkill for LVs.
  * Allocate Binlv and Boutlv vectors.
@@ -1440,9 +1458,7 @@ STATIC void accumlv(vec_t GEN,vec_t KILL,elem *n)
  */
 
 void flowvbe()
-{       vec_t tmp;
-        unsigned i;
-        bool anychng;
+{       unsigned i;
 
         flowxx = VBE;
         aecpgenkill();          /* compute Bgen and Bkill for VBEs      */
@@ -1455,7 +1471,7 @@ void flowvbe()
         /* The transfer equation is:                    */
         /*      Bout = & Bin(all successors S of B)     */
         /*      Bin =(Bout - Bkill) | Bgen              */
-        /* Using Ullman's algorithm:                    */
+        /* Using a worklist, in reverse DFO order:      */
 
         /*dbg_printf("defkill = "); vec_println(defkill);
         dbg_printf("starkill = "); vec_println(starkill);*/
@@ -1477,40 +1493,36 @@ void flowvbe()
                 vec_orass(b->Bin,b->Bgen);
         }
 
-        tmp = vec_calloc(exptop);
-        do
-        {       anychng = FALSE;
+        flowsolve(FALSE,vbetransfer);
+}
 
-                /* for all blocks except return blocks in reverse dfo order */
-                for (i = dfotop; i--;)
-                {       block *b = dfo[i];
-                        list_t bl;
+/*************************************
+ * Recompute Bout and Bin for b, for VBEs.
+ * Returns:
+ *      !=0 if Bin changed
+ */
 
-                        if (b->BC == BCret || b->BC == BCretexp || b->BC == BCexit)
-                                continue;
+STATIC int vbetransfer(block *b)
+{       list_t bl;
 
-                        /* Bout = & of Bin of all successors */
-                        bl = b->Bsucc;
-                        assert(bl);     /* must have successors         */
-                        vec_copy(b->Bout,list_block(bl)->Bin);
-                        while (TRUE)
-                        {   bl = list_next(bl);
-                            if (!bl)
-                                break;
-                            vec_andass(b->Bout,list_block(bl)->Bin);
-                        }
+        if (b->BC == BCret || b->BC == BCretexp || b->BC == BCexit)
+                return FALSE;           // its sets never change
 
-                        /* Bin = (Bout - Bkill) | Bgen  */
-                        vec_sub(tmp,b->Bout,b->Bkill);
-                        vec_orass(tmp,b->Bgen);
-                        if (!anychng)
-                                anychng = !vec_equal(tmp,b->Bin);
-                        vec_copy(b->Bin,tmp);
-                }
-        } while (anychng);      /* while any changes occurred to any Bin */
-        vec_free(tmp);
+        /* Bout = & of Bin of all successors */
+        bl = b->Bsucc;
+        assert(bl);     /* must have successors         */
+        vec_copy(b->Bout,list_block(bl)->Bin);
+        while (TRUE)
+        {   bl = list_next(bl);
+            if (!bl)
+                break;
+            vec_andass(b->Bout,list_block(bl)->Bin);
+        }
+
+        /* Bin = (Bout - Bkill) | Bgen  */
+        return vec_subor(b->Bin,b->Bout,b->Bkill,b->Bgen);
 }
-
+
 /*************************************
  * Accumulate GEN and KILL sets for VBEs for this elem.
  */
@@ -15,6 +15,9 @@
 #endif /* __DMC__ */
 
 
+// Maximum allowable recursive function calls in CTFE
+#define CTFE_RECURSION_LIMIT 1000
+
 /**
    Global status of the CTFE engine. Mostly used for performance diagnostics
  */
@@ -144,6 +147,14 @@ Expression * modifyStructField(Type *type, StructLiteralExp *se, size_t offset,
 Expression *assignAssocArrayElement(Loc loc, AssocArrayLiteralExp *aae,
     Expression *index, Expression *newval);
 
+/// The elements of ae from lwr on are about to be modified. If they are
+/// shared with another array literal, give ae a copy of its own.
+void unshareArrayLiteral(ArrayLiteralExp *ae, size_t lwr);
+
+/// e is leaving CTFE. If it is an array or string literal which shares
+/// its elements with other literals, give it a copy of its own.
+void unshareLiteral(Expression *e);
+
 /// Given array literal oldval of type ArrayLiteralExp or StringExp, of length
 /// oldlen, change its length to newlen. If the newlen is longer than oldlen,
 /// all new elements will be set to the default initializer for the element type.
@@ -240,4 +251,31 @@ Expression *ctfeIndex(Loc loc, Type *type, Expression *e1, uinteger_t indx);
 Expression *ctfeCast(Loc loc, Type *type, Type *to, Expression *e);
 
 
+/************** CTFE bytecode *****************************************/
+
+struct CtfeInstr;
+
+/**
+  A function compiled for CTFE into instructions working on a frame
+  of integer registers. Only functions taking and returning integers
+  or bool, and using nothing else, are compiled; all others, and any
+  call that runs into an error, are left to the tree-walking interpreter.
+ */
+struct CtfeCode
+{
+    FuncDeclaration *fd;
+    CtfeInstr *instrs;          // NULL if fd cannot be compiled
+    size_t ninstrs;
+    unsigned nregs;             // size of a frame
+    unsigned nparams;           // parameters are in the first registers
+    dinteger_t *consts;         // constants loaded by CTFEloadk
+    FuncDeclarations *calls;    // functions called by CTFEcall
+    Expressions *returns;       // expressions returned by CTFEret
+    bool broken;                // calls a function that cannot be compiled
+
+    static CtfeCode *get(FuncDeclaration *fd);
+    Expression *interpret(Expressions *arguments);
+    int execute(dinteger_t *args, dinteger_t *result, Expression **ret, int depth);
+};
+
 #endif /* DMD_CTFE_H */
@@ -0,0 +1,1056 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+// Compile functions to bytecode for CTFE, and run it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>                     // mem{cpy|set}()
+
+#include "rmem.h"
+#include "aav.h"
+
+#include "statement.h"
+#include "expression.h"
+#include "init.h"
+#include "mtype.h"
+#include "declaration.h"
+#include "ctfe.h"
+
+#define LOG     0
+
+enum CTFEOP
+{
+    CTFEloadk,          // a = consts[b]
+    CTFEmov,            // a = b
+    CTFEcast,           // a = b, converted to ty
+
+    CTFEneg,            // a = -b
+    CTFEcom,            // a = ~b
+    CTFEnot,            // a = !b
+
+    CTFEadd,            // a = b + c
+    CTFEmin,
+    CTFEmul,
+    CTFEdiv,
+    CTFEmod,
+    CTFEshl,
+    CTFEshr,
+    CTFEushr,
+    CTFEand,
+    CTFEor,
+    CTFExor,
+
+    CTFElt,             // a = b < c
+    CTFEle,
+    CTFEgt,
+    CTFEge,
+    CTFEeq,
+    CTFEne,
+
+    CTFEjmp,            // goto a
+    CTFEjz,             // if (!b) goto a
+    CTFEjnz,            // if (b) goto a
+    CTFEcall,           // a = calls[c](b, b + 1, ...)
+    CTFEassert,         // fail if !b
+    CTFEret,            // return a, as returns[b]
+    CTFEretvoid,        // return
+    CTFEfail,           // give up, and leave it to the interpreter
+};
+
+struct CtfeInstr
+{
+    unsigned char op;           // CTFEOP
+    unsigned char ty;           // TY of the result
+    unsigned char ty1;          // TY of b, for shifts
+    unsigned char uns;          // !=0 for unsigned division and comparison
+    unsigned a;
+    unsigned b;
+    unsigned c;
+};
+
+/************************************
+ * Returns:
+ *      ty of t if it is an integral type CtfeCode can work with, 0 if not
+ */
+
+static int ctfeIntegral(Type *t)
+{
+    if (!t)
+        return 0;
+    Type *tb = t->toBasetype();
+    switch (tb->ty)
+    {
+        case Tbool:
+        case Tint8:  case Tuns8:  case Tchar:
+        case Tint16: case Tuns16: case Twchar:
+        case Tint32: case Tuns32: case Tdchar:
+        case Tint64: case Tuns64:
+            return tb->ty;
+    }
+    return 0;
+}
+
+/************************************
+ * Truncate value to type ty, the same as IntegerExp::toInteger().
+ */
+
+static dinteger_t ctfeNormalize(int ty, dinteger_t value)
+{
+    switch (ty)
+    {
+        case Tbool:         return value != 0;
+        case Tint8:         return (d_int8)  value;
+        case Tchar:
+        case Tuns8:         return (d_uns8)  value;
+        case Tint16:        return (d_int16) value;
+        case Twchar:
+        case Tuns16:        return (d_uns16) value;
+        case Tint32:        return (d_int32) value;
+        case Tdchar:
+        case Tuns32:        return (d_uns32) value;
+        default:            return value;
+    }
+}
+
+/************************************** CtfeCompiler ********************/
+
+struct CtfeLoop
+{
+    CtfeLoop *outer;
+    ArrayBase<void> breaks;     // CTFEjmp's to the end of the loop
+    ArrayBase<void> continues;  // CTFEjmp's to the loop increment
+};
+
+struct CtfeCompiler
+{
+    FuncDeclaration *fd;
+    OutBuffer code;             // CtfeInstr's
+    OutBuffer consts;           // dinteger_t's
+    FuncDeclarations *calls;
+    Expressions *returns;
+    AA *vars;                   // VarDeclaration* => 1 + register
+    unsigned regtop;            // next free register
+    unsigned keep;              // registers below this hold variables
+    unsigned nregs;             // most registers used
+    CtfeLoop *loop;             // innermost loop
+
+    CtfeCompiler(FuncDeclaration *fd);
+
+    size_t here() { return code.offset / sizeof(CtfeInstr); }
+    CtfeInstr *instr(size_t i) { return (CtfeInstr *)code.data + i; }
+    size_t emit(int op, unsigned a, unsigned b = 0, unsigned c = 0, int ty = 0);
+    void patch(size_t i) { instr(i)->a = here(); }
+    void patch(ArrayBase<void> *jumps);
+    unsigned newReg();
+    unsigned constant(dinteger_t value);
+    unsigned declare(VarDeclaration *v);
+    int varReg(VarDeclaration *v);
+    int expression(Expression *e);
+    int condition(Expression *e, int op);
+};
+
+CtfeCompiler::CtfeCompiler(FuncDeclaration *fd)
+{
+    this->fd = fd;
+    calls = new FuncDeclarations();
+    returns = new Expressions();
+    vars = NULL;
+    regtop = 0;
+    keep = 0;
+    nregs = 0;
+    loop = NULL;
+}
+
+size_t CtfeCompiler::emit(int op, unsigned a, unsigned b, unsigned c, int ty)
+{
+    CtfeInstr ci;
+    ci.op = op;
+    ci.ty = ty;
+    ci.ty1 = 0;
+    ci.uns = 0;
+    ci.a = a;
+    ci.b = b;
+    ci.c = c;
+    code.write(&ci, sizeof(ci));
+    return here() - 1;
+}
+
+void CtfeCompiler::patch(ArrayBase<void> *jumps)
+{
+    for (size_t i = 0; i < jumps->dim; i++)
+        patch((size_t)jumps->tdata()[i]);
+}
+
+unsigned CtfeCompiler::newReg()
+{
+    unsigned r = regtop++;
+    if (regtop > nregs)
+        nregs = regtop;
+    return r;
+}
+
+unsigned CtfeCompiler::constant(dinteger_t value)
+{
+    consts.write(&value, sizeof(value));
+    return consts.offset / sizeof(value) - 1;
+}
+
+/************************************
+ * Give local variable v a register for the rest of the function.
+ */
+
+unsigned CtfeCompiler::declare(VarDeclaration *v)
+{
+    unsigned r = newReg();
+    keep = regtop;
+    *(size_t *)_aaGet(&vars, v) = r + 1;
+    return r;
+}
+
+int CtfeCompiler::varReg(VarDeclaration *v)
+{
+    size_t r = (size_t)_aaGetRvalue(vars, v);
+    return r ? (int)(r - 1) : -1;
+}
+
+/************************************
+ * Compile expression e for its side effects, freeing its temporaries.
+ * Returns:
+ *      0 if it cannot be compiled
+ */
+
+int CtfeCompiler::expression(Expression *e)
+{
+    int r = e->ctfeCompile(this);
+    regtop = keep;
+    return r >= 0;
+}
+
+/************************************
+ * Compile a conditional jump op on e.
+ * Returns:
+ *      the jump to patch, -1 if e cannot be compiled
+ */
+
+int CtfeCompiler::condition(Expression *e, int op)
+{
+    if (!ctfeIntegral(e->type))
+        return -1;
+    int r = e->ctfeCompile(this);
+    regtop = keep;
+    if (r < 0)
+        return -1;
+    return emit(op, 0, r);
+}
+
+/************************************
+ * Compile the expression.
+ * Returns:
+ *      register holding the value, -1 if it cannot be compiled
+ */
+
+int Expression::ctfeCompile(CtfeCompiler *cc)
+{
+#if LOG
+    printf("%s CTFE bytecode: cannot compile %s %s\n", loc.toChars(), Token::toChars(op), toChars());
+#endif
+    return -1;
+}
+
+int IntegerExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!ctfeIntegral(type))
+        return Expression::ctfeCompile(cc);
+    unsigned r = cc->newReg();
+    cc->emit(CTFEloadk, r, cc->constant(toInteger()));
+    return r;
+}
+
+int VarExp::ctfeCompile(CtfeCompiler *cc)
+{
+    VarDeclaration *v = var->isVarDeclaration();
+    int r = v ? cc->varReg(v) : -1;
+    if (r < 0)
+        return Expression::ctfeCompile(cc);
+    return r;
+}
+
+int DeclarationExp::ctfeCompile(CtfeCompiler *cc)
+{
+    VarDeclaration *v = declaration->isVarDeclaration();
+    if (!v)
+    {
+        // Same as DeclarationExp::interpret()
+        if (declaration->isAttribDeclaration() ||
+            declaration->isTemplateMixin() ||
+            declaration->isTupleDeclaration())
+            return Expression::ctfeCompile(cc);
+        return cc->newReg();
+    }
+    if (v->storage_class & STCmanifest)
+        return cc->newReg();            // uses were replaced by the value
+    if (v->toAlias() != v || v->isDataseg() ||
+        v->storage_class & (STCout | STClazy) ||
+        !ctfeIntegral(v->type) || !v->init)
+        return Expression::ctfeCompile(cc);
+    ExpInitializer *ie = v->init->isExpInitializer();
+    if (!ie)
+        return Expression::ctfeCompile(cc);
+
+    /* The initializer is an assignment to v, possibly after a
+     * comma expression
+     */
+    Expression *e = ie->exp;
+    while (e->op == TOKcomma)
+        e = ((BinExp *)e)->e2;
+    if (!(e->op == TOKconstruct || e->op == TOKassign || e->op == TOKblit) ||
+        ((BinExp *)e)->e1->op != TOKvar ||
+        ((VarExp *)((BinExp *)e)->e1)->var != v)
+        return Expression::ctfeCompile(cc);
+
+    if (v->storage_class & STCref)
+    {   /* A ref to another local variable, as made for foreach,
+         * shares its register
+         */
+        Expression *e2 = ((BinExp *)e)->e2;
+        VarDeclaration *v2 = e2->op == TOKvar ? ((VarExp *)e2)->var->isVarDeclaration() : NULL;
+        int r2 = v2 ? cc->varReg(v2) : -1;
+        if (e != ie->exp || r2 < 0 || v2->type->toBasetype() != v->type->toBasetype())
+            return Expression::ctfeCompile(cc);
+        *(size_t *)_aaGet(&cc->vars, v) = r2 + 1;
+        return r2;
+    }
+
+    unsigned r = cc->declare(v);
+    if (ie->exp->ctfeCompile(cc) < 0)
+        return -1;
+    return r;
+}
+
+int UnaExp::ctfeCompile(CtfeCompiler *cc)
+{
+    int opcode;
+    switch (op)
+    {
+        case TOKneg:    opcode = CTFEneg;       goto Lunary;
+        case TOKtilde:  opcode = CTFEcom;       goto Lunary;
+        case TOKnot:    opcode = CTFEnot;       goto Lunary;
+        case TOKtobool:
+        case TOKcast:   opcode = CTFEcast;      goto Lunary;
+        Lunary:
+        {
+            int ty = ctfeIntegral(type);
+            if (!ty || !ctfeIntegral(e1->type))
+                break;
+            int r1 = e1->ctfeCompile(cc);
+            if (r1 < 0)
+                return -1;
+            unsigned r = cc->newReg();
+            cc->emit(opcode, r, r1, 0, ty);
+            return r;
+        }
+
+        case TOKassert:
+        {
+            if (!ctfeIntegral(e1->type))
+                break;
+            int r1 = e1->ctfeCompile(cc);
+            if (r1 < 0)
+                return -1;
+            cc->emit(CTFEassert, 0, r1);
+            return cc->newReg();
+        }
+
+        case TOKcall:
+        {
+            CallExp *ce = (CallExp *)this;
+            FuncDeclaration *f = ce->f;
+            if (!f || e1->op != TOKvar || ((VarExp *)e1)->var != f ||
+                f->needThis()
+#if DMDV2
+                || f->isBuiltin() != BUILTINnot
+#endif
+                )
+                break;
+            if (type->toBasetype()->ty != Tvoid && !ctfeIntegral(type))
+                break;
+
+            /* Evaluate the arguments into consecutive registers
+             */
+            size_t dim = ce->arguments ? ce->arguments->dim : 0;
+            unsigned base = cc->regtop;
+            for (size_t i = 0; i < dim; i++)
+                cc->newReg();
+            for (size_t i = 0; i < dim; i++)
+            {
+                Expression *earg = (*ce->arguments)[i];
+                if (!ctfeIntegral(earg->type))
+                    return Expression::ctfeCompile(cc);
+                int r = earg->ctfeCompile(cc);
+                if (r < 0)
+                    return -1;
+                cc->emit(CTFEmov, base + i, r);
+            }
+            unsigned r = cc->newReg();
+            cc->calls->push(f);
+            cc->emit(CTFEcall, r, base, cc->calls->dim - 1);
+            return r;
+        }
+
+        default:
+            break;
+    }
+    return Expression::ctfeCompile(cc);
+}
+
+int BinExp::ctfeCompile(CtfeCompiler *cc)
+{
+    int opcode;
+    int post = 0;
+    switch (op)
+    {
+        case TOKadd:            opcode = CTFEadd;       goto Lbinary;
+        case TOKmin:            opcode = CTFEmin;       goto Lbinary;
+        case TOKmul:            opcode = CTFEmul;       goto Lbinary;
+        case TOKdiv:            opcode = CTFEdiv;       goto Lbinary;
+        case TOKmod:            opcode = CTFEmod;       goto Lbinary;
+        case TOKshl:            opcode = CTFEshl;       goto Lbinary;
+        case TOKshr:            opcode = CTFEshr;       goto Lbinary;
+        case TOKushr:           opcode = CTFEushr;      goto Lbinary;
+        case TOKand:            opcode = CTFEand;       goto Lbinary;
+        case TOKor:             opcode = CTFEor;        goto Lbinary;
+        case TOKxor:            opcode = CTFExor;       goto Lbinary;
+        case TOKlt:             opcode = CTFElt;        goto Lbinary;
+        case TOKle:             opcode = CTFEle;        goto Lbinary;
+        case TOKgt:             opcode = CTFEgt;        goto Lbinary;
+        case TOKge:             opcode = CTFEge;        goto Lbinary;
+        case TOKequal:
+        case TOKidentity:       opcode = CTFEeq;        goto Lbinary;
+        case TOKnotequal:
+        case TOKnotidentity:    opcode = CTFEne;        goto Lbinary;
+        Lbinary:
+        {
+            int ty = ctfeIntegral(type);
+            int ty1 = ctfeIntegral(e1->type);
+            if (!ty || !ty1 || !ctfeIntegral(e2->type))
+                break;
+            int r1 = e1->ctfeCompile(cc);
+            if (r1 < 0)
+                return -1;
+            if (e2->hasSideEffect())
+            {   // e2 might change the variable r1 is
+                unsigned r = cc->newReg();
+                cc->emit(CTFEmov, r, r1);
+                r1 = r;
+            }
+            int r2 = e2->ctfeCompile(cc);
+            if (r2 < 0)
+                return -1;
+            unsigned r = cc->newReg();
+            size_t i = cc->emit(opcode, r, r1, r2, ty);
+            cc->instr(i)->ty1 = ty1;
+            cc->instr(i)->uns = e1->type->isunsigned() || e2->type->isunsigned();
+            return r;
+        }
+
+        case TOKandand:
+        case TOKoror:
+        {
+            if (!ctfeIntegral(e1->type) ||
+                !(ctfeIntegral(e2->type) || e2->type->toBasetype()->ty == Tvoid))
+                break;
+            unsigned r = cc->newReg();
+            int r1 = e1->ctfeCompile(cc);
+            if (r1 < 0)
+                return -1;
+            cc->emit(CTFEcast, r, r1, 0, Tbool);
+            size_t j = cc->emit(op == TOKandand ? CTFEjz : CTFEjnz, 0, r);
+            int r2 = e2->ctfeCompile(cc);
+            if (r2 < 0)
+                return -1;
+            if (e2->type->toBasetype()->ty != Tvoid)
+                cc->emit(CTFEcast, r, r2, 0, Tbool);
+            cc->patch(j);
+            return r;
+        }
+
+        case TOKcomma:
+            if (e1->ctfeCompile(cc) < 0)
+                return -1;
+            return e2->ctfeCompile(cc);
+
+        case TOKquestion:
+        {
+            CondExp *ce = (CondExp *)this;
+            int isvoid = type->toBasetype()->ty == Tvoid;
+            if (!ctfeIntegral(ce->econd->type) || !(isvoid || ctfeIntegral(type)))
+                break;
+            unsigned r = cc->newReg();
+            int rc = ce->econd->ctfeCompile(cc);
+            if (rc < 0)
+                return -1;
+            size_t j1 = cc->emit(CTFEjz, 0, rc);
+            int r1 = e1->ctfeCompile(cc);
+            if (r1 < 0)
+                return -1;
+            if (!isvoid)
+                cc->emit(CTFEmov, r, r1);
+            size_t j2 = cc->emit(CTFEjmp, 0);
+            cc->patch(j1);
+            int r2 = e2->ctfeCompile(cc);
+            if (r2 < 0)
+                return -1;
+            if (!isvoid)
+                cc->emit(CTFEmov, r, r2);
+            cc->patch(j2);
+            return r;
+        }
+
+        case TOKassign:
+        case TOKconstruct:
+        case TOKblit:
+        {
+            int ty = ctfeIntegral(e1->type);
+            if (!ty || !ctfeIntegral(e2->type) || e1->op != TOKvar)
+                break;
+            VarDeclaration *v = ((VarExp *)e1)->var->isVarDeclaration();
+            int rv = v ? cc->varReg(v) : -1;
+            if (rv < 0)
+                break;
+            int r2 = e2->ctfeCompile(cc);
+            if (r2 < 0)
+                return -1;
+            cc->emit(CTFEcast, rv, r2, 0, ty);
+            return rv;
+        }
+
+        case TOKplusplus:       opcode = CTFEadd; post = 1; goto Lopassign;
+        case TOKminusminus:     opcode = CTFEmin; post = 1; goto Lopassign;
+        case TOKaddass:         opcode = CTFEadd;       goto Lopassign;
+        case TOKminass:         opcode = CTFEmin;       goto Lopassign;
+        case TOKmulass:         opcode = CTFEmul;       goto Lopassign;
+        case TOKdivass:         opcode = CTFEdiv;       goto Lopassign;
+        case TOKmodass:         opcode = CTFEmod;       goto Lopassign;
+        case TOKshlass:         opcode = CTFEshl;       goto Lopassign;
+        case TOKshrass:         opcode = CTFEshr;       goto Lopassign;
+        case TOKushrass:        opcode = CTFEushr;      goto Lopassign;
+        case TOKandass:         opcode = CTFEand;       goto Lopassign;
+        case TOKorass:          opcode = CTFEor;        goto Lopassign;
+        case TOKxorass:         opcode = CTFExor;       goto Lopassign;
+        Lopassign:
+        {
+            /* e1 may be cast to the type of the operation,
+             * as in cast(int)b += 1 for a byte b
+             */
+            Expression *ev = e1;
+            while (ev->op == TOKcast)
+                ev = ((CastExp *)ev)->e1;
+            int ty = ctfeIntegral(type);
+            int tyv = ctfeIntegral(ev->type);
+            if (!ty || !tyv || !ctfeIntegral(e1->type) || !ctfeIntegral(e2->type) ||
+                ev->op != TOKvar)
+                break;
+            VarDeclaration *v = ((VarExp *)ev)->var->isVarDeclaration();
+            int rv = v ? cc->varReg(v) : -1;
+            if (rv < 0)
+                break;
+
+            /* Like BinExp::interpretAssignCommon(), evaluate e2 before
+             * getting the old value of the variable
+             */
+            int r2 = e2->ctfeCompile(cc);
+            if (r2 < 0)
+                return -1;
+            unsigned r = rv;
+            if (post)
+            {   r = cc->newReg();
+                cc->emit(CTFEmov, r, rv);
+            }
+            int differ = ty != tyv;
+            size_t i = cc->emit(opcode, differ && !post ? cc->newReg() : rv, rv, r2, ty);
+            cc->instr(i)->ty1 = tyv;
+            cc->instr(i)->uns = ev->type->isunsigned() || e2->type->isunsigned();
+            if (differ)
+            {   if (!post)
+                    r = cc->instr(i)->a;
+                cc->emit(CTFEcast, rv, cc->instr(i)->a, 0, tyv);
+            }
+            return r;
+        }
+
+        default:
+            break;
+    }
+    return Expression::ctfeCompile(cc);
+}
+
+/************************************
+ * Compile the statement.
+ * Returns:
+ *      0 if it cannot be compiled
+ */
+
+int Statement::ctfeCompile(CtfeCompiler *cc)
+{
+#if LOG
+    printf("%s CTFE bytecode: cannot compile statement %s\n", loc.toChars(), toChars());
+#endif
+    return 0;
+}
+
+int ExpStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    return !exp || cc->expression(exp);
+}
+
+int CompoundStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    for (size_t i = 0; i < statements->dim; i++)
+    {   Statement *s = (*statements)[i];
+        if (s && !s->ctfeCompile(cc))
+            return 0;
+    }
+    return 1;
+}
+
+int ScopeStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    return !statement || statement->ctfeCompile(cc);
+}
+
+int IfStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (match)
+        return Statement::ctfeCompile(cc);
+    int j = cc->condition(condition, CTFEjz);
+    if (j < 0)
+        return 0;
+    if (ifbody && !ifbody->ctfeCompile(cc))
+        return 0;
+    if (elsebody)
+    {
+        size_t j2 = cc->emit(CTFEjmp, 0);
+        cc->patch(j);
+        if (!elsebody->ctfeCompile(cc))
+            return 0;
+        cc->patch(j2);
+    }
+    else
+        cc->patch(j);
+    return 1;
+}
+
+int ForStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (init && !init->ctfeCompile(cc))
+        return 0;
+
+    CtfeLoop loop;
+    loop.outer = cc->loop;
+    cc->loop = &loop;
+
+    int result = 0;
+    size_t top = cc->here();
+    int jexit = -1;
+    if (condition)
+    {
+        jexit = cc->condition(condition, CTFEjz);
+        if (jexit < 0)
+            goto Lret;
+    }
+    if (body && !body->ctfeCompile(cc))
+        goto Lret;
+    cc->patch(&loop.continues);
+    if (increment && !cc->expression(increment))
+        goto Lret;
+    cc->emit(CTFEjmp, top);
+    if (jexit >= 0)
+        cc->patch(jexit);
+    cc->patch(&loop.breaks);
+    result = 1;
+
+Lret:
+    cc->loop = loop.outer;
+    return result;
+}
+
+int DoStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    CtfeLoop loop;
+    loop.outer = cc->loop;
+    cc->loop = &loop;
+
+    int result = 0;
+    size_t top = cc->here();
+    int j;
+    if (body && !body->ctfeCompile(cc))
+        goto Lret;
+    cc->patch(&loop.continues);
+    j = cc->condition(condition, CTFEjnz);
+    if (j < 0)
+        goto Lret;
+    cc->instr(j)->a = top;
+    cc->patch(&loop.breaks);
+    result = 1;
+
+Lret:
+    cc->loop = loop.outer;
+    return result;
+}
+
+int ReturnStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!exp)
+        cc->emit(CTFEretvoid, 0);
+    else if (exp->type->toBasetype()->ty == Tvoid)
+    {
+        if (!cc->expression(exp))
+            return 0;
+        cc->emit(CTFEretvoid, 0);
+    }
+    else
+    {
+        if (!ctfeIntegral(exp->type))
+            return Statement::ctfeCompile(cc);
+        int r = exp->ctfeCompile(cc);
+        cc->regtop = cc->keep;
+        if (r < 0)
+            return 0;
+        cc->returns->push(exp);
+        cc->emit(CTFEret, r, cc->returns->dim - 1);
+    }
+    return 1;
+}
+
+int BreakStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (ident || !cc->loop)
+        return Statement::ctfeCompile(cc);
+    cc->loop->breaks.push((void *)cc->emit(CTFEjmp, 0));
+    return 1;
+}
+
+int ContinueStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (ident || !cc->loop)
+        return Statement::ctfeCompile(cc);
+    cc->loop->continues.push((void *)cc->emit(CTFEjmp, 0));
+    return 1;
+}
+
+/************************************** CtfeCode ************************/
+
+/************************************
+ * Compile fd.
+ * Returns:
+ *      the code, with instrs == NULL if fd cannot be compiled
+ */
+
+static CtfeCode *ctfeCompileFunction(FuncDeclaration *fd)
+{
+#if LOG
+    printf("ctfeCompileFunction(%s)\n", fd->toChars());
+#endif
+    CtfeCode *code = new CtfeCode();
+    memset(code, 0, sizeof(CtfeCode));
+    code->fd = fd;
+
+    Type *tb = fd->type->toBasetype();
+    if (!fd->fbody || fd->needThis() || fd->vresult || tb->ty != Tfunction)
+        return code;
+    TypeFunction *tf = (TypeFunction *)tb;
+    if (tf->varargs ||
+        !(tf->next->toBasetype()->ty == Tvoid || ctfeIntegral(tf->next)))
+        return code;
+
+    CtfeCompiler cc(fd);
+    size_t nparams = Parameter::dim(tf->parameters);
+    if (nparams && (!fd->parameters || fd->parameters->dim != nparams))
+        return code;
+    for (size_t i = 0; i < nparams; i++)
+    {   VarDeclaration *v = (*fd->parameters)[i];
+        if (v->storage_class & (STCref | STCout | STClazy) ||
+            !ctfeIntegral(v->type))
+            return code;
+        cc.declare(v);
+    }
+
+    if (!fd->fbody->ctfeCompile(&cc))
+        return code;
+
+    // Falling off the end
+    if (tf->next->toBasetype()->ty == Tvoid)
+        cc.emit(CTFEretvoid, 0);
+    else
+        cc.emit(CTFEfail, 0);
+
+    code->ninstrs = cc.here();
+    code->instrs = (CtfeInstr *)cc.code.extractData();
+    code->nregs = cc.nregs;
+    code->nparams = nparams;
+    code->consts = (dinteger_t *)cc.consts.extractData();
+    code->calls = cc.calls;
+    code->returns = cc.returns;
+#if LOG
+    printf("\t%d instructions, %d registers\n", (int)code->ninstrs, code->nregs);
+#endif
+    return code;
+}
+
+/************************************
+ * Get the bytecode for fd, compiling it the first time.
+ * Returns:
+ *      NULL if fd is to be run by the interpreter instead
+ */
+
+CtfeCode *CtfeCode::get(FuncDeclaration *fd)
+{
+    if (!fd->ctfeCode)
+    {
+        if (fd->semanticRun < PASSsemantic3done || fd->semantic3Errors)
+            return NULL;
+        fd->ctfeCode = ctfeCompileFunction(fd);
+    }
+    CtfeCode *code = fd->ctfeCode;
+    return (code->instrs && !code->broken) ? code : NULL;
+}
+
+/************************************
+ * Call the function with the interpreted arguments.
+ * Returns:
+ *      result, EXP_VOID_INTERPRET, or
+ *      NULL if it failed and must be left to the interpreter
+ */
+
+Expression *CtfeCode::interpret(Expressions *arguments)
+{
+    size_t dim = arguments ? arguments->dim : 0;
+    assert(dim == nparams);
+    dinteger_t *args = (dinteger_t *)mem.malloc((dim + 1) * sizeof(dinteger_t));
+    for (size_t i = 0; i < dim; i++)
+    {   Expression *earg = (*arguments)[i];
+        if (earg->op != TOKint64)
+        {   mem.free(args);
+            return NULL;
+        }
+        args[i] = earg->toInteger();
+    }
+
+    dinteger_t result;
+    Expression *ret;
+    int ok = execute(args, &result, &ret, CtfeStatus::callDepth + 1);
+    mem.free(args);
+    if (!ok)
+        return NULL;
+    if (!ret)
+        return EXP_VOID_INTERPRET;
+    return new IntegerExp(ret->loc, result, ret->type);
+}
+
+/* All frames live in one stack of registers, which may move
+ * as it grows.
+ */
+static dinteger_t *ctfeRegs;
+static size_t ctfeRegsDim;
+static size_t ctfeRegsTop;
+
+/************************************
+ * Run the code.
+ * Input:
+ *      args    values of the parameters
+ *      depth   of calls, counting this one
+ * Output:
+ *      *result value returned
+ *      *ret    return expression, NULL for a void return
+ * Returns:
+ *      0 if it failed, and must be left to the interpreter
+ */
+
+int CtfeCode::execute(dinteger_t *args, dinteger_t *result, Expression **ret, int depth)
+{
+    if (depth > CTFE_RECURSION_LIMIT)
+        return 0;
+
+    size_t frame = ctfeRegsTop;
+    if (frame + nregs > ctfeRegsDim)
+    {   size_t argsofs = args - ctfeRegs;
+        int argsinstack = args >= ctfeRegs && args < ctfeRegs + ctfeRegsDim;
+        ctfeRegsDim = (frame + nregs) * 2 + 64;
+        ctfeRegs = (dinteger_t *)mem.realloc(ctfeRegs, ctfeRegsDim * sizeof(dinteger_t));
+        if (argsinstack)
+            args = ctfeRegs + argsofs;
+    }
+    ctfeRegsTop = frame + nregs;
+    dinteger_t *regs = ctfeRegs + frame;
+    memcpy(regs, args, nparams * sizeof(dinteger_t));
+
+#define B       regs[ci->b]
+#define C       regs[ci->c]
+    CtfeInstr *pc = instrs;
+    while (1)
+    {
+        CtfeInstr *ci = pc++;
+        dinteger_t b, c;
+        switch (ci->op)
+        {
+            case CTFEloadk:     regs[ci->a] = consts[ci->b];                    break;
+            case CTFEmov:       regs[ci->a] = B;                                break;
+            case CTFEcast:      regs[ci->a] = ctfeNormalize(ci->ty, B);         break;
+            case CTFEneg:       regs[ci->a] = ctfeNormalize(ci->ty, -B);        break;
+            case CTFEcom:       regs[ci->a] = ctfeNormalize(ci->ty, ~B);        break;
+            case CTFEnot:       regs[ci->a] = B == 0;                           break;
+
+            case CTFEadd:       regs[ci->a] = ctfeNormalize(ci->ty, B + C);     break;
+            case CTFEmin:       regs[ci->a] = ctfeNormalize(ci->ty, B - C);     break;
+            case CTFEmul:       regs[ci->a] = ctfeNormalize(ci->ty, B * C);     break;
+            case CTFEand:       regs[ci->a] = ctfeNormalize(ci->ty, B & C);     break;
+            case CTFEor:        regs[ci->a] = ctfeNormalize(ci->ty, B | C);     break;
+            case CTFExor:       regs[ci->a] = ctfeNormalize(ci->ty, B ^ C);     break;
+
+            case CTFEdiv:
+            case CTFEmod:
+                b = B;
+                c = C;
+                /* Leave the errors of constfold.c's Div() and Mod()
+                 * to the interpreter
+                 */
+                if (c == 0)
+                    goto Lfail;
+                if (ci->uns)
+                    b = ci->op == CTFEdiv ? b / c : b % c;
+                else
+                {   if ((sinteger_t)c == -1 &&
+                        (b == 0x8000000000000000ULL || b == 0xFFFFFFFF80000000ULL))
+                        goto Lfail;
+                    b = ci->op == CTFEdiv ? (sinteger_t)b / (sinteger_t)c
+                                          : (sinteger_t)b % (sinteger_t)c;
+                }
+                regs[ci->a] = ctfeNormalize(ci->ty, b);
+                break;
+
+            case CTFEshl:
+                b = B;
+                c = C;
+                if (c >= 64)
+                    goto Lfail;
+                regs[ci->a] = ctfeNormalize(ci->ty, b << c);
+                break;
+
+            case CTFEshr:
+                // Same as constfold.c's Shr()
+                b = B;
+                c = C;
+                if (c >= 64)
+                    goto Lfail;
+                switch (ci->ty1)
+                {
+                    case Tint8: case Tint16: case Tint32: case Tint64:
+                        b = (sinteger_t)ctfeNormalize(ci->ty1, b) >> c;
+                        break;
+                    default:
+                        b = ctfeNormalize(ci->ty1, b) >> c;
+                        break;
+                }
+                regs[ci->a] = ctfeNormalize(ci->ty, b);
+                break;
+
+            case CTFEushr:
+                // Same as constfold.c's Ushr()
+                b = B;
+                c = C;
+                if (c >= 64)
+                    goto Lfail;
+                switch (ci->ty1)
+                {
+                    case Tint8: case Tuns8: case Tchar:
+                        b &= 0xFF;
+                        break;
+                    case Tint16: case Tuns16: case Twchar:
+                        b &= 0xFFFF;
+                        break;
+                    case Tint32: case Tuns32: case Tdchar:
+                        b &= 0xFFFFFFFF;
+                        break;
+                }
+                regs[ci->a] = ctfeNormalize(ci->ty, b >> c);
+                break;
+
+            case CTFElt:
+                regs[ci->a] = ci->uns ? B < C : (sinteger_t)B < (sinteger_t)C;
+                break;
+            case CTFEle:
+                regs[ci->a] = ci->uns ? B <= C : (sinteger_t)B <= (sinteger_t)C;
+                break;
+            case CTFEgt:
+                regs[ci->a] = ci->uns ? B > C : (sinteger_t)B > (sinteger_t)C;
+                break;
+            case CTFEge:
+                regs[ci->a] = ci->uns ? B >= C : (sinteger_t)B >= (sinteger_t)C;
+                break;
+            case CTFEeq:        regs[ci->a] = B == C;                           break;
+            case CTFEne:        regs[ci->a] = B != C;                           break;
+
+            case CTFEjmp:       pc = instrs + ci->a;                            break;
+            case CTFEjz:        if (!B) pc = instrs + ci->a;                    break;
+            case CTFEjnz:       if (B) pc = instrs + ci->a;                     break;
+
+            case CTFEcall:
+            {
+                CtfeCode *callee = get((*calls)[ci->c]);
+                if (!callee)
+                {   // No use trying this again
+                    broken = true;
+                    goto Lfail;
+                }
+                dinteger_t r;
+                Expression *e;
+                if (!callee->execute(regs + ci->b, &r, &e, depth + 1))
+                    goto Lfail;
+                regs = ctfeRegs + frame;
+                regs[ci->a] = r;
+                break;
+            }
+
+            case CTFEassert:
+                if (!B)
+                    goto Lfail;
+                break;
+
+            case CTFEret:
+                *result = regs[ci->a];
+                *ret = (*returns)[ci->b];
+                goto Lret;
+
+            case CTFEretvoid:
+                *result = 0;
+                *ret = NULL;
+                goto Lret;
+
+            case CTFEfail:
+                goto Lfail;
+
+            default:
+                assert(0);
+        }
+    }
+
+Lret:
+    ctfeRegsTop = frame;
+    return 1;
+
+Lfail:
+    ctfeRegsTop = frame;
+    return 0;
+}
+
+#undef B
+#undef C
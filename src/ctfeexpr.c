@@ -13,6 +13,7 @@
 #include <string.h>                     // mem{cpy|set}()
 
 #include "rmem.h"
+#include "aav.h"
 
 #include "expression.h"
 #include "declaration.h"
@@ -1450,13 +1451,200 @@ int ctfeCmp(Loc loc, enum TOK op, Expression *e1, Expression *e2)
     return n;
 }
 
+/******** Growable array literals ***************************/
+
+/* Appending to an array, or increasing its length, would copy all of its
+ * elements, making an array built up one element at a time cost O(n^2).
+ * Instead, the elements of such an array are put in a block with room
+ * to spare, and the longer array shares the block with the shorter one.
+ * Only the array that is 'used' elements long can grow into the block,
+ * and an array that shares elements another array can see gives itself
+ * a copy of them before modifying one.
+ *
+ * A block is either the data[] of the Expressions of ArrayLiteralExps, or
+ * the string of StringExps (but only immutable ones, which are never
+ * modified). The Expressions have no room of their own for elements, so
+ * must never be resized; they are replaced when they leave CTFE.
+ */
+
+struct CtfeBlock
+{
+    size_t capacity;    // number of elements there is room for
+    size_t used;        // length of the longest array in the block
+    size_t shared;      // elements [0 .. shared] of it are also in a shorter array
+};
+
+static AA *ctfeBlocks;  // start of block => CtfeBlock
+
+static CtfeBlock *findBlock(void *data)
+{
+    return (CtfeBlock *)_aaGetRvalue(ctfeBlocks, data);
+}
+
+/* Allocate a block with room for at least newlen elements of size sz,
+ * plus a terminating 0 for strings, and copy oldlen elements from olddata.
+ */
+static void *newBlock(void *olddata, size_t oldlen, size_t newlen, size_t sz)
+{
+    CtfeBlock *b = new CtfeBlock();
+    b->capacity = newlen < 8 ? 16 : newlen * 2;
+    b->used = newlen;
+    b->shared = 0;
+    void *data = mem.malloc((b->capacity + 1) * sz);
+    if (oldlen)
+        memcpy(data, olddata, oldlen * sz);
+    *_aaGet(&ctfeBlocks, data) = b;
+    ++CtfeStatus::numArrayAllocs;
+    return data;
+}
+
+/* Return a copy of ae with its length increased to newlen, and
+ * elements [ae.length .. newlen] uninitialized. ae may be NULL.
+ */
+static ArrayLiteralExp *growArrayLiteral(Loc loc, Type *type,
+        ArrayLiteralExp *ae, size_t newlen)
+{
+    size_t oldlen = ae ? ae->elements->dim : 0;
+    void **data = ae ? ae->elements->data : NULL;
+    CtfeBlock *b = ae ? findBlock(data) : NULL;
+    if (b && b->used == oldlen && newlen <= b->capacity)
+    {   b->used = newlen;
+        b->shared = oldlen;
+    }
+    else
+        data = (void **)newBlock(data, oldlen, newlen, sizeof(void *));
+    Expressions *elements = new Expressions();
+    elements->data = data;
+    elements->dim = newlen;
+    ArrayLiteralExp *r = new ArrayLiteralExp(loc, elements);
+    r->type = type;
+    r->ownedByCtfe = true;
+    return r;
+}
+
+/* Same for the string se. The caller must also set the terminating 0.
+ */
+static StringExp *growStringLiteral(Loc loc, Type *type,
+        StringExp *se, size_t newlen)
+{
+    size_t oldlen = se->len;
+    void *s = se->string;
+    CtfeBlock *b = findBlock(s);
+    if (b && b->used == oldlen && newlen <= b->capacity)
+        b->used = newlen;
+    else
+        s = newBlock(s, oldlen, newlen, se->sz);
+    StringExp *r = new StringExp(loc, s, newlen);
+    r->type = type;
+    r->sz = se->sz;
+    r->ownedByCtfe = true;
+    return r;
+}
+
+/* If e1 ~ e2 is an array built from an ArrayLiteralExp or immutable
+ * string e1, return it, otherwise NULL.
+ * Mirrors the cases of Cat() which produce such an array.
+ */
+static Expression *catGrowable(Type *type, Expression *e1, Expression *e2)
+{
+    Type *tb = type->toBasetype();
+    if (tb->ty != Tarray)
+        return NULL;
+    Type *t1 = e1->type->toBasetype();
+    Type *t2 = e2->type->toBasetype();
+    Loc loc = e1->loc;
+    if (e1->op == TOKarrayliteral && e2->op == TOKarrayliteral &&
+        t1->nextOf()->equals(t2->nextOf()))
+    {
+        ArrayLiteralExp *ae1 = (ArrayLiteralExp *)e1;
+        Expressions *elems2 = ((ArrayLiteralExp *)e2)->elements;
+        size_t len1 = ae1->elements->dim;
+        ArrayLiteralExp *ae = growArrayLiteral(loc, type, ae1, len1 + elems2->dim);
+        memcpy(ae->elements->data + len1, elems2->data, elems2->dim * sizeof(void *));
+        return ae;
+    }
+    if (e1->op == TOKarrayliteral && e2->op != TOKnull &&
+        t1->nextOf()->equals(e2->type))
+    {
+        ArrayLiteralExp *ae1 = (ArrayLiteralExp *)e1;
+        size_t len1 = ae1->elements->dim;
+        ArrayLiteralExp *ae = growArrayLiteral(loc, type, ae1, len1 + 1);
+        (*ae->elements)[len1] = e2;
+        return ae;
+    }
+    if (e1->op == TOKstring && t1->ty == Tarray &&
+        t1->nextOf()->isImmutable() && tb->nextOf()->isImmutable())
+    {
+        StringExp *es1 = (StringExp *)e1;
+        size_t sz = es1->sz;
+        StringExp *es;
+        if (e2->op == TOKstring && ((StringExp *)e2)->sz == sz)
+        {
+            StringExp *es2 = (StringExp *)e2;
+            es = growStringLiteral(loc, type, es1, es1->len + es2->len);
+            memcpy((unsigned char *)es->string + es1->len * sz, es2->string, es2->len * sz);
+            es->committed = es1->committed | es2->committed;
+        }
+        else if (e2->op == TOKint64 && t2->size() == sz)
+        {
+            dinteger_t v = e2->toInteger();
+            es = growStringLiteral(loc, type, es1, es1->len + 1);
+            memcpy((unsigned char *)es->string + es1->len * sz, &v, sz);
+            es->committed = es1->committed;
+        }
+        else
+            return NULL;
+        memset((unsigned char *)es->string + es->len * sz, 0, sz);
+        return es;
+    }
+    return NULL;
+}
+
+/* The elements of ae from lwr on are about to be modified. If another
+ * array can see any of them, give ae a block of its own.
+ */
+void unshareArrayLiteral(ArrayLiteralExp *ae, size_t lwr)
+{
+    Expressions *elements = ae->elements;
+    CtfeBlock *b = findBlock(elements->data);
+    if (!b || (b->used == elements->dim && lwr >= b->shared))
+        return;
+    // Modify the Expressions in place, as copies of ae share it
+    elements->data = (void **)newBlock(elements->data,
+        elements->dim, elements->dim, sizeof(void *));
+}
+
+/* e is leaving CTFE. If it is in a block, give it a normal
+ * array or string of its own.
+ */
+void unshareLiteral(Expression *e)
+{
+    if (e->op == TOKarrayliteral)
+    {   ArrayLiteralExp *ae = (ArrayLiteralExp *)e;
+        if (findBlock(ae->elements->data))
+            ae->elements = (Expressions *)ae->elements->copy();
+    }
+    else if (e->op == TOKstring)
+    {   StringExp *se = (StringExp *)e;
+        if (findBlock(se->string))
+        {   size_t size = se->len * se->sz;
+            void *s = mem.malloc(size + se->sz);
+            memcpy(s, se->string, size);
+            memset((unsigned char *)s + size, 0, se->sz);
+            se->string = s;
+        }
+    }
+}
+
 
 Expression *ctfeCat(Type *type, Expression *e1, Expression *e2)
 {
     Loc loc = e1->loc;
     Type *t1 = e1->type->toBasetype();
     Type *t2 = e2->type->toBasetype();
-    Expression *e;
+    Expression *e = catGrowable(type, e1, e2);
+    if (e)
+        return e;
     if (e2->op == TOKstring && e1->op == TOKarrayliteral &&
         t1->nextOf()->isintegral())
     {
@@ -1612,6 +1800,7 @@ void assignInPlace(Expression *dest, Expression *src)
     }
     else if (dest->op == TOKarrayliteral && src->op==TOKarrayliteral)
     {
+        unshareArrayLiteral((ArrayLiteralExp *)dest, 0);
         oldelems = ((ArrayLiteralExp *)dest)->elements;
         newelems = ((ArrayLiteralExp *)src)->elements;
     }
@@ -1622,6 +1811,7 @@ void assignInPlace(Expression *dest, Expression *src)
     }
     else if (dest->op == TOKarrayliteral && src->op == TOKstring)
     {
+        unshareArrayLiteral((ArrayLiteralExp *)dest, 0);
         sliceAssignArrayLiteralFromString((ArrayLiteralExp *)dest, (StringExp *)src, 0);
         return;
     }
@@ -1668,6 +1858,7 @@ void recursiveBlockAssign(ArrayLiteralExp *ae, Expression *val, bool wantRef)
     bool cow = !(val->op == TOKstructliteral || val->op == TOKarrayliteral
         || val->op == TOKstring);
 
+    unshareArrayLiteral(ae, 0);
     for (size_t k = 0; k < ae->elements->dim; k++)
     {
         if (!directblk && ae->elements->tdata()[k]->op == TOKarrayliteral)
@@ -1750,8 +1941,6 @@ Expression *changeArrayLiteralLength(Loc loc, TypeArray *arrayType,
     Type *elemType = elemType = arrayType->next;
     assert(elemType);
     Expression *defaultElem = elemType->defaultInitLiteral(loc);
-    Expressions *elements = new Expressions();
-    elements->setDim(newlen);
 
     // Resolve slices
     size_t indxlo = 0;
@@ -1788,8 +1977,24 @@ Expression *changeArrayLiteralLength(Loc loc, TypeArray *arrayType,
         if (oldlen !=0)
             assert(oldval->op == TOKarrayliteral);
         ArrayLiteralExp *ae = (ArrayLiteralExp *)oldval;
-        for (size_t i = 0; i < copylen; i++)
-            (*elements)[i] = (*ae->elements)[indxlo + i];
+        ArrayLiteralExp *aae;
+        Expressions *elements;
+        if (newlen > oldlen && indxlo == 0 &&
+            (oldlen == 0 || ae->elements->dim == oldlen))
+        {   // Grow it in place, if it can be
+            aae = growArrayLiteral(loc, arrayType, oldlen ? ae : NULL, newlen);
+            elements = aae->elements;
+        }
+        else
+        {
+            elements = new Expressions();
+            elements->setDim(newlen);
+            for (size_t i = 0; i < copylen; i++)
+                (*elements)[i] = (*ae->elements)[indxlo + i];
+            aae = new ArrayLiteralExp(loc, elements);
+            aae->type = arrayType;
+            aae->ownedByCtfe = true;
+        }
         if (elemType->ty == Tstruct || elemType->ty == Tsarray)
         {   /* If it is an aggregate literal representing a value type,
              * we need to create a unique copy for each element
@@ -1802,9 +2007,6 @@ Expression *changeArrayLiteralLength(Loc loc, TypeArray *arrayType,
             for (size_t i = copylen; i < newlen; i++)
                 (*elements)[i] = defaultElem;
         }
-        ArrayLiteralExp *aae = new ArrayLiteralExp(loc, elements);
-        aae->type = arrayType;
-        aae->ownedByCtfe = true;
         return aae;
     }
 }
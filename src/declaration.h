@@ -31,6 +31,7 @@ struct ExpInitializer;
 struct StructDeclaration;
 struct TupleType;
 struct InterState;
+struct CtfeCode;
 struct IRState;
 
 enum PROT;
@@ -585,6 +586,7 @@ struct FuncDeclaration : Declaration
     bool isArrayOp;                     // !=0 if array operation
     enum PASS semanticRun;
     int semantic3Errors;                // !=0 if errors in semantic3
+    CtfeCode *ctfeCode;                 // compiled for CTFE, NULL if not yet
                                         // this function's frame ptr
     ForeachStatement *fes;              // if foreach body, this is the foreach
     bool introducing;                   // !=0 if 'introducing' function
@@ -681,6 +683,7 @@ struct FuncDeclaration : Declaration
     Expression *interpret(InterState *istate, Expressions *arguments, Expression *thisexp = NULL);
     void inlineScan();
     int canInline(int hasthis, int hdrscan, int statementsToo);
+    void inlineSemantic3();
     Expression *expandInline(InlineScanState *iss, Expression *ethis, Expressions *arguments, Statement **ps);
     const char *kind();
     void toDocBuffer(OutBuffer *buf, Scope *sc);
@@ -14,7 +14,6 @@
 
 #include "rmem.h"
 #include "speller.h"
-#include "aav.h"
 
 #include "mars.h"
 #include "dsymbol.h"
@@ -819,6 +818,8 @@ const char *OverloadSet::kind()
 
 /********************************* ScopeDsymbol ****************************/
 
+unsigned ScopeDsymbol::importsGeneration;
+
 ScopeDsymbol::ScopeDsymbol()
     : Dsymbol()
 {
@@ -826,6 +827,8 @@ ScopeDsymbol::ScopeDsymbol()
     symtab = NULL;
     imports = NULL;
     prots = NULL;
+    importcache = NULL;
+    importcachegen = 0;
 }
 
 ScopeDsymbol::ScopeDsymbol(Identifier *id)
@@ -835,6 +838,8 @@ ScopeDsymbol::ScopeDsymbol(Identifier *id)
     symtab = NULL;
     imports = NULL;
     prots = NULL;
+    importcache = NULL;
+    importcachegen = 0;
 }
 
 Dsymbol *ScopeDsymbol::syntaxCopy(Dsymbol *s)
@@ -864,92 +869,7 @@ Dsymbol *ScopeDsymbol::search(Loc loc, Identifier *ident, int flags)
     }
     else if (imports)
     {
-        OverloadSet *a = NULL;
-
-        // Look in imported modules
-        for (size_t i = 0; i < imports->dim; i++)
-        {   Dsymbol *ss = (*imports)[i];
-            Dsymbol *s2;
-
-            // If private import, don't search it
-            if (flags & 1 && prots[i] == PROTprivate)
-                continue;
-
-            //printf("\tscanning import '%s', prots = %d, isModule = %p, isImport = %p\n", ss->toChars(), prots[i], ss->isModule(), ss->isImport());
-            /* Don't find private members if ss is a module
-             */
-            s2 = ss->search(loc, ident, ss->isModule() ? 1 : 0);
-            if (!s)
-                s = s2;
-            else if (s2 && s != s2)
-            {
-                if (s->toAlias() == s2->toAlias() ||
-                    s->getType() == s2->getType() && s->getType())
-                {
-                    /* After following aliases, we found the same
-                     * symbol, so it's not an ambiguity.  But if one
-                     * alias is deprecated or less accessible, prefer
-                     * the other.
-                     */
-                    if (s->isDeprecated() ||
-                        s2->prot() > s->prot() && s2->prot() != PROTnone)
-                        s = s2;
-                }
-                else
-                {
-                    /* Two imports of the same module should be regarded as
-                     * the same.
-                     */
-                    Import *i1 = s->isImport();
-                    Import *i2 = s2->isImport();
-                    if (!(i1 && i2 &&
-                          (i1->mod == i2->mod ||
-                           (!i1->parent->isImport() && !i2->parent->isImport() &&
-                            i1->ident->equals(i2->ident))
-                          )
-                         )
-                       )
-                    {
-                        /* If both s2 and s are overloadable (though we only
-                         * need to check s once)
-                         */
-                        if (s2->isOverloadable() && (a || s->isOverloadable()))
-                        {   if (!a)
-                                a = new OverloadSet();
-                            /* Don't add to a[] if s2 is alias of previous sym
-                             */
-                            for (size_t j = 0; j < a->a.dim; j++)
-                            {   Dsymbol *s3 = a->a[j];
-                                if (s2->toAlias() == s3->toAlias())
-                                {
-                                    if (s3->isDeprecated() ||
-                                        s2->prot() > s3->prot() && s2->prot() != PROTnone)
-                                        a->a[j] = s2;
-                                    goto Lcontinue;
-                                }
-                            }
-                            a->push(s2);
-                        Lcontinue:
-                            continue;
-                        }
-                        if (flags & 4)          // if return NULL on ambiguity
-                            return NULL;
-                        if (!(flags & 2))
-                            ScopeDsymbol::multiplyDefined(loc, s, s2);
-                        break;
-                    }
-                }
-            }
-        }
-
-        /* Build special symbol if we had multiple finds
-         */
-        if (a)
-        {   assert(s);
-            a->push(s);
-            s = a;
-        }
-
+        s = searchImports(loc, ident, flags);
         if (s)
         {
             if (!(flags & 2))
@@ -978,6 +898,135 @@ Dsymbol *ScopeDsymbol::search(Loc loc, Identifier *ident, int flags)
     return s;
 }
 
+/*******************************************
+ * Look for ident in the imports of this scope, as search() does.
+ * For a search from this scope, rather than through an import of it,
+ * what is found, or not found, is remembered until an import, or a
+ * symbol that could be imported, is added anywhere. It isn't when
+ * two imports had the ident, there was an error, or a module being
+ * searched was reached again and so wasn't searched.
+ * Remembering the searches through imports too costs more than it
+ * saves, as they're much less often repeated.
+ */
+
+Dsymbol *ScopeDsymbol::searchImports(Loc loc, Identifier *ident, int flags)
+{
+    bool cacheable = !(flags & 1);
+    if (cacheable)
+    {
+        if (importcachegen != importsGeneration)
+        {   delete importcache;
+            importcache = NULL;
+            importcachegen = importsGeneration;
+        }
+        else if (importcache)
+        {   Dsymbol **ps = importcache->find(ident);
+            if (ps)
+                return *ps;
+        }
+    }
+
+    Dsymbol *s = NULL;
+    unsigned errors = global.errors;
+    unsigned cutoffs = Module::searchCutoffs;
+    OverloadSet *a = NULL;
+
+    // Look in imported modules
+    for (size_t i = 0; i < imports->dim; i++)
+    {   Dsymbol *ss = (*imports)[i];
+        Dsymbol *s2;
+
+        // If private import, don't search it
+        if (flags & 1 && prots[i] == PROTprivate)
+            continue;
+
+        //printf("\tscanning import '%s', prots = %d, isModule = %p, isImport = %p\n", ss->toChars(), prots[i], ss->isModule(), ss->isImport());
+        /* Don't find private members if ss is a module
+         */
+        s2 = ss->search(loc, ident, ss->isModule() ? 1 : 0);
+        if (!s)
+            s = s2;
+        else if (s2 && s != s2)
+        {
+            cacheable = false;
+            if (s->toAlias() == s2->toAlias() ||
+                s->getType() == s2->getType() && s->getType())
+            {
+                /* After following aliases, we found the same
+                 * symbol, so it's not an ambiguity.  But if one
+                 * alias is deprecated or less accessible, prefer
+                 * the other.
+                 */
+                if (s->isDeprecated() ||
+                    s2->prot() > s->prot() && s2->prot() != PROTnone)
+                    s = s2;
+            }
+            else
+            {
+                /* Two imports of the same module should be regarded as
+                 * the same.
+                 */
+                Import *i1 = s->isImport();
+                Import *i2 = s2->isImport();
+                if (!(i1 && i2 &&
+                      (i1->mod == i2->mod ||
+                       (!i1->parent->isImport() && !i2->parent->isImport() &&
+                        i1->ident->equals(i2->ident))
+                      )
+                     )
+                   )
+                {
+                    /* If both s2 and s are overloadable (though we only
+                     * need to check s once)
+                     */
+                    if (s2->isOverloadable() && (a || s->isOverloadable()))
+                    {   if (!a)
+                            a = new OverloadSet();
+                        /* Don't add to a[] if s2 is alias of previous sym
+                         */
+                        for (size_t j = 0; j < a->a.dim; j++)
+                        {   Dsymbol *s3 = a->a[j];
+                            if (s2->toAlias() == s3->toAlias())
+                            {
+                                if (s3->isDeprecated() ||
+                                    s2->prot() > s3->prot() && s2->prot() != PROTnone)
+                                    a->a[j] = s2;
+                                goto Lcontinue;
+                            }
+                        }
+                        a->push(s2);
+                    Lcontinue:
+                        continue;
+                    }
+                    if (flags & 4)          // if return NULL on ambiguity
+                        return NULL;
+                    if (!(flags & 2))
+                        ScopeDsymbol::multiplyDefined(loc, s, s2);
+                    break;
+                }
+            }
+        }
+    }
+
+    /* Build special symbol if we had multiple finds
+     */
+    if (a)
+    {   assert(s);
+        a->push(s);
+        s = a;
+    }
+
+    if (cacheable && errors == global.errors && cutoffs == Module::searchCutoffs &&
+        importcachegen == importsGeneration)
+    {
+        if (!importcache)
+            importcache = new DsymbolTable();
+        *importcache->get(ident) = s;
+    }
+    return s;
+}
+
+
 void ScopeDsymbol::importScope(Dsymbol *s, enum PROT protection)
 {
     //printf("%s->ScopeDsymbol::importScope(%s, %d)\n", toChars(), s->toChars(), protection);
@@ -994,11 +1043,14 @@ void ScopeDsymbol::importScope(Dsymbol *s, enum PROT protection)
                 if (ss == s)                    // if already imported
                 {
                     if (protection > prots[i])
-                        prots[i] = protection;  // upgrade access
+                    {   prots[i] = protection;  // upgrade access
+                        importsGeneration++;
+                    }
                     return;
                 }
             }
         }
+        importsGeneration++;
         imports->push(s);
         prots = (unsigned char *)mem.realloc(prots, imports->dim * sizeof(prots[0]));
         prots[imports->dim - 1] = protection;
@@ -1071,6 +1123,8 @@ const char *ScopeDsymbol::kind()
 
 Dsymbol *ScopeDsymbol::symtabInsert(Dsymbol *s)
 {
+    if (isModule() || isTemplateMixin())
+        importsGeneration++;            // it can be imported
     return symtab->insert(s);
 }
 
@@ -1451,92 +1505,156 @@ Dsymbol *ArrayScopeSymbol::search(Loc loc, Identifier *ident, int flags)
 
 /****************************** DsymbolTable ******************************/
 
+/* Symbols are found by their Identifier, which is unique to its name.
+ * A small table is searched in order. A larger one is an open
+ * addressing hash table with linear probing, at most half full, as
+ * most lookups are for names that aren't in the table.
+ */
+
 DsymbolTable::DsymbolTable()
 {
-#if STRINGTABLE
-    tab = new StringTable;
-    tab->init();
-#else
-    tab = NULL;
-#endif
+    keys = smallkeys;
+    values = smallvalues;
+    dim = DSYMTAB_SMALL;
+    shift = 0;
+    count = 0;
 }
 
 DsymbolTable::~DsymbolTable()
 {
-#if STRINGTABLE
-    delete tab;
-#endif
+    if (keys != smallkeys)
+        mem.free(keys);
+}
+
+/* Identifiers are allocated, so the low bits of their addresses are
+ * mostly the same. Take the high bits of the address times 2**n / phi
+ * (Fibonacci hashing), which all the bits of the address affect.
+ */
+
+static inline size_t hashIdent(Identifier *ident, unsigned shift)
+{
+    const size_t phi = sizeof(size_t) == 8 ? (size_t)0x9E3779B97F4A7C15ULL : 0x9E3779B9;
+    return ((size_t)ident * phi) >> shift;
 }
 
 Dsymbol *DsymbolTable::lookup(Identifier *ident)
 {
-#if STRINGTABLE
-#ifdef DEBUG
-    assert(ident);
-    assert(tab);
-#endif
     //printf("DsymbolTable::lookup(%s)\n", (char*)ident->string);
-    StringValue *sv = tab->lookup((char*)ident->string, ident->len);
-    return (Dsymbol *)(sv ? sv->ptrvalue : NULL);
-#else
-    //printf("DsymbolTable::lookup(%s)\n", (char*)ident->string);
-    return (Dsymbol *)_aaGetRvalue(tab, ident);
-#endif
+    Dsymbol **ps = find(ident);
+    return ps ? *ps : NULL;
+}
+
+Dsymbol **DsymbolTable::find(Identifier *ident)
+{
+    if (keys == smallkeys)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (keys[i] == ident)
+                return &values[i];
+        }
+        return NULL;
+    }
+    size_t mask = dim - 1;
+    for (size_t i = hashIdent(ident, shift); keys[i]; i = (i + 1) & mask)
+    {
+        if (keys[i] == ident)
+            return &values[i];
+    }
+    return NULL;
+}
+
+Dsymbol **DsymbolTable::get(Identifier *ident)
+{
+    if (keys == smallkeys)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (keys[i] == ident)
+                return &values[i];
+        }
+        if (count < DSYMTAB_SMALL)
+        {   keys[count] = ident;
+            values[count] = NULL;
+            return &values[count++];
+        }
+        grow();
+    }
+    size_t mask = dim - 1;
+    size_t i;
+    for (i = hashIdent(ident, shift); keys[i]; i = (i + 1) & mask)
+    {
+        if (keys[i] == ident)
+            return &values[i];
+    }
+    if ((count + 1) * 2 > dim)
+    {   grow();
+        return get(ident);
+    }
+    keys[i] = ident;
+    values[i] = NULL;
+    count++;
+    return &values[i];
+}
+
+/*************************************
+ * Double the number of slots, or go from the table searched in order
+ * to a hash table.
+ */
+
+void DsymbolTable::grow()
+{
+    Identifier **oldkeys = keys;
+    Dsymbol **oldvalues = values;
+    size_t olddim = keys == smallkeys ? count : dim;
+
+    dim = keys == smallkeys ? DSYMTAB_SMALL * 4 : dim * 2;
+    shift = sizeof(size_t) * 8;
+    for (size_t n = dim; n > 1; n >>= 1)
+        shift--;
+    keys = (Identifier **)mem.calloc(dim, sizeof(Identifier *) + sizeof(Dsymbol *));
+    values = (Dsymbol **)(keys + dim);
+
+    size_t mask = dim - 1;
+    for (size_t j = 0; j < olddim; j++)
+    {   Identifier *ident = oldkeys[j];
+        if (!ident)
+            continue;
+        size_t i = hashIdent(ident, shift);
+        while (keys[i])
+            i = (i + 1) & mask;
+        keys[i] = ident;
+        values[i] = oldvalues[j];
+    }
+    if (oldkeys != smallkeys)
+        mem.free(oldkeys);
 }
 
 Dsymbol *DsymbolTable::insert(Dsymbol *s)
 {
     //printf("DsymbolTable::insert(this = %p, '%s')\n", this, s->ident->toChars());
-    Identifier *ident = s->ident;
-#if STRINGTABLE
-#ifdef DEBUG
-    assert(ident);
-    assert(tab);
-#endif
-    StringValue *sv = tab->insert(ident->toChars(), ident->len);
-    if (!sv)
-        return NULL;            // already in table
-    sv->ptrvalue = s;
-    return s;
-#else
-    Dsymbol **ps = (Dsymbol **)_aaGet(&tab, ident);
+    Dsymbol **ps = get(s->ident);
     if (*ps)
         return NULL;            // already in table
     *ps = s;
     return s;
-#endif
 }
 
 Dsymbol *DsymbolTable::insert(Identifier *ident, Dsymbol *s)
 {
     //printf("DsymbolTable::insert()\n");
-#if STRINGTABLE
-    StringValue *sv = tab->insert(ident->toChars(), ident->len);
-    if (!sv)
-        return NULL;            // already in table
-    sv->ptrvalue = s;
-    return s;
-#else
-    Dsymbol **ps = (Dsymbol **)_aaGet(&tab, ident);
+    Dsymbol **ps = get(ident);
     if (*ps)
         return NULL;            // already in table
     *ps = s;
     return s;
-#endif
 }
 
 Dsymbol *DsymbolTable::update(Dsymbol *s)
 {
-    Identifier *ident = s->ident;
-#if STRINGTABLE
-    StringValue *sv = tab->update(ident->toChars(), ident->len);
-    sv->ptrvalue = s;
-    return s;
-#else
-    Dsymbol **ps = (Dsymbol **)_aaGet(&tab, ident);
+    Dsymbol **ps = get(s->ident);
     *ps = s;
     return s;
-#endif
 }
 
 
@@ -272,10 +272,15 @@ struct ScopeDsymbol : Dsymbol
     Dsymbols *imports;          // imported Dsymbol's
     unsigned char *prots;       // array of PROT, one for each import
 
+    DsymbolTable *importcache;          // what searchImports() found from this scope
+    unsigned importcachegen;            // importsGeneration it was found in
+    static unsigned importsGeneration;  // changes when an import search could find more
+
     ScopeDsymbol();
     ScopeDsymbol(Identifier *id);
     Dsymbol *syntaxCopy(Dsymbol *s);
     Dsymbol *search(Loc loc, Identifier *ident, int flags);
+    Dsymbol *searchImports(Loc loc, Identifier *ident, int flags);
     void importScope(Dsymbol *s, enum PROT protection);
     int isforwardRef();
     void defineRef(Dsymbol *s);
@@ -342,9 +347,17 @@ struct OverloadSet : Dsymbol
 
 // Table of Dsymbol's
 
+#define DSYMTAB_SMALL   8       // symbols kept in the table itself
+
 struct DsymbolTable : Object
 {
-    AA *tab;
+    Identifier **keys;          // open addressing, NULL for an empty slot
+    Dsymbol **values;
+    size_t dim;                 // number of slots, a power of 2
+    unsigned shift;             // hash to dim slots
+    size_t count;               // number of symbols
+    Identifier *smallkeys[DSYMTAB_SMALL];       // while count <= DSYMTAB_SMALL
+    Dsymbol *smallvalues[DSYMTAB_SMALL];        // they are in order
 
     DsymbolTable();
     ~DsymbolTable();
@@ -358,6 +371,10 @@ struct DsymbolTable : Object
     // Look for Dsymbol in table. If there, return it. If not, insert s and return that.
     Dsymbol *update(Dsymbol *s);
     Dsymbol *insert(Identifier *ident, Dsymbol *s);     // when ident and s are not the same
+
+    Dsymbol **find(Identifier *ident);  // slot for ident's symbol, NULL if not there
+    Dsymbol **get(Identifier *ident);   // slot for ident's symbol, added as NULL if not there
+    void grow();
 };
 
 #endif /* DMD_DSYMBOL_H */
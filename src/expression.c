@@ -1428,7 +1428,7 @@ Expression *Expression::copy()
 #endif
         assert(0);
     }
-    e = (Expression *)mem.malloc(size);
+    e = (Expression *)mem.fmalloc(size);
     //printf("Expression::copy(op = %d) e = %p\n", op, e);
     return (Expression *)memcpy(e, this, size);
 }
@@ -6645,6 +6645,8 @@ Expression *FileExp::semantic(Scope *sc)
         {
             f.ref = 1;
             se = new StringExp(loc, f.buffer, f.len);
+            if (global.params.incremental)
+                sc->module->contentImportedFiles.push(name);
         }
     }
     return se->semantic(sc);
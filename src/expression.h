@@ -44,6 +44,7 @@ struct ClassDeclaration;
 struct HdrGenState;
 struct BinExp;
 struct InterState;
+struct CtfeCompiler;
 struct Symbol;          // back end symbol
 struct OverloadSet;
 struct Initializer;
@@ -180,6 +181,7 @@ struct Expression : Object
 
     // Implementation of CTFE for this expression
     virtual Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    virtual int ctfeCompile(CtfeCompiler *cc);
 
     virtual int isConst();
     virtual int isBool(int result);
@@ -219,6 +221,7 @@ struct IntegerExp : Expression
     int equals(Object *o);
     Expression *semantic(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     char *toChars();
     void dump(int indent);
     IntRange getIntRange();
@@ -639,6 +642,7 @@ struct VarExp : SymbolExp
     Expression *semantic(Scope *sc);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void dump(int indent);
     char *toChars();
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
@@ -705,6 +709,7 @@ struct DeclarationExp : Expression
     Expression *syntaxCopy();
     Expression *semantic(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     elem *toElem(IRState *irs);
 
@@ -779,6 +784,7 @@ struct UnaExp : Expression
     void dump(int indent);
     Expression *interpretCommon(InterState *istate, CtfeGoal goal,
         Expression *(*fp)(Type *, Expression *));
+    int ctfeCompile(CtfeCompiler *cc);
     Expression *resolveLoc(Loc loc, Scope *sc);
 
     Expression *doInline(InlineDoState *ids);
@@ -813,6 +819,7 @@ struct BinExp : Expression
     Expression *interpretAssignCommon(InterState *istate, CtfeGoal goal,
         Expression *(*fp)(Type *, Expression *, Expression *), int post = 0);
     Expression *interpretFourPointerRelation(InterState *istate, CtfeGoal goal);
+    int ctfeCompile(CtfeCompiler *cc);
     virtual Expression *arrayOp(Scope *sc);
 
     Expression *doInline(InlineDoState *ids);
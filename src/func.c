@@ -72,6 +72,7 @@ FuncDeclaration::FuncDeclaration(Loc loc, Loc endloc, Identifier *id, StorageCla
     isArrayOp = 0;
     semanticRun = PASSinit;
     semantic3Errors = 0;
+    ctfeCode = NULL;
 #if DMDV1
     nestedFrameRef = 0;
 #endif
@@ -829,6 +830,16 @@ void FuncDeclaration::semantic3(Scope *sc)
     semanticRun = PASSsemantic3;
     semantic3Errors = 0;
 
+    if (global.params.incremental && !inTemplateInstance())
+    {   /* The object file of the module being compiled now depends
+         * on this function's body, not just on the interface of the
+         * module it's in.
+         */
+        Module *m = getModule();
+        if (m && m->importedFrom != m)
+            m->bodyUsed = 1;
+    }
+
     if (!type || type->ty != Tfunction)
         return;
     f = (TypeFunction *)(type);
@@ -1803,7 +1814,7 @@ int FuncDeclaration::equals(Object *o)
 void FuncDeclaration::bodyToCBuffer(OutBuffer *buf, HdrGenState *hgs)
 {
     if (fbody &&
-        (!hgs->hdrgen || hgs->tpltMember || canInline(1,1,1))
+        (!hgs->hdrgen || hgs->tpltMember || (!hgs->nobodies && canInline(1,1,1)))
        )
     {   buf->writenl();
 
@@ -38,6 +38,8 @@
 #include "cgcv.h"
 #include "outbuf.h"
 #include "irstate.h"
+#include "vtime.h"
+#include "server.h"
 
 struct Environment;
 
@@ -293,6 +295,7 @@ void Module::genobjfile(int multiobj)
     //EEcontext *ee = env->getEEcontext();
 
     //printf("Module::genobjfile(multiobj = %d) %s\n", multiobj, toChars());
+    VTimeScope vt(this, PHASEcodegen);
 
     lastmname = srcfile->toChars();
 
@@ -361,6 +364,8 @@ void Module::genobjfile(int multiobj)
         //printf("toObjFile %s %s\n", member->kind(), member->toChars());
         member->toObjFile(multiobj);
     }
+    if (global.params.server)
+        Server::genAdopted(this, multiobj);
 
     if (global.params.cov)
     {
@@ -1057,7 +1062,9 @@ void FuncDeclaration::toObjFile(int multiobj)
     if (global.errors)
         return;
 
-    writefunc(s);
+    {   VTimeScope vt("backend", this);
+        writefunc(s);
+    }
     if (isExport())
         objmod->export_symbol(s, Para.offset);
 
@@ -15,6 +15,7 @@ struct HdrGenState
     int hdrgen;         // 1 if generating header file
     int ddoc;           // 1 if generating Ddoc file
     int console;        // 1 if writing to console
+    int nobodies;       // 1 if leaving out the bodies of functions that aren't template members
     int tpltMember;
     int inCallExp;
     int inPtrExp;
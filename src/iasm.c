@@ -4833,7 +4833,7 @@ Statement *AsmStatement::semantic(Scope *sc)
     {
         asmtok = NULL;                  // skip rest of line
         tok_value = TOKeof;
-        exit(EXIT_FAILURE);
+        fatal();
     }
 
 AFTER_EMIT:
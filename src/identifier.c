@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "root.h"
+#include "thread.h"
 #include "identifier.h"
 #include "mars.h"
 #include "lexer.h"
@@ -83,11 +84,16 @@ int Identifier::dyncast()
 
 // BUG: these are redundant with Lexer::uniqueId()
 
+size_t Identifier::generatedIds;
+
 Identifier *Identifier::generateId(const char *prefix)
 {
-    static size_t i;
-
-    return generateId(prefix, ++i);
+    if (global.mutex)
+        global.mutex->lock();
+    size_t n = ++generatedIds;
+    if (global.mutex)
+        global.mutex->unlock();
+    return generateId(prefix, n);
 }
 
 Identifier *Identifier::generateId(const char *prefix, size_t i)
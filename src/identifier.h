@@ -33,6 +33,7 @@ struct Identifier : Object
     const char *toHChars2();
     int dyncast();
 
+    static size_t generatedIds;         // number made by generateId(prefix)
     static Identifier *generateId(const char *prefix);
     static Identifier *generateId(const char *prefix, size_t i);
 };
@@ -0,0 +1,334 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+// This implements -incremental, deciding which modules need compiling.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "rmem.h"
+#include "root.h"
+#include "stringtable.h"
+#include "aav.h"
+
+#include "mars.h"
+#include "module.h"
+#include "lexer.h"
+#include "hdrgen.h"
+#include "incremental.h"
+
+#define INCREMENTAL_EXT         "dep"
+
+static d_uns64 flagshash;       // of the switches that affect the output
+
+/* What is known about a source file in this compile, by file name.
+ */
+struct FileHash
+{
+    int exists;
+    d_uns64 src;                // hash of the file
+    int ifacedone;              // iface has been computed
+    d_uns64 iface;              // hash of its 'header' file, 0 if it has errors
+};
+
+static StringTable *filehashes;
+
+/**************************************
+ * 64 bit FNV-1a hash.
+ */
+
+static d_uns64 fnv(d_uns64 h, const void *p, size_t len)
+{
+    const unsigned char *s = (const unsigned char *)p;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ s[i]) * 1099511628211ULL;
+    return h;
+}
+
+d_uns64 Incremental::hash(const void *p, size_t len)
+{
+    return fnv(14695981039346656037ULL, p, len);
+}
+
+/**************************************
+ * Hash the switches that can change what goes into an object file.
+ * Input:
+ *      argc, argv      the command line, after response files and DFLAGS
+ */
+
+void Incremental::init(size_t argc, char *argv[])
+{
+    d_uns64 h = hash(global.version, strlen(global.version));
+    for (size_t i = 1; i < argc; i++)
+    {   char *p = argv[i];
+        if (!p || *p != '-')
+            continue;                   // file names are checked one by one
+        if (strcmp(p, "-incremental") == 0 ||
+            strcmp(p, "-quiet") == 0 ||
+            strcmp(p, "-v") == 0 ||
+            memcmp(p, "-j=", 3) == 0 ||
+            memcmp(p, "-vtime", 6) == 0 ||
+            strcmp(p, "-vtemplates") == 0)
+            continue;                   // reporting only
+        if (strcmp(p, "-c") == 0 ||
+            memcmp(p, "-of", 3) == 0 ||
+            memcmp(p, "-od", 3) == 0 ||
+            memcmp(p, "-L", 2) == 0)
+            continue;                   // where the output goes, and linking
+        if (memcmp(p, "--server=", 9) == 0)
+            continue;                   // the same compile, by the compile server
+        h = fnv(h, p, strlen(p) + 1);
+    }
+    flagshash = h;
+}
+
+/**************************************
+ * Compute m->ifacehash from the 'header' file for m, which must have
+ * been parsed but had no semantic analysis. The bodies of functions
+ * that aren't templates are left out: an importer that needed one
+ * has bodyUsed set for m, and depends on all of its source.
+ */
+
+void Incremental::hashInterface(Module *m)
+{
+    OutBuffer buf;
+    HdrGenState hgs;
+    hgs.hdrgen = 1;
+    hgs.nobodies = 1;           // what they're used for is tracked by bodyUsed
+    m->toCBuffer(&buf, &hgs);
+    m->ifacehash = hash(buf.data, buf.offset);
+}
+
+static FileHash *fileHash(char *filename)
+{
+    if (!filehashes)
+    {   filehashes = new StringTable();
+        filehashes->init();
+    }
+    StringValue *sv = filehashes->update(filename, strlen(filename));
+    if (!sv->ptrvalue)
+    {
+        FileHash *fh = new FileHash();
+        memset(fh, 0, sizeof(FileHash));
+        File f(filename);
+        if (!f.read())
+        {   fh->exists = 1;
+            fh->src = Incremental::hash(f.buffer, f.len);
+        }
+        sv->ptrvalue = fh;
+    }
+    return (FileHash *)sv->ptrvalue;
+}
+
+/**************************************
+ * Hash of the 'header' file for the source in filename, which has
+ * changed since it was last compiled.
+ */
+
+static d_uns64 interfaceHash(char *filename, char *modname)
+{
+    FileHash *fh = fileHash(filename);
+    if (!fh->ifacedone)
+    {
+        fh->ifacedone = 1;
+        Module *m = new Module(filename, Lexer::idPool(modname), 0, 0);
+        m->read(0);
+        unsigned errors = global.startGagging();
+        m->parseSource();
+        if (global.endGagging(errors))
+            fh->iface = 0;              // compile it again to see the errors
+        else
+        {   Incremental::hashInterface(m);
+            fh->iface = m->ifacehash;
+        }
+    }
+    return fh->iface;
+}
+
+/**************************************
+ * Split the next line of a .dep file into its fields, the last one
+ * being the rest of the line.
+ * Returns:
+ *      number of fields, 0 at end of file
+ */
+
+static int splitLine(char **pp, char *fields[], int nfields)
+{
+    char *p = *pp;
+    if (!*p)
+        return 0;
+    char *eol = strchr(p, '\n');
+    if (eol)
+    {   *eol = 0;
+        *pp = eol + 1;
+    }
+    else
+        *pp = p + strlen(p);
+
+    int n = 0;
+    while (n < nfields)
+    {
+        fields[n++] = p;
+        if (n == nfields)
+            break;
+        p = strchr(p, ' ');
+        if (!p)
+            break;
+        *p++ = 0;
+    }
+    return n;
+}
+
+static bool isRoot(char *filename, Modules *roots)
+{
+    for (size_t i = 0; i < roots->dim; i++)
+    {
+        if (strcmp((*roots)[i]->srcfile->toChars(), filename) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**************************************
+ * Is m's object file up to date?
+ * Input:
+ *      roots   all the modules on the command line
+ */
+
+bool Incremental::upToDate(Module *m, Modules *roots)
+{
+    char *objname = m->objfile->name->toChars();
+    if (!FileName::exists(objname))
+        return false;
+    File depfile(FileName::forceExt(objname, INCREMENTAL_EXT));
+    if (depfile.read())
+        return false;
+
+    char *p = (char *)depfile.buffer;
+    char *f[6];
+    int n;
+
+    // The same compiler and switches
+    n = splitLine(&p, f, 3);
+    if (n != 3 || strcmp(f[0], "dmd") || strcmp(f[1], global.version) ||
+        strtoull(f[2], NULL, 16) != flagshash)
+        return false;
+
+    /* Only trust object files compiled on their own: with other modules,
+     * template instances they need may be in the others' object files.
+     */
+    n = splitLine(&p, f, 2);
+    if (n != 2 || strcmp(f[0], "roots") || strcmp(f[1], "1"))
+        return false;
+
+    while ((n = splitLine(&p, f, 6)) != 0)
+    {
+        if (strcmp(f[0], "source") == 0 && n == 3)
+        {
+            if (strcmp(f[2], m->srcfile->toChars()))
+                return false;
+            FileHash *fh = fileHash(f[2]);
+            if (!fh->exists || fh->src != strtoull(f[1], NULL, 16))
+                return false;
+        }
+        else if (strcmp(f[0], "import") == 0 && n == 6)
+        {
+            char *file = f[5];
+            if (!isRoot(file, roots))
+            {   // It must still be the file the import finds
+                char *name = mem.strdup(f[4]);
+                for (char *q = name; *q; q++)
+                {
+                    if (*q == '.')
+#if _WIN32
+                        *q = '\\';
+#else
+                        *q = '/';
+#endif
+                }
+                char *found = Module::lookForSourceFile(name);
+                if (!found || strcmp(found, file))
+                    return false;
+            }
+            FileHash *fh = fileHash(file);
+            if (!fh->exists)
+                return false;
+            if (fh->src == strtoull(f[1], NULL, 16))
+                continue;
+            if (strcmp(f[3], "i"))
+                return false;           // its function bodies were used
+            d_uns64 iface = interfaceHash(file, f[4]);
+            if (!iface || iface != strtoull(f[2], NULL, 16))
+                return false;
+        }
+        else if (strcmp(f[0], "file") == 0 && n == 3)
+        {
+            FileHash *fh = fileHash(f[2]);
+            if (!fh->exists || fh->src != strtoull(f[1], NULL, 16))
+                return false;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+/**************************************
+ * Record what went into m's object file, which has just been written.
+ * Input:
+ *      nroots  number of modules compiled in this process
+ */
+
+void Incremental::write(Module *m, size_t nroots)
+{
+    OutBuffer buf;
+    buf.printf("dmd %s %016llx\n", global.version, (unsigned long long)flagshash);
+    buf.printf("roots %llu\n", (unsigned long long)nroots);
+    buf.printf("source %016llx %s\n", (unsigned long long)m->srchash, m->srcfile->toChars());
+
+    // Everything m imports, directly or not
+    Modules closure;
+    AA *visited = NULL;
+    closure.push(m);
+    *_aaGet(&visited, m) = m;
+    for (size_t i = 0; i < closure.dim; i++)
+    {   Module *mi = closure[i];
+        for (size_t j = 0; j < mi->aimports.dim; j++)
+        {   Module *mj = mi->aimports[j];
+            Value *pv = _aaGet(&visited, mj);
+            if (!*pv)
+            {   *pv = mj;
+                closure.push(mj);
+            }
+        }
+    }
+
+    for (size_t i = 1; i < closure.dim; i++)
+    {   Module *mi = closure[i];
+        buf.printf("import %016llx %016llx %c %s %s\n",
+            (unsigned long long)mi->srchash, (unsigned long long)mi->ifacehash,
+            mi->bodyUsed ? 'b' : 'i', mi->toPrettyChars(), mi->srcfile->toChars());
+    }
+    for (size_t i = 0; i < closure.dim; i++)
+    {   Module *mi = closure[i];
+        for (size_t j = 0; j < mi->contentImportedFiles.dim; j++)
+        {   char *name = mi->contentImportedFiles[j];
+            FileHash *fh = fileHash(name);
+            buf.printf("file %016llx %s\n", (unsigned long long)fh->src, name);
+        }
+    }
+
+    File depfile(FileName::forceExt(m->objfile->name->toChars(), INCREMENTAL_EXT));
+    depfile.setbuffer(buf.data, buf.offset);
+    depfile.ref = 1;
+    depfile.writev();
+}
@@ -0,0 +1,50 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+#ifndef DMD_INCREMENTAL_H
+#define DMD_INCREMENTAL_H
+
+#ifdef __DMC__
+#pragma once
+#endif /* __DMC__ */
+
+#include "mars.h"
+#include "arraytypes.h"
+
+struct Module;
+
+/**************************************
+ * For -incremental, a module is only compiled if its object file is
+ * out of date. Next to each object file is a .dep file, recording what
+ * went into it:
+ *      dmd version flags       compiler version, and hash of the switches
+ *      roots n                 number of modules compiled together
+ *      source hash file        the module's own source
+ *      import hash ihash b|i name file
+ *                              each module it imports, directly or not,
+ *                              with the hash of its source, and of its
+ *                              'header' file less function bodies (b if the
+ *                              compile used its function bodies, so any
+ *                              change counts)
+ *      file hash file          each file read by import("file")
+ * The object file is out of date if any of those changed, or if an
+ * import now resolves to a different file.
+ */
+
+struct Incremental
+{
+    static d_uns64 hash(const void *p, size_t len);
+    static void init(size_t argc, char *argv[]);
+    static void hashInterface(Module *m);
+    static bool upToDate(Module *m, Modules *roots);
+    static void write(Module *m, size_t nroots);
+};
+
+#endif /* DMD_INCREMENTAL_H */
@@ -24,6 +24,7 @@
 #include "statement.h"
 #include "mtype.h"
 #include "scope.h"
+#include "module.h"
 
 /* ========== Compute cost of inlining =============== */
 
@@ -1426,6 +1427,31 @@ void FuncDeclaration::inlineScan()
     }
 }
 
+/**************************************
+ * Functions in imported modules only get semantic3() when
+ * there's a call to one that might be inlined, rather than all
+ * of them up front.
+ */
+
+void FuncDeclaration::inlineSemantic3()
+{
+    /* The problem with useArrayBounds and useAssert is that the
+     * module being linked to may not have generated them, so if
+     * we inline functions from those modules, the symbols for them will
+     * not be found at link time.
+     */
+    if (global.params.useArrayBounds || global.params.useAssert)
+        return;
+
+    if (!scope || !fbody || inTemplateInstance())
+        return;
+    Module *m = getModule();
+    if (!m || m->importedFrom == m)         // root modules had semantic3()
+        return;
+
+    semantic3(scope);
+}
+
 int FuncDeclaration::canInline(int hasthis, int hdrscan, int statementsToo)
 {
     InlineCostState ics;
@@ -1440,6 +1466,9 @@ int FuncDeclaration::canInline(int hasthis, int hdrscan, int statementsToo)
     if (needThis() && !hasthis)
         return 0;
 
+    if (semanticRun < PASSsemantic3 && !hdrscan && !inlineNest)
+        inlineSemantic3();
+
     if (inlineNest || (semanticRun < PASSsemantic3 && !hdrscan))
     {
 #if CANINLINE_LOG
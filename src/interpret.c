@@ -30,14 +30,12 @@
 #include "template.h"
 #include "port.h"
 #include "ctfe.h"
+#include "vtime.h"
 
 #define LOG     0
 #define LOGASSIGN 0
 #define SHOWPERFORMANCE 0
 
-// Maximum allowable recursive function calls in CTFE
-#define CTFE_RECURSION_LIMIT 1000
-
 /**
   The values of all CTFE variables
 */
@@ -302,6 +300,9 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
     if (semanticRun < PASSsemantic3done)
         return EXP_CANT_INTERPRET;
 
+    // Time only the calls made from outside CTFE
+    VTimeScope vt("ctfe", istate ? NULL : this);
+
     Type *tb = type->toBasetype();
     assert(tb->ty == Tfunction);
     TypeFunction *tf = (TypeFunction *)tb;
@@ -339,6 +340,7 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
             return EXP_CANT_INTERPRET;
     }
     static int evaluatingArgs = 0;
+    Expressions eargs;
     if (arguments)
     {
         dim = arguments->dim;
@@ -348,7 +350,6 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
         /* Evaluate all the arguments to the function,
          * store the results in eargs[]
          */
-        Expressions eargs;
         eargs.setDim(dim);
         for (size_t i = 0; i < dim; i++)
         {   Expression *earg = (*arguments)[i];
@@ -406,7 +407,22 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
             }
             eargs[i] = earg;
         }
+    }
+
+    /* If the function only works with integers, run it from bytecode.
+     * Anything that goes wrong is left to the interpreter, with the
+     * same arguments, to report.
+     */
+    CtfeCode *code = CtfeCode::get(this);
+    if (code)
+    {
+        Expression *e = code->interpret(&eargs);
+        if (e)
+            return e;
+    }
 
+    if (arguments)
+    {
         for (size_t i = 0; i < dim; i++)
         {   Expression *earg = eargs[i];
             Parameter *arg = Parameter::getNth(tf->parameters, i);
@@ -773,6 +789,8 @@ Expression *scrubReturnValue(Loc loc, Expression *e)
     {
         ((StringExp *)e)->ownedByCtfe = false;
     }
+    if (e->op == TOKstring || e->op == TOKarrayliteral)
+        unshareLiteral(e);
     if (e->op == TOKarrayliteral)
     {
         ((ArrayLiteralExp *)e)->ownedByCtfe = false;
@@ -3206,7 +3224,9 @@ Expression *BinExp::interpretAssignCommon(InterState *istate, CtfeGoal goal, fp_
             if (newval->op == TOKstructliteral)
                 assignInPlace((Expression *)(existingAE->elements->tdata()[indexToModify]), newval);
             else
+            {   unshareArrayLiteral(existingAE, indexToModify);
                 existingAE->elements->tdata()[indexToModify] = newval;
+            }
             return returnValue;
         }
         if (existingSE)
@@ -3415,6 +3435,8 @@ Expression *BinExp::interpretAssignCommon(InterState *istate, CtfeGoal goal, fp_
             return EXP_CANT_INTERPRET;
         }
 
+        if (existingAE)
+            unshareArrayLiteral(existingAE, firstIndex);
         if (!isBlockAssignment && newval->op == TOKarrayliteral && existingAE)
         {
             Expressions *oldelems = existingAE->elements;
@@ -46,6 +46,7 @@ const char Pmembers[] = "members";
 const char Pprotection[] = "protection";
 
 void JsonRemoveComma(OutBuffer *buf);
+void JsonTemplates(FileName *jsonfilename);
 
 void json_generate(Modules *modules)
 {   OutBuffer buf;
@@ -89,6 +90,9 @@ void json_generate(Modules *modules)
         FileName::ensurePathExists(pt);
     mem.free(pt);
     jsonfile->writev();
+
+    if (global.params.vtemplates)
+        JsonTemplates(jsonfilename);
 }
 
 
@@ -171,6 +175,43 @@ void JsonRemoveComma(OutBuffer *buf)
         buf->offset -= 2;
 }
 
+/*********************************
+ * For -vtemplates, write the template statistics to a file next
+ * to the JSON file, in the same order as the report.
+ */
+void JsonTemplates(FileName *jsonfilename)
+{
+    OutBuffer buf;
+
+    TemplateStats::sort();
+    buf.writestring("[\n");
+    for (size_t i = 0; i < TemplateStats::all.dim; i++)
+    {   TemplateStats *ts = TemplateStats::all[i];
+        TemplateDeclaration *td = ts->td;
+
+        buf.writestring("{\n");
+        JsonProperty(&buf, Pname, ts->toChars());
+        if (td->loc.filename)
+            JsonProperty(&buf, Pfile, td->loc.filename);
+        JsonProperty(&buf, Pline, td->loc.linnum);
+        JsonProperty(&buf, "instances", ts->instances);
+        JsonProperty(&buf, "hits", ts->hits);
+        JsonProperty(&buf, "deductions", ts->deductions);
+        JsonProperty(&buf, "matches", ts->matches);
+        JsonProperty(&buf, "constraintFails", ts->constraintFails);
+        JsonString(&buf, "time");
+        buf.printf(" : %.6f\n},\n", ts->time);
+    }
+    JsonRemoveComma(&buf);
+    buf.writestring("]\n");
+
+    FileName *fn = FileName::forceExt(jsonfilename->toChars(), "templates.json");
+    File *f = new File(fn);
+    f->setbuffer(buf.data, buf.offset);
+    f->ref = 1;
+    f->writev();
+}
+
 void Dsymbol::toJsonBuffer(OutBuffer *buf)
 {
 }
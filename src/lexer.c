@@ -23,12 +23,14 @@
 #include "rmem.h"
 
 #include "stringtable.h"
+#include "thread.h"
 
 #include "lexer.h"
 #include "utf.h"
 #include "identifier.h"
 #include "id.h"
 #include "module.h"
+#include "tokcache.h"
 
 #if _WIN32 && __DMC__
 // from \dm\src\include\setlocal.h
@@ -69,24 +71,179 @@ static void cmtable_init()
     }
 }
 
+/********************************************
+ * Skip over the runs of characters that make up most of a source file:
+ * identifier characters, blanks, and the plain text of comments and
+ * string literals. Each returns a pointer to the first character at
+ * or after p that is not part of the run. 0, 0x1A and characters
+ * 0x80 and up always end a run, so the caller sees the end of the
+ * source and any UTF-8 sequence.
+ *
+ * With SSE2 they look at 16 characters at a time. The loads are 16 byte
+ * aligned, and stop in the block holding the terminating 0, so they
+ * never touch a page the source isn't in.
+ */
 
-/************************* Token **********************************************/
+#if (__GNUC__ && (__x86_64__ || __SSE2__)) || (_MSC_VER && (_M_X64 || _M_IX86_FP >= 2))
+#define LEXER_SSE2      1
+#endif
 
-const char *Token::tochars[TOKMAX];
+#if LEXER_SSE2
 
-void *Token::operator new(size_t size)
-{   Token *t;
+#include <emmintrin.h>
 
-    if (Lexer::freelist)
-    {
-        t = Lexer::freelist;
-        Lexer::freelist = t->next;
-        return t;
+#if __SANITIZE_ADDRESS__
+// The aligned loads read before p and past the terminating 0
+#define LEXER_NOSANITIZE        __attribute__((no_sanitize_address))
+#else
+#define LEXER_NOSANITIZE
+#endif
+
+#if _MSC_VER
+#include <intrin.h>
+inline unsigned firstbit(unsigned m)
+{   unsigned long i;
+    _BitScanForward(&i, m);
+    return i;
+}
+#else
+inline unsigned firstbit(unsigned m) { return __builtin_ctz(m); }
+#endif
+
+/* Find the first byte in the run starting at p for which stopmask()
+ * sets a bit.
+ */
+#define SKIPRUN(p, stopmask)                                            \
+    {   unsigned char *a = (unsigned char *)((size_t)p & ~(size_t)15);  \
+        unsigned m = stopmask(_mm_load_si128((__m128i *)a)) &           \
+            (0xFFFF << (p - a));                                        \
+        while (!m)                                                      \
+        {   a += 16;                                                    \
+            m = stopmask(_mm_load_si128((__m128i *)a));                 \
+        }                                                               \
+        return a + firstbit(m);                                         \
+    }
+
+/* Bytes that end any run: 0, 0x1A, and 0x80 and up.
+ */
+inline __m128i endbytes(__m128i v)
+{
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8(0x1A)));
+}
+
+inline unsigned notidchars(__m128i v)
+{
+    // Bytes 0x80 and up are negative, so are in none of the ranges
+    __m128i l = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), l));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+    __m128i id = _mm_or_si128(_mm_or_si128(alpha, digit),
+                              _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    return _mm_movemask_epi8(id) ^ 0xFFFF;
+}
+
+inline unsigned notblanks(__m128i v)
+{
+    __m128i b = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+    return _mm_movemask_epi8(b) ^ 0xFFFF;
+}
+
+inline unsigned linecommentend(__m128i v)
+{
+    __m128i e = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    return _mm_movemask_epi8(_mm_or_si128(e, endbytes(v))) | _mm_movemask_epi8(v);
+}
+
+inline unsigned blockcommentend(__m128i v)
+{
+    __m128i e = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    e = _mm_or_si128(e, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+    return _mm_movemask_epi8(_mm_or_si128(e, endbytes(v))) | _mm_movemask_epi8(v);
+}
+
+inline unsigned stringend(__m128i v)
+{
+    __m128i e = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    e = _mm_or_si128(e, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    e = _mm_or_si128(e, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    return _mm_movemask_epi8(_mm_or_si128(e, endbytes(v))) | _mm_movemask_epi8(v);
+}
+
+LEXER_NOSANITIZE static unsigned char *skipidchars(unsigned char *p)
+    SKIPRUN(p, notidchars)
+
+LEXER_NOSANITIZE static unsigned char *skipblanks(unsigned char *p)
+    SKIPRUN(p, notblanks)
+
+LEXER_NOSANITIZE static unsigned char *skiplinecomment(unsigned char *p)
+    SKIPRUN(p, linecommentend)
+
+LEXER_NOSANITIZE static unsigned char *skipblockcomment(unsigned char *p)
+    SKIPRUN(p, blockcommentend)
+
+LEXER_NOSANITIZE static unsigned char *skipstring(unsigned char *p)
+    SKIPRUN(p, stringend)
+
+#else
+
+static unsigned char *skipidchars(unsigned char *p)
+{
+    while (isidchar(*p))
+        p++;
+    return p;
+}
+
+static unsigned char *skipblanks(unsigned char *p)
+{
+    while (*p == ' ' || *p == '\t')
+        p++;
+    return p;
+}
+
+static unsigned char *skiplinecomment(unsigned char *p)
+{
+    while (1)
+    {   unsigned char c = *p;
+        if (c == '\n' || c == '\r' || c == 0 || c == 0x1A || c & 0x80)
+            return p;
+        p++;
+    }
+}
+
+static unsigned char *skipblockcomment(unsigned char *p)
+{
+    while (1)
+    {   unsigned char c = *p;
+        if (c == '/' || c == '\n' || c == '\r' || c == 0 || c == 0x1A || c & 0x80)
+            return p;
+        p++;
     }
+}
 
-    return ::operator new(size);
+static unsigned char *skipstring(unsigned char *p)
+{
+    while (1)
+    {   unsigned char c = *p;
+        if (c == '"' || c == '\\' || c == '\n' || c == '\r' || c == 0 || c == 0x1A || c & 0x80)
+            return p;
+        p++;
+    }
 }
 
+#endif
+
+
+/************************* Token **********************************************/
+
+const char *Token::tochars[TOKMAX];
+
 #ifdef DEBUG
 void Token::print()
 {
@@ -96,7 +253,7 @@ void Token::print()
 
 const char *Token::toChars()
 {   const char *p;
-    static char buffer[3 + 3 * sizeof(float80value) + 1];
+    char buffer[3 + 3 * sizeof(float80value) + 1];
 
     p = buffer;
     switch (value)
@@ -221,26 +378,27 @@ const char *Token::toChars()
             p = toChars(value);
             break;
     }
+    if (p == buffer)            // not static, other threads may be formatting tokens too
+        p = mem.strdup(buffer);
     return p;
 }
 
 const char *Token::toChars(enum TOK value)
 {   const char *p;
-    static char buffer[3 + 3 * sizeof(value) + 1];
 
     p = tochars[value];
     if (!p)
-    {   sprintf(buffer,"TOK%d",value);
-        p = buffer;
+    {   char buffer[3 + 3 * sizeof(value) + 1];
+        sprintf(buffer,"TOK%d",value);
+        p = mem.strdup(buffer);
     }
     return p;
 }
 
 /*************************** Lexer ********************************************/
 
-Token *Lexer::freelist = NULL;
 StringTable Lexer::stringtable;
-OutBuffer Lexer::stringbuffer;
+int Lexer::uniqueIds;
 
 Lexer::Lexer(Module *mod,
         unsigned char *base, size_t begoffset, size_t endoffset,
@@ -250,6 +408,10 @@ Lexer::Lexer(Module *mod,
     //printf("Lexer::Lexer(%p,%d)\n",base,length);
     //printf("lexer.mod = %p, %p\n", mod, this->loc.mod);
     memset(&token,0,sizeof(token));
+    ahead = NULL;
+    aheadmax = 0;
+    aheadstart = 0;
+    aheaddim = 0;
     this->base = base;
     this->end  = base + endoffset;
     p = base + begoffset;
@@ -257,6 +419,9 @@ Lexer::Lexer(Module *mod,
     this->doDocComment = doDocComment;
     this->anyToken = 0;
     this->commentToken = commentToken;
+    this->tokcache = NULL;
+    this->uncacheable = 0;
+    idcache = NULL;
     //initKeywords();
 
     /* If first line starts with '#!', ignore the line
@@ -301,6 +466,7 @@ Lexer::Lexer(Module *mod,
 
 void Lexer::error(const char *format, ...)
 {
+    uncacheable = 1;
     va_list ap;
     va_start(ap, format);
     ::verror(tokenLoc(), format, ap);
@@ -309,6 +475,7 @@ void Lexer::error(const char *format, ...)
 
 void Lexer::error(Loc loc, const char *format, ...)
 {
+    uncacheable = 1;
     va_list ap;
     va_start(ap, format);
     ::verror(loc, format, ap);
@@ -317,6 +484,7 @@ void Lexer::error(Loc loc, const char *format, ...)
 
 void Lexer::deprecation(const char *format, ...)
 {
+    uncacheable = 1;
     va_list ap;
     va_start(ap, format);
     ::vdeprecation(tokenLoc(), format, ap);
@@ -324,14 +492,17 @@ void Lexer::deprecation(const char *format, ...)
 }
 
 TOK Lexer::nextToken()
-{   Token *t;
-
-    if (token.next)
+{
+    if (aheaddim)
+    {
+        memcpy(&token, &ahead[aheadstart], sizeof(Token));
+        token.next = NULL;
+        aheadstart = (aheadstart + 1) & (aheadmax - 1);
+        aheaddim--;
+    }
+    else if (tokcache)
     {
-        t = token.next;
-        memcpy(&token,t,sizeof(Token));
-        t->next = freelist;
-        freelist = t;
+        tokcache->scan(this, &token);
     }
     else
     {
@@ -341,18 +512,56 @@ TOK Lexer::nextToken()
     return token.value;
 }
 
-Token *Lexer::peek(Token *ct)
-{   Token *t;
+/***********************
+ * Return the token after ct, which is token or one looked ahead at.
+ */
 
-    if (ct->next)
-        t = ct->next;
+Token *Lexer::peek(Token *ct)
+{
+    unsigned i;
+    if (ct == &token)
+        i = 0;
     else
     {
-        t = new Token();
-        scan(t);
-        ct->next = t;
+        // A token from before ahead[] grew points to its copy
+        while (ct < ahead || ct >= ahead + aheadmax)
+            ct = ct->next;
+        i = ((ct - ahead - aheadstart) & (aheadmax - 1)) + 1;
+        assert(i <= aheaddim);
     }
-    return t;
+    if (i == aheaddim)
+    {
+        if (aheaddim == aheadmax)
+            growAhead();
+        Token *t = &ahead[(aheadstart + aheaddim) & (aheadmax - 1)];
+        if (tokcache)
+            tokcache->scan(this, t);
+        else
+            scan(t);
+        aheaddim++;
+        return t;
+    }
+    return &ahead[(aheadstart + i) & (aheadmax - 1)];
+}
+
+/***********************
+ * ahead[] is full, double its size.
+ * The parser may still have pointers into the old ahead[], so it is
+ * not freed, and each of its tokens is left pointing to its copy.
+ */
+
+void Lexer::growAhead()
+{
+    unsigned newmax = aheadmax ? aheadmax * 2 : 16;
+    Token *a = (Token *)mem.malloc(newmax * sizeof(Token));
+    for (unsigned i = 0; i < aheaddim; i++)
+    {   Token *t = &ahead[(aheadstart + i) & (aheadmax - 1)];
+        memcpy(&a[i], t, sizeof(Token));
+        t->next = &a[i];
+    }
+    ahead = a;
+    aheadmax = newmax;
+    aheadstart = 0;
 }
 
 /***********************
@@ -487,7 +696,7 @@ void Lexer::scan(Token *t)
             case '\t':
             case '\v':
             case '\f':
-                p++;
+                p = skipblanks(p + 1);
                 continue;                       // skip white space
 
             case '\r':
@@ -606,10 +815,9 @@ void Lexer::scan(Token *t)
 
                 while (1)
                 {
-                    c = *++p;
-                    if (isidchar(c))
-                        continue;
-                    else if (c & 0x80)
+                    p = skipidchars(p + 1);
+                    c = *p;
+                    if (c & 0x80)
                     {   unsigned char *s = p;
                         unsigned u = decodeUTF();
                         if (isUniAlpha(u))
@@ -620,12 +828,7 @@ void Lexer::scan(Token *t)
                     break;
                 }
 
-                StringValue *sv = stringtable.update((char *)t->ptr, p - t->ptr);
-                Identifier *id = (Identifier *) sv->ptrvalue;
-                if (!id)
-                {   id = new Identifier(sv->toDchars(),TOKidentifier);
-                    sv->ptrvalue = id;
-                }
+                Identifier *id = idLookup((char *)t->ptr, p - t->ptr);
                 t->ident = id;
                 t->value = (enum TOK) id->value;
                 anyToken = 1;
@@ -635,16 +838,23 @@ void Lexer::scan(Token *t)
                     static char time[8+1];
                     static char timestamp[24+1];
 
-                    if (!date[0])       // lazy evaluation
-                    {   time_t t;
-                        char *p;
-
-                        ::time(&t);
-                        p = ctime(&t);
-                        assert(p);
-                        sprintf(date, "%.6s %.4s", p + 4, p + 20);
-                        sprintf(time, "%.8s", p + 11);
-                        sprintf(timestamp, "%.24s", p);
+                    if (id == Id::DATE || id == Id::TIME || id == Id::TIMESTAMP)
+                    {
+                        if (global.mutex)
+                            global.mutex->lock();
+                        if (!date[0])   // lazy evaluation
+                        {   time_t t;
+                            char *p;
+
+                            ::time(&t);
+                            p = ctime(&t);
+                            assert(p);
+                            sprintf(date, "%.6s %.4s", p + 4, p + 20);
+                            sprintf(time, "%.8s", p + 11);
+                            sprintf(timestamp, "%.24s", p);
+                        }
+                        if (global.mutex)
+                            global.mutex->unlock();
                     }
 
 #if DMDV1
@@ -662,11 +872,13 @@ void Lexer::scan(Token *t)
 #endif
                     if (id == Id::DATE)
                     {
+                        uncacheable = 1;
                         t->ustring = (unsigned char *)date;
                         goto Lstr;
                     }
                     else if (id == Id::TIME)
                     {
+                        uncacheable = 1;
                         t->ustring = (unsigned char *)time;
                         goto Lstr;
                     }
@@ -677,6 +889,7 @@ void Lexer::scan(Token *t)
                     }
                     else if (id == Id::TIMESTAMP)
                     {
+                        uncacheable = 1;
                         t->ustring = (unsigned char *)timestamp;
                      Lstr:
                         t->value = TOKstring;
@@ -731,7 +944,8 @@ void Lexer::scan(Token *t)
                         while (1)
                         {
                             while (1)
-                            {   unsigned char c = *p;
+                            {   p = skipblockcomment(p);
+                                unsigned char c = *p;
                                 switch (c)
                                 {
                                     case '/':
@@ -784,7 +998,8 @@ void Lexer::scan(Token *t)
                     case '/':           // do // style comments
                         linnum = loc.linnum;
                         while (1)
-                        {   unsigned char c = *++p;
+                        {   p = skiplinecomment(p + 1);
+                            unsigned char c = *p;
                             switch (c)
                             {
                                 case '\n':
@@ -1728,6 +1943,9 @@ TOK Lexer::escapeStringConstant(Token *t, int wide)
     stringbuffer.reset();
     while (1)
     {
+        unsigned char *q = skipstring(p);
+        stringbuffer.write(p, q - p);
+        p = q;
         c = *p++;
         switch (c)
         {
@@ -2461,7 +2679,9 @@ void Lexer::poundLine()
             Lnewline:
                 this->loc.linnum = linnum;
                 if (filespec)
-                    this->loc.filename = filespec;
+                {   this->loc.filename = filespec;
+                    uncacheable = 1;    // the cache only records line numbers
+                }
                 return;
 
             case '\r':
@@ -2734,8 +2954,8 @@ Loc Lexer::tokenLoc()
 {
     Loc result = this->loc;
     Token* last = &token;
-    while (last->next)
-        last = last->next;
+    if (aheaddim)
+        last = &ahead[(aheadstart + aheaddim - 1) & (aheadmax - 1)];
 
     unsigned char* start = token.ptr;
     unsigned char* stop = last->ptr;
@@ -2758,6 +2978,42 @@ Loc Lexer::tokenLoc()
     return result;
 }
 
+/********************************************
+ * Find or create the identifier s[0..len] for scan().
+ * While other threads are lexing, the string table is guarded by
+ * global.mutex, so look first in this Lexer's own cache of the
+ * identifiers it has seen. Most are keywords and names used over
+ * and over in the same module, so most lookups take no lock.
+ */
+
+Identifier *Lexer::idLookup(const char *s, size_t len)
+{
+    Identifier **pid = NULL;
+    if (global.mutex)
+    {
+        if (!idcache)
+            idcache = (Identifier **)mem.calloc(IDCACHESIZE, sizeof(Identifier *));
+        hash_t hash = String::calcHash(s, len);
+        hash ^= (hash >> 11) ^ (hash >> 22);
+        pid = &idcache[hash & (IDCACHESIZE - 1)];
+        Identifier *id = *pid;
+        if (id && id->len == len && memcmp(id->string, s, len) == 0)
+            return id;
+        global.mutex->lock();
+    }
+    StringValue *sv = stringtable.update(s, len);
+    Identifier *id = (Identifier *) sv->ptrvalue;
+    if (!id)
+    {   id = new Identifier(sv->toDchars(),TOKidentifier);
+        sv->ptrvalue = id;
+    }
+    if (pid)
+    {   global.mutex->unlock();
+        *pid = id;
+    }
+    return id;
+}
+
 /********************************************
  * Create an identifier in the string table.
  */
@@ -2765,6 +3021,8 @@ Loc Lexer::tokenLoc()
 Identifier *Lexer::idPool(const char *s)
 {
     size_t len = strlen(s);
+    if (global.mutex)
+        global.mutex->lock();
     StringValue *sv = stringtable.update(s, len);
     Identifier *id = (Identifier *) sv->ptrvalue;
     if (!id)
@@ -2772,6 +3030,8 @@ Identifier *Lexer::idPool(const char *s)
         id = new Identifier(sv->toDchars(), TOKidentifier);
         sv->ptrvalue = id;
     }
+    if (global.mutex)
+        global.mutex->unlock();
     return id;
 }
 
@@ -2790,8 +3050,12 @@ Identifier *Lexer::uniqueId(const char *s, int num)
 
 Identifier *Lexer::uniqueId(const char *s)
 {
-    static int num;
-    return uniqueId(s, ++num);
+    if (global.mutex)
+        global.mutex->lock();
+    int n = ++uniqueIds;
+    if (global.mutex)
+        global.mutex->unlock();
+    return uniqueId(s, n);
 }
 
 /****************************************
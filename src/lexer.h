@@ -21,6 +21,7 @@
 struct StringTable;
 struct Identifier;
 struct Module;
+struct TokenCache;
 
 /* Tokens:
         (       )
@@ -254,7 +255,6 @@ struct Token
 #endif
 
     static const char *tochars[TOKMAX];
-    static void *operator new(size_t sz);
 
     Token() : next(NULL) {}
     int isKeyword();
@@ -266,8 +266,20 @@ struct Token
 struct Lexer
 {
     static StringTable stringtable;
-    static OutBuffer stringbuffer;
-    static Token *freelist;
+    static int uniqueIds;               // number made by uniqueId(s)
+
+    /* These are per Lexer rather than static so that
+     * separate threads can each run their own Lexer.
+     */
+    OutBuffer stringbuffer;
+
+    /* Tokens looked ahead at, past token, in a ring buffer
+     * so peeking neither allocates nor chases pointers.
+     */
+    Token *ahead;
+    unsigned aheadmax;          // size of ahead[], a power of 2
+    unsigned aheadstart;        // index in ahead[] of the token after token
+    unsigned aheaddim;          // number of tokens in ahead[]
 
     Loc loc;                    // for error messages
 
@@ -279,12 +291,21 @@ struct Lexer
     int doDocComment;           // collect doc comment information
     int anyToken;               // !=0 means seen at least one token
     int commentToken;           // !=0 means comments are TOKcomment's
+    TokenCache *tokcache;       // if !=NULL, get tokens through it
+    int uncacheable;            // !=0 means tokens depend on more than the source
+
+    /* With -j, the identifiers this Lexer has looked up,
+     * so it need not take global.mutex for each one.
+     */
+    enum { IDCACHESIZE = 1024 }; // a power of 2
+    Identifier **idcache;       // NULL until needed
 
     Lexer(Module *mod,
         unsigned char *base, size_t begoffset, size_t endoffset,
         int doDocComment, int commentToken);
 
     static void initKeywords();
+    Identifier *idLookup(const char *s, size_t len);
     static Identifier *idPool(const char *s);
     static Identifier *uniqueId(const char *s);
     static Identifier *uniqueId(const char *s, int num);
@@ -294,6 +315,7 @@ struct Lexer
     TOK peekNext2();
     void scan(Token *t);
     Token *peek(Token *t);
+    void growAhead();
     Token *peekPastParen(Token *t);
     unsigned escapeSequence();
     TOK wysiwygStringConstant(Token *t, int tc);
@@ -361,7 +361,7 @@ void LibMSCoff::addObject(const char *module_name, void *buf, size_t buflen)
 #endif
       Lcorrupt:
         error("corrupt object module %s %d", module_name, reason);
-        exit(EXIT_FAILURE);
+        fatal();
     }
 
     if (memcmp(buf, "!<arch>\n", 8) == 0)
@@ -18,11 +18,16 @@
 
 #if linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 #include "rmem.h"
 #include "root.h"
 #include "async.h"
+#include "thread.h"
 
 #include "mars.h"
 #include "module.h"
@@ -33,6 +38,10 @@
 #include "lexer.h"
 #include "lib.h"
 #include "json.h"
+#include "template.h"
+#include "vtime.h"
+#include "incremental.h"
+#include "server.h"
 
 #if WINDOWS_SEH
 #include <windows.h>
@@ -210,6 +219,9 @@ void deprecation(Loc loc, const char *format, ...)
 void verrorPrint(Loc loc, const char *header, const char *format, va_list ap,
                 const char *p1, const char *p2)
 {
+    if (global.mutex)
+        global.mutex->lock();   // don't interleave messages from other threads
+
     char *p = loc.toChars();
 
     if (*p)
@@ -231,12 +243,17 @@ void verrorPrint(Loc loc, const char *header, const char *format, va_list ap,
 #endif
     fprintf(stdmsg, "\n");
     fflush(stdmsg);
+
+    if (global.mutex)
+        global.mutex->unlock();
 }
 
 // header is "Error: " by default (see mars.h)
 void verror(Loc loc, const char *format, va_list ap,
                 const char *p1, const char *p2, const char *header)
 {
+    if (global.mutex)
+        global.mutex->lock();
     if (!global.gag)
     {
         verrorPrint(loc, header, format, ap, p1, p2);
@@ -249,6 +266,8 @@ void verror(Loc loc, const char *format, va_list ap,
         global.gaggedErrors++;
     }
     global.errors++;
+    if (global.mutex)
+        global.mutex->unlock();
 }
 
 // Doesn't increase error count, doesn't print "Error:".
@@ -262,10 +281,14 @@ void vwarning(Loc loc, const char *format, va_list ap)
 {
     if (global.params.warnings && !global.gag)
     {
+        if (global.mutex)
+            global.mutex->lock();
         verrorPrint(loc, "Warning: ", format, ap);
 //halt();
         if (global.params.warnings == 1)
             global.warnings++;  // warnings don't count if gagged
+        if (global.mutex)
+            global.mutex->unlock();
     }
 }
 
@@ -289,6 +312,7 @@ void fatal()
 #if 0
     halt();
 #endif
+    VTime::term();
     exit(EXIT_FAILURE);
 }
 
@@ -326,6 +350,7 @@ Usage:\n\
   files.d        D source files\n\
   @cmdfile       read arguments from cmdfile\n\
   -c             do not link\n\
+  -cache=dir     cache lexed source files in directory dir\n\
   -cov           do code coverage analysis\n\
   -D             generate documentation\n\
   -Dddocdir      write documentation file to docdir directory\n\
@@ -346,9 +371,13 @@ Usage:\n\
   -Hddirectory   write 'header' file to directory\n\
   -Hffilename    write 'header' file to filename\n\
   --help         print help\n\
+  --client=socket  have the server on socket do the compile, if there is one\n\
+  --server=socket  do compiles sent to socket, keeping what they import analyzed\n\
   -Ipath         where to look for imports\n\
   -ignore        ignore unsupported pragmas\n\
+  -incremental   compile only modules whose object files are out of date\n\
   -inline        do function inlining\n\
+  -j=N           parse, and generate separate object files, N at a time\n\
   -Jpath         where to look for string imports\n\
   -Llinkerflag   pass linkerflag to link\n\
   -lib           generate library rather than object files\n"
@@ -358,6 +387,7 @@ Usage:\n\
 #endif
 "  -man           open web browser on manual page\n\
   -map           generate linker .map file\n\
+  -mcpu=id       with -O, schedule for CPU id: pentium, pentiumpro, modern\n\
   -noboundscheck turns off array bounds checking for all functions\n\
   -O             optimize\n\
   -o-            do not write object file\n\
@@ -367,6 +397,7 @@ Usage:\n\
   -profile       profile runtime performance of generated code\n\
   -property      enforce property syntax\n\
   -quiet         suppress unnecessary messages\n\
+  -regcolor      with -O, color register variables' live ranges all at once\n\
   -release       compile release version\n\
   -run srcfile args...   run resulting program, passing args\n"
 #if TARGET_LINUX || TARGET_OSX || TARGET_FREEBSD || TARGET_OPENBSD || TARGET_SOLARIS
@@ -376,7 +407,10 @@ Usage:\n\
   -v             verbose\n\
   -version=level compile in version code >= level\n\
   -version=ident compile in version code identified by ident\n\
+  -vtemplates    list statistics on template instantiations\n\
   -vtls          list all variables going into thread local storage\n\
+  -vtime         report time and memory used by each phase and module\n\
+  -vtime=filename  and write the trace to filename\n\
   -w             warnings as errors (compilation will halt)\n\
   -wi            warnings as messages (compilation will continue)\n\
   -X             generate JSON file\n\
@@ -386,6 +420,241 @@ Usage:\n\
 
 extern signed char tyalignsize[];
 
+#define ASYNCREAD 1
+
+/*******************************************
+ * For -j, the work shared by the threads parsing the source files.
+ */
+
+struct ParseJobs
+{
+    Modules *modules;
+#if ASYNCREAD
+    AsyncRead *aw;
+#endif
+    int *readresult;            // result of reading each file
+};
+
+static void parseJob(void *arg, size_t i)
+{
+    ParseJobs *pj = (ParseJobs *)arg;
+    Module *m = (*pj->modules)[i];
+#if ASYNCREAD
+    pj->readresult[i] = pj->aw->read(i);
+    if (pj->readresult[i])
+        return;
+#endif
+    m->parseSource();
+}
+
+static size_t nroots;           // number of modules compiled by this process
+
+/*******************************************
+ * Generate the object file for one module, when not generating
+ * a single object file for all of them.
+ */
+
+static void genObjFile(Module *m, Library *library)
+{
+    if (global.params.verbose)
+        printf("code      %s\n", m->toChars());
+    if (global.params.obj)
+    {   obj_start(m->srcfile->toChars());
+        m->genobjfile(global.params.multiobj);
+        obj_end(library, m->objfile);
+        obj_write_deferred(library);
+    }
+    if (global.errors)
+    {
+        if (!global.params.lib)
+            m->deleteObjFile();
+    }
+    else
+    {
+        if (global.params.doDocComments)
+            m->gendocfile();
+        if (global.params.incremental && global.params.obj)
+            Incremental::write(m, nroots);
+    }
+}
+
+#if linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun
+/*******************************************
+ * Wait for worker process pid, or any of them if pid is -1,
+ * and count its failure as an error.
+ */
+
+static void waitWorker(pid_t pid)
+{
+    int status;
+    if (waitpid(pid, &status, 0) == -1)
+        global.errors++;
+    else if (WIFSIGNALED(status))
+    {
+        printf("--- killed by signal %d\n", WTERMSIG(status));
+        global.errors++;
+    }
+    else if (WEXITSTATUS(status))
+        global.errors++;    // the worker has already printed the errors
+}
+
+/*******************************************
+ * For -j, generate the object files by forking jobs-1 worker processes
+ * once semantic analysis is done. Each worker, the parent included,
+ * takes the next module from a counter in shared memory and runs the
+ * back end on it, in its own copy-on-write image of the compiler state.
+ * Returns:
+ *      false if the workers couldn't be set up, and nothing was done
+ */
+
+static bool genObjFilesParallel(Modules *modules, unsigned jobs)
+{
+    size_t *next = (size_t *)mmap(NULL, sizeof(size_t), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANON, -1, 0);
+    if (next == MAP_FAILED)
+        return false;
+    *next = 0;
+
+    // For -vtime, where the workers leave their times for the parent
+    VTimeStats *times = NULL;
+    size_t timessize = modules->dim * sizeof(VTimeStats);
+    if (global.params.vtime)
+    {
+        times = (VTimeStats *)mmap(NULL, timessize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANON, -1, 0);
+        if (times == MAP_FAILED)
+        {   munmap(next, sizeof(size_t));
+            return false;
+        }
+        memset(times, 0, timessize);
+    }
+
+    // Don't let the children inherit, and repeat, buffered output
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pids[64];
+    unsigned nworkers = 0;
+    while (nworkers + 1 < jobs && nworkers + 1 < modules->dim)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            while (1)
+            {   size_t i = __sync_fetch_and_add(next, 1);
+                if (i >= modules->dim)
+                    break;
+                Module *m = (*modules)[i];
+                genObjFile(m, NULL);
+                if (times && m->times)
+                    times[i] = m->times[PHASEcodegen];
+            }
+            fflush(stdout);
+            fflush(stderr);
+            _exit(global.errors ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+        if (pid == -1)
+            break;              // make do with the workers we have
+        pids[nworkers++] = pid;
+    }
+
+    while (1)
+    {   size_t i = __sync_fetch_and_add(next, 1);
+        if (i >= modules->dim)
+            break;
+        genObjFile((*modules)[i], NULL);
+    }
+
+    for (unsigned w = 0; w < nworkers; w++)
+        waitWorker(pids[w]);
+    if (times)
+    {
+        for (size_t i = 0; i < modules->dim; i++)
+        {
+            if (times[i].wall)
+                VTime::addWorker((*modules)[i], &times[i]);
+        }
+        munmap(times, timessize);
+    }
+    munmap(next, sizeof(size_t));
+    return true;
+}
+#endif
+
+/*******************************************
+ * For -incremental, drop the modules whose object files are up to date.
+ * If more than one is left, each is compiled by a process of its own,
+ * up to jobs at a time, so that its object file has all it needs whatever
+ * gets recompiled next time; this process waits for them, and links.
+ * Output:
+ *      others  the roots dropped from modules, which imports must
+ *              still find, in the process(es) that compile the rest
+ */
+
+static void compileIncremental(Modules *modules, Modules *others, size_t argc, char *argv[])
+{
+    Incremental::init(argc, argv);
+
+    Modules roots;
+    roots.append(modules);
+    modules->setDim(0);
+    for (size_t i = 0; i < roots.dim; i++)
+    {   Module *m = roots[i];
+        if (!Incremental::upToDate(m, &roots))
+            modules->push(m);
+        else
+        {
+            if (global.params.verbose)
+                printf("uptodate  %s\n", m->toChars());
+            others->push(m);
+        }
+    }
+
+#if linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun
+    if (modules->dim > 1)
+    {
+        // Don't let the children inherit, and repeat, buffered output
+        fflush(stdout);
+        fflush(stderr);
+
+        unsigned running = 0;
+        for (size_t i = 0; i < modules->dim; i++)
+        {
+            if (running == global.params.jobs)
+            {   waitWorker(-1);
+                running--;
+            }
+            pid_t pid = fork();
+            if (pid == 0)
+            {   // Compile just m, and leave the linking to the parent
+                Module *m = (*modules)[i];
+                others->setDim(0);
+                for (size_t j = 0; j < roots.dim; j++)
+                {
+                    if (roots[j] != m)
+                        others->push(roots[j]);
+                }
+                modules->setDim(0);
+                modules->push(m);
+                global.params.link = 0;
+                return;
+            }
+            if (pid == -1)
+            {   error(0, "cannot fork to compile %s", (*modules)[i]->srcfile->toChars());
+                break;
+            }
+            running++;
+        }
+        while (running--)
+            waitWorker(-1);
+        if (global.errors)
+            fatal();
+        modules->setDim(0);
+        others->setDim(0);
+    }
+#endif
+}
+
 #if _WIN32 && __DMC__
 extern "C"
 {
@@ -434,6 +703,25 @@ int tryMain(size_t argc, char *argv[])
     if (response_expand(&argc,&argv))   // expand response files
         error(0, "can't open response file");
 
+    for (size_t i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-run") == 0)
+            break;                      // the rest are the program's
+        if (memcmp(argv[i], "--client=", 9) == 0)
+        {
+            int status = Server::client(argv[i] + 9, argc, argv);
+            if (status != -1)
+                return status;
+
+            // No server, so compile here
+            memmove(&argv[i], &argv[i + 1], (argc - i - 1) * sizeof(char *));
+            argc--;
+            if (i < argcstart)
+                argcstart--;
+            break;
+        }
+    }
+
     files.reserve(argc - 1);
 
     // Set default values
@@ -450,6 +738,7 @@ int tryMain(size_t argc, char *argv[])
     global.params.Dversion = 2;
     global.params.quiet = 1;
     global.params.useDeprecated = 2;
+    global.params.jobs = 1;
 
     global.params.linkswitches = new Strings();
     global.params.libfiles = new Strings();
@@ -556,6 +845,12 @@ int tryMain(size_t argc, char *argv[])
                 global.params.link = 0;
             else if (strcmp(p + 1, "cov") == 0)
                 global.params.cov = 1;
+            else if (memcmp(p + 1, "cache=", 6) == 0)
+            {
+                global.params.cachedir = p + 1 + 6;
+                if (!global.params.cachedir[0])
+                    goto Lnoarg;
+            }
 #if TARGET_LINUX || TARGET_OSX || TARGET_FREEBSD || TARGET_OPENBSD || TARGET_SOLARIS
             else if (strcmp(p + 1, "shared") == 0
 #if TARGET_OSX
@@ -585,6 +880,19 @@ int tryMain(size_t argc, char *argv[])
                 global.params.is64bit = 0;
             else if (strcmp(p + 1, "m64") == 0)
                 global.params.is64bit = 1;
+            else if (memcmp(p + 1, "mcpu=", 5) == 0)
+            {
+                if (strcmp(p + 6, "pentium") == 0)
+                    global.params.cpu = CPUpentium;
+                else if (strcmp(p + 6, "pentiumpro") == 0)
+                    global.params.cpu = CPUpentiumpro;
+                else if (strcmp(p + 6, "modern") == 0)
+                    global.params.cpu = CPUmodern;
+                else if (!p[6])
+                    goto Lnoarg;
+                else
+                    goto Lerror;
+            }
             else if (strcmp(p + 1, "profile") == 0)
                 global.params.trace = 1;
             else if (strcmp(p + 1, "v") == 0)
@@ -593,6 +901,17 @@ int tryMain(size_t argc, char *argv[])
             else if (strcmp(p + 1, "vtls") == 0)
                 global.params.vtls = 1;
 #endif
+            else if (strcmp(p + 1, "vtemplates") == 0)
+                global.params.vtemplates = 1;
+            else if (strcmp(p + 1, "vtime") == 0)
+                global.params.vtime = 1;
+            else if (memcmp(p + 1, "vtime=", 6) == 0)
+            {
+                global.params.vtime = 1;
+                global.params.vtimefile = p + 1 + 6;
+                if (!global.params.vtimefile[0])
+                    goto Lnoarg;
+            }
             else if (strcmp(p + 1, "v1") == 0)
             {
 #if DMDV1
@@ -608,6 +927,8 @@ int tryMain(size_t argc, char *argv[])
                 global.params.warnings = 2;
             else if (strcmp(p + 1, "O") == 0)
                 global.params.optimize = 1;
+            else if (strcmp(p + 1, "regcolor") == 0)
+                global.params.regcolor = 1;
             else if (p[1] == 'o')
             {
                 switch (p[2])
@@ -708,6 +1029,8 @@ int tryMain(size_t argc, char *argv[])
                 global.params.ignoreUnsupportedPragmas = 1;
             else if (strcmp(p + 1, "property") == 0)
                 global.params.enforcePropertySyntax = 1;
+            else if (strcmp(p + 1, "incremental") == 0)
+                global.params.incremental = 1;
             else if (strcmp(p + 1, "inline") == 0)
                 global.params.useInline = 1;
             else if (strcmp(p + 1, "lib") == 0)
@@ -789,6 +1112,18 @@ int tryMain(size_t argc, char *argv[])
                 else
                     goto Lerror;
             }
+            else if (memcmp(p + 1, "j=", 2) == 0)
+            {
+                // Parse:
+                //      -j=number
+                long jobs;
+
+                errno = 0;
+                jobs = strtol(p + 3, &p, 10);
+                if (*p || errno || jobs < 1 || jobs > 64)
+                    goto Lerror;
+                global.params.jobs = (unsigned)jobs;
+            }
             else if (strcmp(p + 1, "-b") == 0)
                 global.params.debugb = 1;
             else if (strcmp(p + 1, "-c") == 0)
@@ -799,6 +1134,12 @@ int tryMain(size_t argc, char *argv[])
             {   usage();
                 exit(EXIT_SUCCESS);
             }
+            else if (memcmp(p + 1, "-server=", 8) == 0)
+            {
+                global.params.server = p + 1 + 8;
+                if (!global.params.server[0])
+                    goto Lnoarg;
+            }
             else if (strcmp(p + 1, "-r") == 0)
                 global.params.debugr = 1;
             else if (strcmp(p + 1, "-x") == 0)
@@ -913,7 +1254,14 @@ int tryMain(size_t argc, char *argv[])
     {
         fatal();
     }
-    if (files.dim == 0)
+    if (global.params.server)
+    {
+        if (files.dim || global.params.moduleDeps)
+        {   error(0, "--server takes no source files, -run or -deps");
+            fatal();
+        }
+    }
+    else if (files.dim == 0)
     {   usage();
         return EXIT_FAILURE;
     }
@@ -953,8 +1301,11 @@ int tryMain(size_t argc, char *argv[])
     if (global.params.link)
     {
         global.params.exefile = global.params.objname;
-        global.params.oneobj = 1;
-        if (global.params.objname)
+        if (global.params.incremental)
+        {   // Each module keeps its own object file
+            global.params.objname = NULL;
+        }
+        else if (global.params.objname)
         {
             /* Use this to name the one object file with the same
              * name as the exe file.
@@ -969,6 +1320,8 @@ int tryMain(size_t argc, char *argv[])
                 global.params.objname = FileName::combine(global.params.objdir, name);
             }
         }
+        if (!global.params.incremental)
+            global.params.oneobj = 1;
     }
     else if (global.params.lib)
     {
@@ -1093,8 +1446,19 @@ int tryMain(size_t argc, char *argv[])
         }
     }
 
+    if (global.params.server)
+    {
+        Server::run(global.params.server, argc, argv, &files);
+
+        // Now there are files, as for the command line
+        if (!global.params.link && !global.params.lib &&
+            global.params.objname && files.dim > 1)
+            global.params.oneobj = 1;
+    }
+
     // Create Modules
     Modules modules;
+    Modules incrementalOthers;          // roots compiled by other processes, or up to date
     modules.reserve(files.dim);
     int firstmodule = 1;
     for (size_t i = 0; i < files.dim; i++)
@@ -1211,14 +1575,38 @@ int tryMain(size_t argc, char *argv[])
         m = new Module(files[i], id, global.params.doDocComments, global.params.doHdrGeneration);
         modules.push(m);
 
-        if (firstmodule)
+        if (firstmodule || global.params.incremental)
         {   global.params.objfiles->push(m->objfile->name->str);
             firstmodule = 0;
         }
     }
 
+    if (global.params.cachedir)
+        FileName::ensurePathExists(global.params.cachedir);
+
+    if (global.params.vtime)
+    {
+        char *tracefile = global.params.vtimefile;
+        if (!tracefile && global.params.objfiles->dim)
+        {   // Generate trace file name from first obj name
+            char *n = FileName::name((*global.params.objfiles)[0]);
+            tracefile = FileName::forceExt(n, "trace.json")->toChars();
+        }
+        VTime::init(tracefile);
+    }
+
+    if (global.params.incremental)
+    {
+        if (global.params.lib || global.params.run || global.params.oneobj ||
+            global.params.doXGeneration || global.params.moduleDeps)
+        {   error(0, "-incremental cannot be used with -lib, -run, -X, -deps, or -of with -c and more than one source file");
+            fatal();
+        }
+        compileIncremental(&modules, &incrementalOthers, argc, argv);
+    }
+    nroots = modules.dim;
+
     // Read files
-#define ASYNCREAD 1
 #if ASYNCREAD
     // Multi threaded
     AsyncRead *aw = AsyncRead::create(modules.dim);
@@ -1238,8 +1626,27 @@ int tryMain(size_t argc, char *argv[])
 #endif
 
     // Parse files
+    VTime::phase(PHASEparse);
     bool anydocfiles = false;
     size_t filecount = modules.dim;
+    ParseJobs pj;
+    pj.modules = &modules;
+#if ASYNCREAD
+    pj.aw = aw;
+#endif
+    pj.readresult = NULL;
+    if (global.params.jobs > 1 && filecount > 1)
+    {
+        /* Lex and parse all the files in parallel. Adding the modules
+         * to the global tables is done serially in the loop below,
+         * so it happens in command line order.
+         */
+        pj.readresult = (int *)mem.calloc(filecount, sizeof(int));
+        global.mutex = Mutex::create();
+        Thread::parallelFor(filecount, global.params.jobs, &parseJob, &pj);
+        Mutex::dispose(global.mutex);
+        global.mutex = NULL;
+    }
     for (size_t filei = 0, modi = 0; filei < filecount; filei++, modi++)
     {
         m = modules[modi];
@@ -1250,14 +1657,27 @@ int tryMain(size_t argc, char *argv[])
         m->importedFrom = m;
         if (!global.params.oneobj || modi == 0 || m->isDocFile)
             m->deleteObjFile();
-#if ASYNCREAD
-        if (aw->read(filei))
+        if (pj.readresult)
         {
-            error(0, "cannot read file %s", m->srcfile->name->toChars());
-            fatal();
+            if (pj.readresult[filei])
+            {
+                error(0, "cannot read file %s", m->srcfile->name->toChars());
+                fatal();
+            }
+            if (!m->isDocFile)
+                m->declare();
         }
+        else
+        {
+#if ASYNCREAD
+            if (aw->read(filei))
+            {
+                error(0, "cannot read file %s", m->srcfile->name->toChars());
+                fatal();
+            }
 #endif
-        m->parse();
+            m->parse();
+        }
         if (m->isDocFile)
         {
             anydocfiles = true;
@@ -1284,6 +1704,7 @@ int tryMain(size_t argc, char *argv[])
 #if ASYNCREAD
     AsyncRead::dispose(aw);
 #endif
+    mem.free(pj.readresult);
 
     if (anydocfiles && modules.dim &&
         (global.params.oneobj || global.params.objname))
@@ -1293,6 +1714,23 @@ int tryMain(size_t argc, char *argv[])
     }
     if (global.errors)
         fatal();
+
+    /* The roots -incremental isn't compiling here are still what their
+     * module names refer to, wherever they are, so enter them in the
+     * module table for imports to find. They are then analyzed only as
+     * far as imports are. Any errors in them are left for the process
+     * compiling them to report.
+     */
+    for (size_t i = 0; i < incrementalOthers.dim; i++)
+    {
+        m = incrementalOthers[i];
+        unsigned errors = global.startGagging();
+        if (m->read(0))
+            m->parseSource();
+        if (!global.endGagging(errors) && !m->isDocFile)
+            m->declare();
+    }
+    VTime::phase(PHASEimport);
     if (global.params.doHdrGeneration)
     {
         /* Generate 'header' import files.
@@ -1311,6 +1749,9 @@ int tryMain(size_t argc, char *argv[])
     if (global.errors)
         fatal();
 
+    if (global.params.server && modules.dim)
+        Server::adopt(modules[0]);
+
     // load all unconditional imports for better symbol resolving
     for (size_t i = 0; i < modules.dim; i++)
     {
@@ -1325,6 +1766,7 @@ int tryMain(size_t argc, char *argv[])
     backend_init();
 
     // Do semantic analysis
+    VTime::phase(PHASEsemantic);
     for (size_t i = 0; i < modules.dim; i++)
     {
         m = modules[i];
@@ -1339,6 +1781,7 @@ int tryMain(size_t argc, char *argv[])
     Module::runDeferredSemantic();
 
     // Do pass 2 semantic analysis
+    VTime::phase(PHASEsemantic2);
     for (size_t i = 0; i < modules.dim; i++)
     {
         m = modules[i];
@@ -1350,6 +1793,7 @@ int tryMain(size_t argc, char *argv[])
         fatal();
 
     // Do pass 3 semantic analysis
+    VTime::phase(PHASEsemantic3);
     for (size_t i = 0; i < modules.dim; i++)
     {
         m = modules[i];
@@ -1360,30 +1804,29 @@ int tryMain(size_t argc, char *argv[])
     if (global.errors)
         fatal();
 
+    // Scan for functions to inline
     if (global.params.useInline)
     {
-        /* The problem with useArrayBounds and useAssert is that the
-         * module being linked to may not have generated them, so if
-         * we inline functions from those modules, the symbols for them will
-         * not be found at link time.
-         * We must do this BEFORE generating the .deps file!
-         */
-        if (!global.params.useArrayBounds && !global.params.useAssert)
+        VTime::phase(PHASEinline);
+        for (size_t i = 0; i < modules.dim; i++)
         {
-            // Do pass 3 semantic analysis on all imported modules,
-            // since otherwise functions in them cannot be inlined
-            for (size_t i = 0; i < Module::amodules.dim; i++)
-            {
-                m = Module::amodules[i];
-                if (global.params.verbose)
-                    printf("semantic3 %s\n", m->toChars());
-                m->semantic3();
-            }
-            if (global.errors)
-                fatal();
+            m = modules[i];
+            if (global.params.verbose)
+                printf("inline scan %s\n", m->toChars());
+            m->inlineScan();
         }
     }
 
+    /* Report the imports and write the .deps file only now, since
+     * the inline scan runs semantic3 on the imported functions it
+     * inlines, which may import yet more modules. So may analyzing
+     * what a compile by the server adopts.
+     */
+    if (global.params.server)
+    {   Server::adoptUsed(&modules);
+        Server::reportImports();
+    }
+
     if (global.params.moduleDeps != NULL)
     {
         assert(global.params.moduleDepsFile != NULL);
@@ -1394,24 +1837,15 @@ int tryMain(size_t argc, char *argv[])
         deps.writev();
     }
 
-    // Scan for functions to inline
-    if (global.params.useInline)
-    {
-        for (size_t i = 0; i < modules.dim; i++)
-        {
-            m = modules[i];
-            if (global.params.verbose)
-                printf("inline scan %s\n", m->toChars());
-            m->inlineScan();
-        }
-    }
-
     // Do not attempt to generate output files if errors or warnings occurred
     if (global.errors || global.warnings)
         fatal();
 
     printCtfePerformanceStats();
+    if (global.params.vtemplates)
+        TemplateStats::report();
 
+    VTime::phase(PHASEcodegen);
     Library *library = NULL;
     if (global.params.lib)
     {
@@ -1451,27 +1885,19 @@ int tryMain(size_t argc, char *argv[])
     }
     else
     {
-        for (size_t i = 0; i < modules.dim; i++)
+        bool done = false;
+#if linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun
+        /* The library, and the naming of the extra -multiobj objects,
+         * need all the object files to be generated in this process.
+         */
+        if (global.params.jobs > 1 && modules.dim > 1 && global.params.obj &&
+            !library && !global.params.multiobj)
+            done = genObjFilesParallel(&modules, global.params.jobs);
+#endif
+        if (!done)
         {
-            m = modules[i];
-            if (global.params.verbose)
-                printf("code      %s\n", m->toChars());
-            if (global.params.obj)
-            {   obj_start(m->srcfile->toChars());
-                m->genobjfile(global.params.multiobj);
-                obj_end(library, m->objfile);
-                obj_write_deferred(library);
-            }
-            if (global.errors)
-            {
-                if (!global.params.lib)
-                    m->deleteObjFile();
-            }
-            else
-            {
-                if (global.params.doDocComments)
-                    m->gendocfile();
-            }
+            for (size_t i = 0; i < modules.dim; i++)
+                genObjFile(modules[i], library);
         }
     }
 
@@ -1482,6 +1908,7 @@ int tryMain(size_t argc, char *argv[])
     if (global.errors)
         fatal();
 
+    VTime::phase(PHASElink);
     int status = EXIT_SUCCESS;
     if (!global.params.objfiles->dim)
     {
@@ -1492,6 +1919,7 @@ int tryMain(size_t argc, char *argv[])
     {
         if (global.params.link)
             status = runLINK();
+        VTime::term();
 
         if (global.params.run)
         {
@@ -1513,6 +1941,7 @@ int tryMain(size_t argc, char *argv[])
         }
     }
 
+    VTime::term();
     return status;
 }
 
@@ -126,6 +126,7 @@ void unittests();
 
 
 struct OutBuffer;
+struct Mutex;
 
 // Can't include arraytypes.h here, need to declare these directly.
 template <typename TYPE> struct ArrayBase;
@@ -145,11 +146,16 @@ struct Param
     char quiet;         // suppress non-error messages
     char verbose;       // verbose compile
     char vtls;          // identify thread local variables
+    char vtime;         // report where the compile time goes
+    char vtemplates;    // report what template instantiation costs
+    char incremental;   // compile only modules whose object files are out of date
+    char *server;       // --server: socket to listen on for compiles
     char symdebug;      // insert debug symbolic information
     bool alwaysframe;   // always emit standard stack frame
     bool optimize;      // run optimizer
+    bool regcolor;      // -regcolor: color register variables all at once
     char map;           // generate linker .map file
-    char cpu;           // target CPU
+    char cpu;           // target CPU to schedule for (CPUxxxx), -mcpu=
     char is64bit;       // generate 64 bit code
     char isLinux;       // generate code for linux
     char isOSX;         // generate code for Mac OSX
@@ -184,6 +190,7 @@ struct Param
     char ignoreUnsupportedPragmas;      // rather than error on them
     char enforcePropertySyntax;
     char betterC;       // be a "better C" compiler; no dependency on D runtime
+    unsigned jobs;      // -j: number of threads/processes to run at once
 
     char *argv0;        // program name
     Strings *imppath;     // array of char*'s of where to look for import modules
@@ -218,6 +225,9 @@ struct Param
     char *moduleDepsFile;       // filename for deps output
     OutBuffer *moduleDeps;      // contents to be written to deps file
 
+    char *cachedir;             // -cache: directory for cached token streams
+    char *vtimefile;            // -vtime: trace file name
+
     // Hidden debug switches
     char debuga;
     char debugb;
@@ -273,6 +283,11 @@ struct Global
     unsigned gag;          // !=0 means gag reporting of errors & warnings
     unsigned gaggedErrors; // number of errors reported while gagged
 
+    /* Only set while more than one thread is running the front end,
+     * in which case it guards the shared tables (identifiers, diagnostics).
+     */
+    Mutex *mutex;
+
     /* Gagging can either be speculative (is(typeof()), etc)
      * or because of forward references
      */
@@ -402,6 +417,15 @@ enum LINK
     LINKpascal,
 };
 
+// Values for Param.cpu
+enum CPU
+{
+    CPUdefault,         // whatever the back end picks
+    CPUpentium,         // Pentium, Pentium MMX
+    CPUpentiumpro,      // Pentium Pro, II, III
+    CPUmodern,          // current out of order x86-64 cores
+};
+
 enum DYNCAST
 {
     DYNCAST_OBJECT,
@@ -36,6 +36,9 @@
 #include "dsymbol.h"
 #include "hdrgen.h"
 #include "lexer.h"
+#include "tokcache.h"
+#include "vtime.h"
+#include "incremental.h"
 
 #ifdef IN_GCC
 #include "d-dmd-gcc.h"
@@ -49,6 +52,7 @@ Modules Module::amodules;
 
 Dsymbols Module::deferred; // deferred Dsymbol's needing semantic() run on them
 unsigned Module::dprogress;
+unsigned Module::searchCutoffs;
 
 void Module::init()
 {
@@ -79,6 +83,10 @@ Module::Module(char *filename, Identifier *ident, int doDocComment, int doHdrGen
     searchCacheSymbol = NULL;
     searchCacheFlags = 0;
     semanticstarted = 0;
+    times = NULL;
+    srchash = 0;
+    ifacehash = 0;
+    bodyUsed = 0;
     semanticRun = 0;
     decldefs = NULL;
     vmoduleinfo = NULL;
@@ -278,41 +286,7 @@ Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
     m = new Module(filename, ident, 0, 0);
     m->loc = loc;
 
-    /* Search along global.path for .di file, then .d file.
-     */
-    char *result = NULL;
-    FileName *fdi = FileName::forceExt(filename, global.hdr_ext);
-    FileName *fd  = FileName::forceExt(filename, global.mars_ext);
-    char *sdi = fdi->toChars();
-    char *sd  = fd->toChars();
-
-    if (FileName::exists(sdi))
-        result = sdi;
-    else if (FileName::exists(sd))
-        result = sd;
-    else if (FileName::absolute(filename))
-        ;
-    else if (!global.path)
-        ;
-    else
-    {
-        for (size_t i = 0; i < global.path->dim; i++)
-        {
-            char *p = (*global.path)[i];
-            char *n = FileName::combine(p, sdi);
-            if (FileName::exists(n))
-            {   result = n;
-                break;
-            }
-            mem.free(n);
-            n = FileName::combine(p, sd);
-            if (FileName::exists(n))
-            {   result = n;
-                break;
-            }
-            mem.free(n);
-        }
-    }
+    char *result = lookForSourceFile(filename);
     if (result)
         m->srcfile = new File(result);
 
@@ -341,10 +315,46 @@ Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
     return m;
 }
 
+/************************************
+ * Search along global.path for the .di file, then the .d file,
+ * of the module whose file name, without extension, is filename.
+ * Returns:
+ *      the file name found, NULL if none
+ */
+
+char *Module::lookForSourceFile(char *filename)
+{
+    FileName *fdi = FileName::forceExt(filename, global.hdr_ext);
+    FileName *fd  = FileName::forceExt(filename, global.mars_ext);
+    char *sdi = fdi->toChars();
+    char *sd  = fd->toChars();
+
+    if (FileName::existsCached(sdi))
+        return sdi;
+    if (FileName::existsCached(sd))
+        return sd;
+    if (FileName::absolute(filename) || !global.path)
+        return NULL;
+
+    for (size_t i = 0; i < global.path->dim; i++)
+    {
+        char *p = (*global.path)[i];
+        char *n = FileName::combine(p, sdi);
+        if (FileName::existsCached(n))
+            return n;
+        mem.free(n);
+        n = FileName::combine(p, sd);
+        if (FileName::existsCached(n))
+            return n;
+        mem.free(n);
+    }
+    return NULL;
+}
+
 bool Module::read(Loc loc)
 {
     //printf("Module::read('%s') file '%s'\n", toChars(), srcfile->toChars());
-    if (srcfile->read())
+    if (srcfile->mmread())
     {
         if (!strcmp(srcfile->toChars(), "object.d"))
         {
@@ -405,13 +415,29 @@ inline unsigned readlongBE(unsigned *p)
 void Module::parse()
 {
     //printf("Module::parse()\n");
+    parseSource();
+    if (!isDocFile)
+        declare();
+}
+
+/************************************
+ * Convert the source to UTF-8 and parse it into members.
+ * Touches no global tables other than the identifier pool,
+ * so root modules can be parsed in parallel.
+ */
 
+void Module::parseSource()
+{
     char *srcname = srcfile->name->toChars();
-    //printf("Module::parse(srcname = '%s')\n", srcname);
+    //printf("Module::parseSource(srcname = '%s')\n", srcname);
+    VTimeScope vt(this, PHASEparse);
 
     unsigned char *buf = srcfile->buffer;
     size_t buflen = srcfile->len;
 
+    if (global.params.incremental || global.params.server)
+        srchash = Incremental::hash(buf, buflen);
+
     if (buflen >= 2)
     {
         /* Convert all non-UTF-8 formats to UTF-8.
@@ -593,16 +619,28 @@ void Module::parse()
         return;
     }
     Parser p(this, buf, buflen, docfile != NULL);
+    if (global.params.cachedir && !docfile)
+        p.tokcache = TokenCache::open(this, buf, buflen);
     p.nextToken();
     members = p.parseModule();
+    if (p.tokcache)
+    {   p.tokcache->close(&p);
+        delete p.tokcache;
+    }
 
-    ::free(srcfile->buffer);
-    srcfile->buffer = NULL;
-    srcfile->len = 0;
+    srcfile->freeBuffer();
 
     md = p.md;
     numlines = p.loc.linnum;
+}
 
+/************************************
+ * Add the parsed module to the global module and package tables.
+ */
+
+void Module::declare()
+{
+    char *srcname = srcfile->name->toChars();
     DsymbolTable *dst;
 
     if (md)
@@ -648,6 +686,9 @@ void Module::parse()
     {
         amodules.push(this);
     }
+
+    if (global.params.incremental && !isDocFile)
+        Incremental::hashInterface(this);
 }
 
 void Module::importAll(Scope *prevsc)
@@ -662,6 +703,7 @@ void Module::importAll(Scope *prevsc)
         error("is a Ddoc file, cannot import it");
         return;
     }
+    VTimeScope vt(this, PHASEimport);
 
     /* Note that modules get their own scope, from scratch.
      * This is so regardless of where in the syntax a module
@@ -720,6 +762,7 @@ void Module::semantic()
 
     //printf("+Module::semantic(this = %p, '%s'): parent = %p\n", this, toChars(), parent);
     semanticstarted = 1;
+    VTimeScope vt(this, PHASEsemantic);
 
     // Note that modules get their own scope, from scratch.
     // This is so regardless of where in the syntax a module
@@ -802,6 +845,7 @@ void Module::semantic2()
         return;
     assert(semanticstarted == 1);
     semanticstarted = 2;
+    VTimeScope vt(this, PHASEsemantic2);
 
     // Note that modules get their own scope, from scratch.
     // This is so regardless of where in the syntax a module
@@ -830,6 +874,7 @@ void Module::semantic3()
         return;
     assert(semanticstarted == 2);
     semanticstarted = 3;
+    VTimeScope vt(this, PHASEsemantic3);
 
     // Note that modules get their own scope, from scratch.
     // This is so regardless of where in the syntax a module
@@ -857,6 +902,7 @@ void Module::inlineScan()
         return;
     assert(semanticstarted == 3);
     semanticstarted = 4;
+    VTimeScope vt(this, PHASEinline);
 
     // Note that modules get their own scope, from scratch.
     // This is so regardless of where in the syntax a module
@@ -920,7 +966,9 @@ Dsymbol *Module::search(Loc loc, Identifier *ident, int flags)
     //printf("%s Module::search('%s', flags = %d) insearch = %d\n", toChars(), ident->toChars(), flags, insearch);
     Dsymbol *s;
     if (insearch)
-        s = NULL;
+    {   s = NULL;
+        searchCutoffs++;
+    }
     else if (searchCacheIdent == ident && searchCacheFlags == flags)
     {
         s = searchCacheSymbol;
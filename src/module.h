@@ -24,6 +24,7 @@ struct ModuleDeclaration;
 struct Macro;
 struct Escape;
 struct VarDeclaration;
+struct VTimeStats;
 class Library;
 
 // Back end
@@ -52,6 +53,7 @@ struct Module : Package
     static Modules amodules;            // array of all modules
     static Dsymbols deferred;   // deferred Dsymbol's needing semantic() run on them
     static unsigned dprogress;  // progress resolving the deferred list
+    static unsigned searchCutoffs;      // searches that found nothing because of insearch
     static void init();
 
     static ClassDeclaration *moduleinfo;
@@ -110,10 +112,18 @@ struct Module : Package
     size_t nameoffset;          // offset of module name from start of ModuleInfo
     size_t namelen;             // length of module name in characters
 
+    VTimeStats *times;          // -vtime statistics, indexed by PHASE
+
+    d_uns64 srchash;            // -incremental and --server hash of the source
+    d_uns64 ifacehash;          // and of its 'header' file
+    int bodyUsed;               // semantic3 was run on a function of an imported module
+    Strings contentImportedFiles;       // files read by import("file")
+
     Module(char *arg, Identifier *ident, int doDocComment, int doHdrGen);
     ~Module();
 
     static Module *load(Loc loc, Identifiers *packages, Identifier *ident);
+    static char *lookForSourceFile(char *filename);
 
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     void toJsonBuffer(OutBuffer *buf);
@@ -121,6 +131,8 @@ struct Module : Package
     void setDocfile();  // set docfile member
     bool read(Loc loc); // read file, returns 'true' if succeed, 'false' otherwise.
     void parse();       // syntactic parse
+    void parseSource(); // just the parsing part of parse()
+    void declare();     // the rest of parse()
     void importAll(Scope *sc);
     void semantic();    // semantic analysis
     void semantic2();   // pass 2 semantic analysis
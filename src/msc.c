@@ -85,6 +85,22 @@ void backend_init()
     exe = params->pic == 0;
 #endif
 
+    switch (params->cpu)
+    {
+        case CPUpentium:
+            config.target_cpu = TARGET_Pentium;
+            config.target_scheduler = TARGET_Pentium;
+            break;
+        case CPUpentiumpro:
+            config.target_cpu = TARGET_PentiumPro;
+            config.target_scheduler = TARGET_PentiumPro;
+            break;
+        case CPUmodern:
+            // Nothing newer than the Pentium Pro's instructions is selected
+            config.target_cpu = TARGET_PentiumPro;
+            config.target_scheduler = TARGET_Modern;
+            break;
+    }
     out_config_init(
         params->is64bit ? 64 : 32,
         exe,
@@ -95,6 +111,8 @@ void backend_init()
         params->symdebug,
         params->alwaysframe
     );
+    if (params->optimize && params->regcolor)
+        config.flags4 |= CFG4regcolor;
 
 #ifdef DEBUG
     out_config_debug(
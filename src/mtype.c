@@ -505,7 +505,7 @@ Type *Type::unSharedOf()
     if (!t)
     {
         unsigned sz = sizeTy[ty];
-        t = (Type *)mem.malloc(sz);
+        t = (Type *)mem.fmalloc(sz);
         memcpy(t, this, sz);
         t->mod = mod & ~MODshared;
         t->deco = NULL;
@@ -915,7 +915,7 @@ Type *Type::makeConst()
     if (cto)
         return cto;
     unsigned sz = sizeTy[ty];
-    Type *t = (Type *)mem.malloc(sz);
+    Type *t = (Type *)mem.fmalloc(sz);
     memcpy(t, this, sz);
     t->mod = MODconst;
     t->deco = NULL;
@@ -939,7 +939,7 @@ Type *Type::makeInvariant()
     if (ito)
         return ito;
     unsigned sz = sizeTy[ty];
-    Type *t = (Type *)mem.malloc(sz);
+    Type *t = (Type *)mem.fmalloc(sz);
     memcpy(t, this, sz);
     t->mod = MODimmutable;
     t->deco = NULL;
@@ -962,7 +962,7 @@ Type *Type::makeShared()
     if (sto)
         return sto;
     unsigned sz = sizeTy[ty];
-    Type *t = (Type *)mem.malloc(sz);
+    Type *t = (Type *)mem.fmalloc(sz);
     memcpy(t, this, sz);
     t->mod = MODshared;
     t->deco = NULL;
@@ -985,7 +985,7 @@ Type *Type::makeSharedConst()
     if (scto)
         return scto;
     unsigned sz = sizeTy[ty];
-    Type *t = (Type *)mem.malloc(sz);
+    Type *t = (Type *)mem.fmalloc(sz);
     memcpy(t, this, sz);
     t->mod = MODshared | MODconst;
     t->deco = NULL;
@@ -1008,7 +1008,7 @@ Type *Type::makeWild()
     if (wto)
         return wto;
     unsigned sz = sizeTy[ty];
-    Type *t = (Type *)mem.malloc(sz);
+    Type *t = (Type *)mem.fmalloc(sz);
     memcpy(t, this, sz);
     t->mod = MODwild;
     t->deco = NULL;
@@ -1031,7 +1031,7 @@ Type *Type::makeSharedWild()
     if (swto)
         return swto;
     unsigned sz = sizeTy[ty];
-    Type *t = (Type *)mem.malloc(sz);
+    Type *t = (Type *)mem.fmalloc(sz);
     memcpy(t, this, sz);
     t->mod = MODshared | MODwild;
     t->deco = NULL;
@@ -1052,7 +1052,7 @@ Type *Type::makeSharedWild()
 Type *Type::makeMutable()
 {
     unsigned sz = sizeTy[ty];
-    Type *t = (Type *)mem.malloc(sz);
+    Type *t = (Type *)mem.fmalloc(sz);
     memcpy(t, this, sz);
     t->mod =  mod & MODshared;
     t->deco = NULL;
@@ -108,8 +108,8 @@ DMD_OBJS = \
 	type.o typinf.o util.o var.o version.o strtold.o utf.o staticassert.o \
 	toobj.o toctype.o toelfdebug.o entity.o doc.o macro.o \
 	hdrgen.o delegatize.o aa.o ti_achar.o toir.o interpret.o traits.o \
-	builtin.o ctfeexpr.o clone.o aliasthis.o \
-	man.o arrayop.o port.o response.o async.o json.o speller.o aav.o unittests.o \
+	builtin.o ctfecode.o ctfeexpr.o clone.o aliasthis.o \
+	man.o arrayop.o port.o response.o async.o thread.o json.o tokcache.o vtime.o incremental.o server.o speller.o aav.o unittests.o \
 	imphint.o argtypes.o ti_pvoid.o apply.o sideeffect.o \
 	intrange.o canthrow.o \
 	pdata.o cv8.o backconfig.o \
@@ -138,10 +138,10 @@ SRC = win32.mak posix.mak \
 	delegatize.c toir.h toir.c interpret.c traits.c cppmangle.c \
 	builtin.c clone.c lib.h libomf.c libelf.c libmach.c arrayop.c \
 	libmscoff.c \
-	aliasthis.h aliasthis.c json.h json.c unittests.c imphint.c \
-	argtypes.c apply.c sideeffect.c \
+	aliasthis.h aliasthis.c json.h json.c tokcache.h tokcache.c vtime.h vtime.c incremental.h incremental.c server.h server.c \
+	unittests.c imphint.c argtypes.c apply.c sideeffect.c \
 	intrange.h intrange.c canthrow.c vergen.c \
-	scanmscoff.c ctfe.h ctfeexpr.c \
+	scanmscoff.c ctfe.h ctfecode.c ctfeexpr.c \
 	$C/cdef.h $C/cc.h $C/oper.h $C/ty.h $C/optabgen.c \
 	$C/global.h $C/code.h $C/type.h $C/dt.h $C/cgcv.h \
 	$C/el.h $C/iasm.h $C/rtlsym.h \
@@ -168,6 +168,7 @@ SRC = win32.mak posix.mak \
 	$(ROOT)/gnuc.h $(ROOT)/gnuc.c $(ROOT)/man.c \
 	$(ROOT)/stringtable.h $(ROOT)/stringtable.c \
 	$(ROOT)/response.c $(ROOT)/async.h $(ROOT)/async.c \
+	$(ROOT)/thread.h $(ROOT)/thread.c \
 	$(ROOT)/aav.h $(ROOT)/aav.c \
 	$(ROOT)/longdouble.h $(ROOT)/longdouble.c \
 	$(ROOT)/speller.h $(ROOT)/speller.c \
@@ -330,6 +331,9 @@ code.o: $C/code.c
 constfold.o: constfold.c
 	$(CC) -c $(CFLAGS) $<
 
+ctfecode.o: ctfecode.c ctfe.h
+	$(CC) -c $(CFLAGS) $<
+
 ctfeexpr.o: ctfeexpr.c ctfe.h
 	$(CC) -c $(CFLAGS) $<
 
@@ -588,6 +592,9 @@ struct.o: struct.c
 template.o: template.c
 	$(CC) -c $(CFLAGS) $<
 
+thread.o: $(ROOT)/thread.c
+	$(CC) -c $(GFLAGS) -I$(ROOT) $<
+
 ti_achar.o: $C/ti_achar.c $C/tinfo.h
 	$(CC) -c $(MFLAGS) -I. $<
 
@@ -597,6 +604,9 @@ ti_pvoid.o: $C/ti_pvoid.c $C/tinfo.h
 tk.o: tk.c
 	$(CC) -c $(MFLAGS) $<
 
+tokcache.o: tokcache.c tokcache.h
+	$(CC) -c $(CFLAGS) tokcache.c
+
 tocsym.o: tocsym.c $(CH) mars.h module.h
 	$(CC) -c $(MFLAGS) -I$(ROOT) $<
 
@@ -639,6 +649,15 @@ var.o: $C/var.c optab.c
 version.o: version.c
 	$(CC) -c $(CFLAGS) $<
 
+vtime.o: vtime.c vtime.h
+	$(CC) -c $(CFLAGS) vtime.c
+
+incremental.o: incremental.c incremental.h
+	$(CC) -c $(CFLAGS) incremental.c
+
+server.o: server.c server.h
+	$(CC) -c $(CFLAGS) server.c
+
 ######################################################
 
 gcov:
@@ -674,6 +693,7 @@ gcov:
 	gcov init.c
 	gcov inline.c
 	gcov interpret.c
+	gcov ctfecode.c
 	gcov ctfeexpr.c
 	gcov irstate.c
 	gcov json.c
@@ -702,6 +722,7 @@ endif
 	gcov struct.c
 	gcov template.c
 	gcov tk.c
+	gcov tokcache.c
 	gcov tocsym.c
 	gcov todt.c
 	gcov toobj.c
@@ -711,6 +732,9 @@ endif
 	gcov utf.c
 	gcov util.c
 	gcov version.c
+	gcov vtime.c
+	gcov incremental.c
+	gcov server.c
 	gcov intrange.c
 
 #	gcov hdrgen.c
@@ -13,6 +13,11 @@
 #include <stdlib.h>
 #include <assert.h>
 
+/* Number of reader threads. More than one so the latency of
+ * reading one file (open, seek, cold cache) overlaps with others.
+ */
+#define MAXREADERS      8
+
 #if _WIN32
 
 #include <windows.h>
@@ -38,7 +43,9 @@ struct AsyncRead
     int read(size_t i);
     static void dispose(AsyncRead *);
 
-    HANDLE hThread;
+    HANDLE hThreads[MAXREADERS];
+    unsigned nthreads;
+    volatile LONG next;         // index of next file to be read
 
     size_t filesdim;
     size_t filesmax;
@@ -68,10 +75,11 @@ void AsyncRead::addFile(File *file)
 void AsyncRead::start()
 {
     //printf("aw->filesdim = %p %d\n", this, filesdim);
-    if (filesdim)
+    nthreads = filesdim < MAXREADERS ? filesdim : MAXREADERS;
+    for (unsigned t = 0; t < nthreads; t++)
     {
         unsigned threadaddr;
-        hThread = (HANDLE) _beginthreadex(NULL,
+        HANDLE hThread = (HANDLE) _beginthreadex(NULL,
             0,
             &startthread,
             this,
@@ -86,6 +94,7 @@ void AsyncRead::start()
         {
             assert(0);
         }
+        hThreads[t] = hThread;
     }
 }
 
@@ -99,6 +108,13 @@ int AsyncRead::read(size_t i)
 
 void AsyncRead::dispose(AsyncRead *aw)
 {
+    for (unsigned t = 0; t < aw->nthreads; t++)
+    {
+        WaitForSingleObject(aw->hThreads[t], INFINITE);
+        CloseHandle(aw->hThreads[t]);
+    }
+    for (size_t i = 0; i < aw->filesdim; i++)
+        CloseHandle(aw->files[i].event);
     free(aw);
 }
 
@@ -109,10 +125,14 @@ unsigned __stdcall startthread(void *p)
     AsyncRead *aw = (AsyncRead *)p;
 
     //printf("aw->filesdim = %p %d\n", aw, aw->filesdim);
-    for (size_t i = 0; i < aw->filesdim; i++)
-    {   FileData *f = &aw->files[i];
+    while (1)
+    {   // Files are handed out in order, as that's the order they're waited on
+        size_t i = InterlockedIncrement(&aw->next) - 1;
+        if (i >= aw->filesdim)
+            break;
+        FileData *f = &aw->files[i];
 
-        f->result = f->file->read();
+        f->result = f->file->mmread();
         SetEvent(f->event);
     }
     _endthreadex(EXIT_SUCCESS);
@@ -153,6 +173,11 @@ struct AsyncRead
     int read(size_t i);
     static void dispose(AsyncRead *);
 
+    pthread_t threads[MAXREADERS];
+    unsigned nthreads;
+    pthread_mutex_t mutex;      // guards next
+    size_t next;                // index of next file to be read
+
     size_t filesdim;
     size_t filesmax;
     FileData files[1];
@@ -164,6 +189,9 @@ AsyncRead *AsyncRead::create(size_t nfiles)
     AsyncRead *aw = (AsyncRead *)calloc(1, sizeof(AsyncRead) +
                                 (nfiles - 1) * sizeof(FileData));
     aw->filesmax = nfiles;
+    int status = pthread_mutex_init(&aw->mutex, NULL);
+    if (status != 0)
+        err_abort(status, "init mutex");
     return aw;
 }
 
@@ -188,15 +216,18 @@ void AsyncRead::addFile(File *file)
 void AsyncRead::start()
 {
     //printf("aw->filesdim = %p %d\n", this, filesdim);
-    if (filesdim)
+    unsigned n = filesdim < MAXREADERS ? filesdim : MAXREADERS;
+    for (nthreads = 0; nthreads < n; nthreads++)
     {
-        pthread_t thread_id;
-        int status = pthread_create(&thread_id,
+        int status = pthread_create(&threads[nthreads],
             NULL,
             &startthread,
             this);
         if (status != 0)
+        {   if (nthreads)
+                break;          // make do with the readers we have
             err_abort(status, "create thread");
+        }
     }
 }
 
@@ -224,6 +255,15 @@ int AsyncRead::read(size_t i)
 void AsyncRead::dispose(AsyncRead *aw)
 {
     //printf("AsyncRead::dispose()\n");
+    for (unsigned t = 0; t < aw->nthreads; t++)
+    {
+        int status = pthread_join(aw->threads[t], NULL);
+        if (status != 0)
+            err_abort(status, "join thread");
+    }
+    int status = pthread_mutex_destroy(&aw->mutex);
+    if (status != 0)
+        err_abort(status, "mutex destroy");
     for (int i = 0; i < aw->filesdim; i++)
     {
         FileData *f = &aw->files[i];
@@ -244,13 +284,25 @@ void *startthread(void *p)
 
     //printf("startthread: aw->filesdim = %p %d\n", aw, aw->filesdim);
     size_t dim = aw->filesdim;
-    for (size_t i = 0; i < dim; i++)
-    {   FileData *f = &aw->files[i];
+    while (1)
+    {   // Files are handed out in order, as that's the order they're waited on
+        int status = pthread_mutex_lock(&aw->mutex);
+        if (status != 0)
+            err_abort(status, "lock mutex");
+        size_t i = aw->next;
+        if (i < dim)
+            aw->next = i + 1;
+        status = pthread_mutex_unlock(&aw->mutex);
+        if (status != 0)
+            err_abort(status, "unlock mutex");
+        if (i >= dim)
+            break;
+        FileData *f = &aw->files[i];
 
-        f->result = f->file->read();
+        f->result = f->file->mmread();
 
         // Set event
-        int status = pthread_mutex_lock(&f->mutex);
+        status = pthread_mutex_lock(&f->mutex);
         if (status != 0)
             err_abort(status, "lock mutex");
         f->value = 1;
@@ -321,7 +373,7 @@ void AsyncRead::start()
 int AsyncRead::read(size_t i)
 {
     FileData *f = &files[i];
-    f->result = f->file->read();
+    f->result = f->file->mmread();
     return f->result;
 }
 
@@ -16,8 +16,8 @@
 
 
 /*******************
- * Simple interface to read files asynchronously in another
- * thread.
+ * Simple interface to read files asynchronously in a few
+ * other threads, using File::mmread().
  */
 
 struct AsyncRead
@@ -13,8 +13,10 @@
 
 #if linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun
 #include "../root/rmem.h"
+#include "../root/thread.h"
 #else
 #include "rmem.h"
+#include "thread.h"
 #endif
 
 /* This implementation of the storage allocator uses the standard C allocation package.
@@ -22,6 +24,17 @@
 
 Mem mem;
 
+static THREADLOCAL size_t nallocated;   // bytes asked for by this thread
+
+/**************************************
+ * Bytes allocated so far by the calling thread, freed or not.
+ */
+
+size_t Mem::allocated()
+{
+    return nallocated;
+}
+
 void Mem::init()
 {
 }
@@ -34,7 +47,9 @@ char *Mem::strdup(const char *s)
     {
         p = ::strdup(s);
         if (p)
+        {   nallocated += strlen(p) + 1;
             return p;
+        }
         error();
     }
     return NULL;
@@ -50,6 +65,7 @@ void *Mem::malloc(size_t size)
         p = ::malloc(size);
         if (!p)
             error();
+        nallocated += size;
     }
     return p;
 }
@@ -64,6 +80,7 @@ void *Mem::calloc(size_t size, size_t n)
         p = ::calloc(size, n);
         if (!p)
             error();
+        nallocated += size * n;
     }
     return p;
 }
@@ -81,6 +98,7 @@ void *Mem::realloc(void *p, size_t size)
         p = ::malloc(size);
         if (!p)
             error();
+        nallocated += size;
     }
     else
     {
@@ -90,6 +108,7 @@ void *Mem::realloc(void *p, size_t size)
         {   free(psave);
             error();
         }
+        nallocated += size;
     }
     return p;
 }
@@ -112,8 +131,60 @@ void *Mem::mallocdup(void *o, size_t size)
             error();
         else
             memcpy(p,o,size);
+        nallocated += size;
+    }
+    return p;
+}
+
+/* The front end allocates millions of small objects, and hardly ever
+ * frees one. So fmalloc() hands them out of large chunks of memory,
+ * which saves the time malloc() takes, and its per object overhead.
+ * Each thread has its own chunk, so there is no locking.
+ * Compile with -DMEM_NOARENA to use malloc() and free() instead,
+ * such as to look for memory errors with a memory checker.
+ */
+
+#define CHUNK_SIZE      (256 * 4096 - 64)       // leave room for malloc's header
+
+#if !MEM_NOARENA
+static THREADLOCAL char *heapp;
+static THREADLOCAL size_t heapleft;
+#endif
+
+void *Mem::fmalloc(size_t size)
+{
+#if MEM_NOARENA
+    return malloc(size ? size : 1);
+#else
+    // 16 byte alignment is needed for long doubles and SSE
+    size = (size + 15) & ~(size_t)15;
+    if (!size)
+        size = 16;
+
+    // The layout of the code is so the most common case is straight through
+    if (size > heapleft)
+    {
+        if (size > CHUNK_SIZE / 4)
+            return malloc(size);        // rather than waste the rest of the chunk
+
+        heapp = (char *)::malloc(CHUNK_SIZE);
+        if (!heapp)
+            error();
+        heapleft = CHUNK_SIZE;
     }
+    void *p = heapp;
+    heapp += size;
+    heapleft -= size;
+    nallocated += size;
     return p;
+#endif
+}
+
+void Mem::ffree(void *p)
+{
+#if MEM_NOARENA
+    free(p);
+#endif
 }
 
 void Mem::error()
@@ -146,7 +217,9 @@ void * operator new(size_t m_size)
 {
     void *p = malloc(m_size);
     if (p)
+    {   nallocated += m_size;
         return p;
+    }
     printf("Error: out of memory\n");
     exit(EXIT_FAILURE);
     return p;
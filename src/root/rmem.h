@@ -40,6 +40,9 @@ struct Mem
     void free(void *p);
     void free_uncollectable(void *p);
     void *mallocdup(void *o, size_t size);
+    void *fmalloc(size_t size); // allocate memory that is never freed
+    void ffree(void *p);        // "free" memory from fmalloc()
+    size_t allocated();         // bytes allocated by this thread
     void error();
     void check(void *p);        // validate pointer
     void fullcollect();         // do full garbage collection
@@ -40,11 +40,14 @@
 #include <errno.h>
 #include <unistd.h>
 #include <utime.h>
+#include <sys/mman.h>
+#include <dirent.h>
 #endif
 
 #include "port.h"
 #include "root.h"
 #include "rmem.h"
+#include "stringtable.h"
 
 #if 0 //__SC__ //def DEBUG
 extern "C" void __cdecl _assert(void *e, void *f, unsigned line)
@@ -92,6 +95,16 @@ void warning(const char *format, ...)
 
 /****************************** Object ********************************/
 
+void *Object::operator new(size_t size)
+{
+    return mem.fmalloc(size);
+}
+
+void Object::operator delete(void *p)
+{
+    mem.ffree(p);
+}
+
 int Object::equals(Object *o)
 {
     return o == this;
@@ -826,6 +839,163 @@ int FileName::exists(const char *name)
 #endif
 }
 
+/*************************************
+ * Listing of a directory, read once by FileName::existsCached().
+ */
+
+struct DirListing
+{
+    int state;                  // DIRlisted, DIRmissing or DIRunreadable
+    StringTable names;          // ptrvalue is FILEfile, FILEdir or FILEother
+    StringTable foldednames;    // the names in lower case
+};
+
+enum { DIRlisted, DIRmissing, DIRunreadable };
+enum { FILEfile = 1, FILEdir = 2, FILEother = 3 };
+
+static StringTable *dirlistings;        // directory name => DirListing*
+
+static char *foldName(const char *name)
+{
+    size_t len = strlen(name);
+    char *s = (char *)mem.malloc(len + 1);
+    for (size_t i = 0; i <= len; i++)
+        s[i] = tolower((unsigned char)name[i]);
+    return s;
+}
+
+static void addDirEntry(DirListing *dl, const char *name, int kind)
+{
+    dl->names.update(name, strlen(name))->ptrvalue = (void *)(size_t)kind;
+    char *s = foldName(name);
+    dl->foldednames.update(s, strlen(s));
+    mem.free(s);
+}
+
+static DirListing *readDirListing(const char *dir)
+{
+    //printf("readDirListing('%s')\n", dir);
+    DirListing *dl = (DirListing *)mem.malloc(sizeof(DirListing));
+    memset(dl, 0, sizeof(DirListing));
+    dl->names.init();
+    dl->foldednames.init();
+    dl->state = DIRlisted;
+#if POSIX
+    DIR *d = opendir(*dir ? dir : ".");
+    if (!d)
+    {   dl->state = (errno == ENOENT || errno == ENOTDIR) ? DIRmissing : DIRunreadable;
+        return dl;
+    }
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL)
+    {
+        int kind = FILEother;
+#ifdef DT_DIR
+        if (e->d_type == DT_REG)
+            kind = FILEfile;
+        else if (e->d_type == DT_DIR)
+            kind = FILEdir;
+#endif
+        addDirEntry(dl, e->d_name, kind);
+    }
+    closedir(d);
+#elif _WIN32
+    size_t len = strlen(dir);
+    char *pattern = (char *)mem.malloc(len + 3);
+    memcpy(pattern, dir, len);
+    if (len && dir[len - 1] != ':')
+        pattern[len++] = '\\';
+    pattern[len++] = '*';
+    pattern[len] = 0;
+
+    WIN32_FIND_DATAA fileinfo;
+    HANDLE h = FindFirstFileA(pattern, &fileinfo);
+    mem.free(pattern);
+    if (h == INVALID_HANDLE_VALUE)
+    {   DWORD err = GetLastError();
+        dl->state = (err == ERROR_PATH_NOT_FOUND || err == ERROR_FILE_NOT_FOUND)
+                ? DIRmissing : DIRunreadable;
+        return dl;
+    }
+    do
+    {
+        int kind = FILEfile;
+        if (fileinfo.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+            kind = FILEother;
+        else if (fileinfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            kind = FILEdir;
+        addDirEntry(dl, fileinfo.cFileName, kind);
+    } while (FindNextFileA(h, &fileinfo));
+    FindClose(h);
+#else
+    assert(0);
+#endif
+    return dl;
+}
+
+/*************************************
+ * Same result as exists(), but answered from a listing of the
+ * directory the file is in, read the first time it is asked about.
+ * Searching many import directories for each module then costs
+ * one directory read per directory, instead of a failed stat()
+ * per directory per module.
+ * Only use for files and directories that are not created or removed
+ * during the compilation, as the listing is never reread.
+ */
+
+int FileName::existsCached(const char *name)
+{
+    const char *n = FileName::name(name);
+    char *dir = FileName::path(name);
+    if (!*n || (!*dir && n != name))
+    {   // no name, or in the root directory
+        mem.free(dir);
+        return exists(name);
+    }
+
+    if (!dirlistings)
+    {   dirlistings = new StringTable();
+        dirlistings->init();
+    }
+    StringValue *sv = dirlistings->update(dir, strlen(dir));
+    mem.free(dir);
+    if (!sv->ptrvalue)
+        sv->ptrvalue = readDirListing(sv->toDchars());
+    DirListing *dl = (DirListing *)sv->ptrvalue;
+
+    switch (dl->state)
+    {
+        case DIRmissing:
+            return 0;
+        case DIRunreadable:
+            return exists(name);
+    }
+
+    sv = dl->names.lookup(n, strlen(n));
+    if (sv)
+    {   int kind = (int)(size_t)sv->ptrvalue;
+        return kind == FILEother ? exists(name) : kind;
+    }
+
+    /* The file system may be case insensitive, let it decide
+     * about names that differ only in case.
+     */
+    char *s = foldName(n);
+    sv = dl->foldednames.lookup(s, strlen(s));
+    mem.free(s);
+    return sv ? exists(name) : 0;
+}
+
+/*************************************
+ * Forget the listings read by existsCached(), as files may have
+ * been created or removed since.
+ */
+
+void FileName::forgetCached()
+{
+    dirlistings = NULL;
+}
+
 void FileName::ensurePathExists(const char *path)
 {
     //printf("FileName::ensurePathExists(%s)\n", path ? path : "");
@@ -950,6 +1120,13 @@ File::File(char *n)
 }
 
 File::~File()
+{
+    freeBuffer();
+    if (touchtime)
+        mem.free(touchtime);
+}
+
+void File::freeBuffer()
 {
     if (buffer)
     {
@@ -958,10 +1135,14 @@ File::~File()
 #if _WIN32
         else if (ref == 2)
             UnmapViewOfFile(buffer);
+#elif POSIX
+        else if (ref == 2)
+            munmap(buffer, len);
 #endif
     }
-    if (touchtime)
-        mem.free(touchtime);
+    ref = 0;
+    buffer = NULL;
+    len = 0;
 }
 
 void File::mark()
@@ -993,9 +1174,7 @@ int File::read()
         goto err1;
     }
 
-    if (!ref)
-        ::free(buffer);
-    ref = 0;       // we own the buffer now
+    freeBuffer();       // we own the buffer now
 
     //printf("\tfile opened\n");
     if (fstat(fd, &buf))
@@ -1057,9 +1236,7 @@ err1:
     if (h == INVALID_HANDLE_VALUE)
         goto err1;
 
-    if (!ref)
-        ::free(buffer);
-    ref = 0;
+    freeBuffer();
 
     size = GetFileSize(h,NULL);
     buffer = (unsigned char *) ::malloc(size + 2);
@@ -1105,18 +1282,71 @@ err1:
 
 /*****************************
  * Read a file with memory mapped file I/O.
+ * Small files are cheaper to read() than to map. Nor can a file be mapped
+ * if its last page has no room for the two 0 bytes that read() appends
+ * as a sentinel for the scanner; the rest of the last page is 0 filled.
+ * A mapped buffer is read only.
  */
 
+#define MMREAD_MIN      (16 * 1024)     // smallest file worth mapping
+
 int File::mmread()
 {
 #if POSIX
+    size_t size;
+    size_t pagesize;
+    int fd;
+    struct stat buf;
+    void *p;
+    int flags;
+    char *name;
+
+    name = this->name->toChars();
+    //printf("File::mmread('%s')\n",name);
+    fd = open(name, O_RDONLY);
+    if (fd == -1)
+        return 1;
+
+    if (fstat(fd, &buf))
+        goto Lread;
+    size = buf.st_size;
+    pagesize = sysconf(_SC_PAGESIZE);
+    if (size < MMREAD_MIN || size != (size_t)buf.st_size ||
+        size % pagesize == 0 || size % pagesize + 2 > pagesize)
+        goto Lread;
+
+    flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;      // fault the pages in now, not in the scanner
+#endif
+    p = mmap(NULL, size, PROT_READ, flags, fd, 0);
+    if (p == MAP_FAILED)
+        goto Lread;
+
+    if (touchtime)
+        memcpy(touchtime, &buf, sizeof(buf));
+    close(fd);
+
+    freeBuffer();
+    ref = 2;
+    buffer = (unsigned char *)p;
+    len = size;
+    return 0;
+
+Lread:
+    close(fd);
     return read();
 #elif _WIN32
     HANDLE hFile;
     HANDLE hFileMap;
     DWORD size;
+    SYSTEM_INFO si;
+    unsigned char *p;
     char *name;
 
+    if (touchtime)
+        return read();
+
     name = this->name->toChars();
     hFile = CreateFile(name, GENERIC_READ,
                         FILE_SHARE_READ, NULL,
@@ -1126,6 +1356,14 @@ int File::mmread()
     size = GetFileSize(hFile, NULL);
     //printf(" file created, size %d\n", size);
 
+    GetSystemInfo(&si);
+    if (size < MMREAD_MIN ||
+        size % si.dwPageSize == 0 || size % si.dwPageSize + 2 > si.dwPageSize)
+    {
+        CloseHandle(hFile);
+        return read();
+    }
+
     hFileMap = CreateFileMapping(hFile,NULL,PAGE_READONLY,0,size,NULL);
     if (CloseHandle(hFile) != TRUE)
         goto Lerr;
@@ -1135,15 +1373,15 @@ int File::mmread()
 
     //printf(" mapping created\n");
 
-    if (!ref)
-        mem.free(buffer);
-    ref = 2;
-    buffer = (unsigned char *)MapViewOfFileEx(hFileMap, FILE_MAP_READ,0,0,size,NULL);
+    p = (unsigned char *)MapViewOfFileEx(hFileMap, FILE_MAP_READ,0,0,size,NULL);
     if (CloseHandle(hFileMap) != TRUE)
         goto Lerr;
-    if (buffer == NULL)                 // mapping view failed
+    if (p == NULL)                      // mapping view failed
         goto Lerr;
 
+    freeBuffer();
+    ref = 2;
+    buffer = p;
     len = size;
     //printf(" buffer = %p\n", buffer);
 
@@ -1152,7 +1390,7 @@ int File::mmread()
 Lerr:
     return GetLastError();                      // failure
 #else
-    assert(0);
+    return read();
 #endif
 }
 
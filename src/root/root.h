@@ -40,6 +40,10 @@ struct Object
     Object() { }
     virtual ~Object() { }
 
+    // Allocated with mem.fmalloc(), as Objects are hardly ever deleted
+    void *operator new(size_t size);
+    void operator delete(void *p);
+
     virtual int equals(Object *o);
 
     /**
@@ -119,6 +123,8 @@ struct FileName : String
     static char *searchPath(Strings *path, const char *name, int cwd);
     static char *safeSearchPath(Strings *path, const char *name);
     static int exists(const char *name);
+    static int existsCached(const char *name);
+    static void forgetCached();
     static void ensurePathExists(const char *path);
     static char *canonicalName(const char *name);
 };
@@ -145,13 +151,21 @@ struct File : Object
 
     int read();
 
+    /* Release the buffer, however it was obtained.
+     */
+
+    void freeBuffer();
+
     /* Write file, either succeed or fail
      * with error message & exit.
      */
 
     void readv();
 
-    /* Read file, return !=0 if error
+    /* Read file, memory mapping it if that is worthwhile, in which
+     * case the buffer is read only. The buffer is followed by two 0
+     * bytes either way, and should be released with freeBuffer().
+     * Return !=0 if error.
      */
 
     int mmread();
@@ -12,6 +12,7 @@
 #include <stdint.h>                     // uint{8|16|32}_t
 #include <string.h>                     // memcpy()
 #include <stdlib.h>
+#include <assert.h>
 
 #include "root.h"
 #include "rmem.h"                       // mem
@@ -57,120 +58,234 @@ hash_t calcHash(const char *str, size_t len)
 
 void StringValue::ctor(const char *p, size_t length)
 {
+    this->ptrvalue = NULL;
     this->length = length;
     this->lstring[length] = 0;
     memcpy(this->lstring, p, length * sizeof(char));
 }
 
+struct StringEntry
+{
+    hash_t hash;
+    StringValue *value;         // NULL if slot is empty
+};
+
+static const size_t POOLSIZE = 8192;    // size of chunks StringValue's are allocated from
+
+/********************************
+ * calcHash() leaves the later bytes of each 4 byte chunk
+ * in the high bits, so mix them down before masking off
+ * the low bits for the table index.
+ */
+
+inline size_t hashSlot(hash_t hash, size_t mask)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6B;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35;
+    hash ^= hash >> 16;
+    return hash & mask;
+}
+
+/********************************
+ * Find entry for string s[0..len] in table[], or the empty slot
+ * where it would go.
+ */
+
+static StringEntry *findSlot(StringEntry *table, size_t tabledim, hash_t hash, const char *s, size_t len)
+{
+    size_t mask = tabledim - 1;
+    for (size_t i = hashSlot(hash, mask); 1; i = (i + 1) & mask)
+    {   StringEntry *se = &table[i];
+        if (!se->value)
+            return se;
+        if (se->hash == hash &&
+            se->value->len() == len &&
+            ::memcmp(s, se->value->toDchars(), len) == 0)
+            return se;
+    }
+}
+
 void StringTable::init(size_t size)
 {
-    table = (void **)mem.calloc(size, sizeof(void *));
-    tabledim = size;
+    tabledim = 16;
+    while (tabledim < size)
+        tabledim *= 2;
+    table = (StringEntry *)mem.calloc(tabledim, sizeof(StringEntry));
     count = 0;
+    oldtable = NULL;
+    oldtabledim = 0;
+    oldindex = 0;
+    pool = NULL;
+    poolleft = 0;
 }
 
 StringTable::~StringTable()
 {
     // Zero out dangling pointers to help garbage collector.
-    // Should zero out StringEntry's too.
-    for (size_t i = 0; i < count; i++)
-        table[i] = NULL;
+    // Should zero out StringValue's too.
+    for (size_t i = 0; i < tabledim; i++)
+        table[i].value = NULL;
 
     mem.free(table);
     table = NULL;
+    mem.free(oldtable);
+    oldtable = NULL;
+    pool = NULL;
 }
 
-struct StringEntry
+/********************************
+ * Move entries from oldtable[oldindex..oldindex + n] into table[].
+ * Entries are left in oldtable[] so its probe sequences stay intact,
+ * which means lookups can search oldtable[] until all are moved.
+ */
+
+void StringTable::moveEntries(size_t n)
 {
-    StringEntry *left;
-    StringEntry *right;
-    hash_t hash;
+    if (!oldtable)
+        return;
 
-    StringValue value;
+    size_t end = oldindex + n;
+    if (end > oldtabledim)
+        end = oldtabledim;
+    size_t mask = tabledim - 1;
+    for (; oldindex < end; oldindex++)
+    {   StringEntry *se = &oldtable[oldindex];
+        if (se->value)
+        {
+            size_t i = hashSlot(se->hash, mask);
+            while (table[i].value)
+                i = (i + 1) & mask;
+            table[i] = *se;
+        }
+    }
+    if (oldindex == oldtabledim)
+    {
+        mem.free(oldtable);
+        oldtable = NULL;
+        oldtabledim = 0;
+        oldindex = 0;
+    }
+}
 
-    static StringEntry *alloc(const char *s, size_t len);
-};
+/********************************
+ * Double the size of table[]. The existing entries are moved
+ * into the new table incrementally by add().
+ */
 
-StringEntry *StringEntry::alloc(const char *s, size_t len)
+void StringTable::grow()
 {
-    StringEntry *se;
+    moveEntries(oldtabledim);   // finish up any previous grow()
+    oldtable = table;
+    oldtabledim = tabledim;
+    oldindex = 0;
+    tabledim *= 2;
+    table = (StringEntry *)mem.calloc(tabledim, sizeof(StringEntry));
+}
 
-    se = (StringEntry *) mem.calloc(1,sizeof(StringEntry) + len + 1);
-    se->value.ctor(s, len);
-    se->hash = calcHash(s,len);
-    return se;
+StringValue *StringTable::search(hash_t hash, const char *s, size_t len)
+{
+    //printf("StringTable::search(%p,%d)\n",s,len);
+    StringEntry *se = findSlot(table, tabledim, hash, s, len);
+    if (!se->value && oldtable)
+        se = findSlot(oldtable, oldtabledim, hash, s, len);
+    return se->value;
 }
 
-void **StringTable::search(const char *s, size_t len)
+StringValue *StringTable::add(hash_t hash, const char *s, size_t len)
 {
-    hash_t hash;
-    unsigned u;
-    int cmp;
-    StringEntry **se;
+    /* table[] is at most half full after the oldtable[] entries
+     * are moved in, and there are at least tabledim / 4 adds before
+     * the next grow(), so moving 4 entries per add keeps up.
+     */
+    moveEntries(4);
+    if ((count + 1) * 2 > tabledim)
+        grow();
 
-    //printf("StringTable::search(%p,%d)\n",s,len);
-    hash = calcHash(s,len);
-    u = hash % tabledim;
-    se = (StringEntry **)&table[u];
-    //printf("\thash = %d, u = %d\n",hash,u);
-    while (*se)
+    size_t size = sizeof(StringValue) + len + 1;
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    StringValue *sv;
+    if (size > poolleft)
     {
-        cmp = (*se)->hash - hash;
-        if (cmp == 0)
-        {
-            cmp = (*se)->value.len() - len;
-            if (cmp == 0)
-            {
-                cmp = ::memcmp(s,(*se)->value.toDchars(),len);
-                if (cmp == 0)
-                    break;
-            }
+        if (size > POOLSIZE / 4)
+        {   // Don't waste the rest of the pool on long strings
+            sv = (StringValue *)mem.malloc(size);
+            goto L1;
         }
-        if (cmp < 0)
-            se = &(*se)->left;
-        else
-            se = &(*se)->right;
+        pool = (char *)mem.malloc(POOLSIZE);
+        poolleft = POOLSIZE;
     }
-    //printf("\treturn %p, %p\n",se, (*se));
-    return (void **)se;
+    sv = (StringValue *)pool;
+    pool += size;
+    poolleft -= size;
+L1:
+    sv->ctor(s, len);
+
+    StringEntry *se = findSlot(table, tabledim, hash, s, len);
+    assert(!se->value);
+    se->hash = hash;
+    se->value = sv;
+    count++;
+    return sv;
 }
 
 StringValue *StringTable::lookup(const char *s, size_t len)
-{   StringEntry *se;
-
-    se = *(StringEntry **)search(s,len);
-    if (se)
-        return &se->value;
-    else
-        return NULL;
+{
+    return search(calcHash(s,len), s, len);
 }
 
 StringValue *StringTable::update(const char *s, size_t len)
-{   StringEntry **pse;
-    StringEntry *se;
-
-    pse = (StringEntry **)search(s,len);
-    se = *pse;
-    if (!se)                    // not in table: so create new entry
-    {
-        se = StringEntry::alloc(s, len);
-        *pse = se;
-    }
-    return &se->value;
+{
+    hash_t hash = calcHash(s,len);
+    StringValue *sv = search(hash, s, len);
+    if (!sv)                    // not in table: so create new entry
+        sv = add(hash, s, len);
+    return sv;
 }
 
 StringValue *StringTable::insert(const char *s, size_t len)
-{   StringEntry **pse;
-    StringEntry *se;
-
-    pse = (StringEntry **)search(s,len);
-    se = *pse;
-    if (se)
+{
+    hash_t hash = calcHash(s,len);
+    if (search(hash, s, len))
         return NULL;            // error: already in table
-    else
+    return add(hash, s, len);
+}
+
+
+#if UNITTEST
+
+void unittest_stringtable()
+{
+    StringTable tab;
+    tab.init(1);
+    char buf[16];
+
+    for (int i = 0; i < 10000; i++)
+    {
+        sprintf(buf, "id%d", i);
+        StringValue *sv = tab.insert(buf, strlen(buf));
+        assert(sv);
+        sv->ptrvalue = (void *)(size_t)(i + 1);
+        // Everything inserted so far must still be found mid grow()
+        for (int j = i; j >= 0; j -= 97)
+        {
+            sprintf(buf, "id%d", j);
+            sv = tab.lookup(buf, strlen(buf));
+            assert(sv && sv->ptrvalue == (void *)(size_t)(j + 1));
+        }
+    }
+    for (int i = 0; i < 10000; i++)
     {
-        se = StringEntry::alloc(s, len);
-        *pse = se;
+        sprintf(buf, "id%d", i);
+        assert(!tab.insert(buf, strlen(buf)));
+        StringValue *sv = tab.update(buf, strlen(buf));
+        assert(sv->ptrvalue == (void *)(size_t)(i + 1));
+        assert(strcmp(sv->toDchars(), buf) == 0);
     }
-    return &se->value;
+    assert(!tab.lookup("id10000", 7));
+    assert(!tab.lookup("", 0));
+    assert(tab.update("", 0) == tab.lookup("", 0));
 }
+
+#endif
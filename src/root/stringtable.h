@@ -18,6 +18,7 @@
 #include "root.h"
 
 struct StringEntry;
+struct StringTable;
 
 // StringValue is a variable-length structure as indicated by the last array
 // member with unspecified size.  It has neither proper c'tors nor a factory
@@ -43,18 +44,32 @@ public:
     const char *toDchars() const { return lstring; }
 
 private:
-    friend struct StringEntry;
+    friend struct StringTable;
     StringValue();  // not constructible
     // This is more like a placement new c'tor
     void ctor(const char *p, size_t length);
 };
 
+/* Open addressing hash table of StringValue's.
+ * The table grows as needed. When it does, entries are moved
+ * into the larger table a few at a time by subsequent inserts,
+ * rather than all at once.
+ * StringValue's never move once created.
+ */
+
 struct StringTable
 {
 private:
-    void **table;
-    size_t count;
+    StringEntry *table;         // tabledim is a power of 2
     size_t tabledim;
+    size_t count;               // number of entries in table[] and oldtable[]
+
+    StringEntry *oldtable;      // if !=NULL, entries not yet moved into table[]
+    size_t oldtabledim;
+    size_t oldindex;            // oldtable[0..oldindex] have been moved
+
+    char *pool;                 // StringValue's are allocated from here
+    size_t poolleft;
 
 public:
     void init(size_t size = 37);
@@ -65,7 +80,10 @@ public:
     StringValue *update(const char *s, size_t len);
 
 private:
-    void **search(const char *s, size_t len);
+    StringValue *search(hash_t hash, const char *s, size_t len);
+    StringValue *add(hash_t hash, const char *s, size_t len);
+    void grow();
+    void moveEntries(size_t n);
 };
 
 #endif
@@ -0,0 +1,327 @@
+
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+#define _MT 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/* Mutex is opaque in thread.h, and is fleshed out here
+ * differently for each platform.
+ */
+
+typedef long ThreadId;
+
+struct Thread
+{
+    static ThreadId getId();
+    static void parallelFor(size_t n, unsigned nthreads,
+        void (*fp)(void *arg, size_t i), void *arg);
+};
+
+struct Mutex;
+
+/* Threads get the same stack size as the main thread usually has,
+ * as the parser and semantic passes are deeply recursive.
+ */
+#define THREAD_STACK_SIZE       (8 * 1024 * 1024)
+
+/* Upper limit on the number of threads parallelFor() will start.
+ */
+#define MAX_THREADS             64
+
+/* Shared state of one parallelFor() call. The next index to run is
+ * handed out under the lock, which is cheap as each call of fp
+ * is expected to be a large piece of work (such as a whole module).
+ */
+struct ForData
+{
+    size_t n;
+    size_t next;
+    Mutex *mutex;
+    void (*fp)(void *arg, size_t i);
+    void *arg;
+};
+
+static void runFor(ForData *fd);
+
+#if _WIN32
+
+#include <windows.h>
+#include <process.h>
+
+struct Mutex
+{
+    static Mutex *create();
+    void lock();
+    void unlock();
+    static void dispose(Mutex *);
+
+    CRITICAL_SECTION cs;        // is already recursive
+};
+
+Mutex *Mutex::create()
+{
+    Mutex *m = (Mutex *)calloc(1, sizeof(Mutex));
+    assert(m);
+    InitializeCriticalSection(&m->cs);
+    return m;
+}
+
+void Mutex::lock()
+{
+    EnterCriticalSection(&cs);
+}
+
+void Mutex::unlock()
+{
+    LeaveCriticalSection(&cs);
+}
+
+void Mutex::dispose(Mutex *m)
+{
+    DeleteCriticalSection(&m->cs);
+    free(m);
+}
+
+ThreadId Thread::getId()
+{
+    return (ThreadId)GetCurrentThreadId();
+}
+
+static unsigned __stdcall startfor(void *p)
+{
+    runFor((ForData *)p);
+    _endthreadex(EXIT_SUCCESS);
+    return EXIT_SUCCESS;                // if skidding
+}
+
+void Thread::parallelFor(size_t n, unsigned nthreads,
+        void (*fp)(void *arg, size_t i), void *arg)
+{
+    ForData fd;
+    fd.n = n;
+    fd.next = 0;
+    fd.mutex = Mutex::create();
+    fd.fp = fp;
+    fd.arg = arg;
+
+    if (nthreads > n)
+        nthreads = n;
+    if (nthreads > MAX_THREADS)
+        nthreads = MAX_THREADS;
+
+    HANDLE threads[MAX_THREADS];
+    unsigned nstarted = 0;
+    for (unsigned t = 1; t < nthreads; t++)
+    {
+        unsigned threadaddr;
+        HANDLE h = (HANDLE) _beginthreadex(NULL,
+            THREAD_STACK_SIZE,
+            &startfor,
+            &fd,
+            0,
+            &threadaddr);
+        if (!h)
+            break;              // make do with the threads we have
+        threads[nstarted++] = h;
+    }
+
+    runFor(&fd);
+
+    for (unsigned t = 0; t < nstarted; t++)
+    {
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+    }
+    Mutex::dispose(fd.mutex);
+}
+
+#elif linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun  // Posix
+
+#include <errno.h>
+#include <pthread.h>
+
+static void err_abort(int status, const char *msg)
+{
+    fprintf(stderr, "fatal error = %d, %s\n", status, msg);
+    exit(EXIT_FAILURE);
+}
+
+struct Mutex
+{
+    static Mutex *create();
+    void lock();
+    void unlock();
+    static void dispose(Mutex *);
+
+    pthread_mutex_t mutex;
+};
+
+Mutex *Mutex::create()
+{
+    Mutex *m = (Mutex *)calloc(1, sizeof(Mutex));
+    assert(m);
+
+    pthread_mutexattr_t attr;
+    int status = pthread_mutexattr_init(&attr);
+    if (status != 0)
+        err_abort(status, "init mutex attr");
+    status = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    if (status != 0)
+        err_abort(status, "set mutex type");
+    status = pthread_mutex_init(&m->mutex, &attr);
+    if (status != 0)
+        err_abort(status, "init mutex");
+    pthread_mutexattr_destroy(&attr);
+    return m;
+}
+
+void Mutex::lock()
+{
+    int status = pthread_mutex_lock(&mutex);
+    if (status != 0)
+        err_abort(status, "lock mutex");
+}
+
+void Mutex::unlock()
+{
+    int status = pthread_mutex_unlock(&mutex);
+    if (status != 0)
+        err_abort(status, "unlock mutex");
+}
+
+void Mutex::dispose(Mutex *m)
+{
+    int status = pthread_mutex_destroy(&m->mutex);
+    if (status != 0)
+        err_abort(status, "mutex destroy");
+    free(m);
+}
+
+ThreadId Thread::getId()
+{
+    return (ThreadId)pthread_self();
+}
+
+static void *startfor(void *p)
+{
+    runFor((ForData *)p);
+    return NULL;                        // end thread
+}
+
+void Thread::parallelFor(size_t n, unsigned nthreads,
+        void (*fp)(void *arg, size_t i), void *arg)
+{
+    ForData fd;
+    fd.n = n;
+    fd.next = 0;
+    fd.mutex = Mutex::create();
+    fd.fp = fp;
+    fd.arg = arg;
+
+    if (nthreads > n)
+        nthreads = n;
+    if (nthreads > MAX_THREADS)
+        nthreads = MAX_THREADS;
+
+    pthread_attr_t attr;
+    int status = pthread_attr_init(&attr);
+    if (status != 0)
+        err_abort(status, "init thread attr");
+    pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+
+    pthread_t threads[MAX_THREADS];
+    unsigned nstarted = 0;
+    for (unsigned t = 1; t < nthreads; t++)
+    {
+        status = pthread_create(&threads[nstarted], &attr, &startfor, &fd);
+        if (status != 0)
+            break;              // make do with the threads we have
+        nstarted++;
+    }
+    pthread_attr_destroy(&attr);
+
+    runFor(&fd);
+
+    for (unsigned t = 0; t < nstarted; t++)
+    {
+        status = pthread_join(threads[t], NULL);
+        if (status != 0)
+            err_abort(status, "join thread");
+    }
+    Mutex::dispose(fd.mutex);
+}
+
+#else
+
+/* No threads, so everything runs in the calling thread.
+ */
+
+struct Mutex
+{
+    static Mutex *create();
+    void lock();
+    void unlock();
+    static void dispose(Mutex *);
+
+    int count;
+};
+
+Mutex *Mutex::create()
+{
+    Mutex *m = (Mutex *)calloc(1, sizeof(Mutex));
+    assert(m);
+    return m;
+}
+
+void Mutex::lock()
+{
+    count++;
+}
+
+void Mutex::unlock()
+{
+    assert(count);
+    count--;
+}
+
+void Mutex::dispose(Mutex *m)
+{
+    free(m);
+}
+
+ThreadId Thread::getId()
+{
+    return 1;
+}
+
+void Thread::parallelFor(size_t n, unsigned nthreads,
+        void (*fp)(void *arg, size_t i), void *arg)
+{
+    for (size_t i = 0; i < n; i++)
+        fp(arg, i);
+}
+
+#endif
+
+static void runFor(ForData *fd)
+{
+    while (1)
+    {
+        fd->mutex->lock();
+        size_t i = fd->next;
+        if (i < fd->n)
+            fd->next = i + 1;
+        fd->mutex->unlock();
+        if (i >= fd->n)
+            break;
+        fd->fp(fd->arg, i);
+    }
+}
@@ -1,12 +1,51 @@
 
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
 #ifndef THREAD_H
 #define THREAD_H 1
 
+#if __DMC__
+#pragma once
+#endif
+
+#include <stddef.h>
+
 typedef long ThreadId;
 
+#if _MSC_VER || __DMC__
+#define THREADLOCAL     __declspec(thread)
+#else
+#define THREADLOCAL     __thread
+#endif
+
 struct Thread
 {
     static ThreadId getId();
+
+    /*******************
+     * Call fp(arg, i) for each i in [0 .. n), spreading the calls
+     * over at most nthreads threads, the calling thread being one of them.
+     * Returns when all the calls have completed.
+     */
+    static void parallelFor(size_t n, unsigned nthreads,
+        void (*fp)(void *arg, size_t i), void *arg);
+};
+
+/*******************
+ * Recursive mutual exclusion lock.
+ */
+
+struct Mutex
+{
+    static Mutex *create();
+    void lock();
+    void unlock();
+    static void dispose(Mutex *);
 };
 
 #endif
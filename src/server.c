@@ -0,0 +1,937 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+// This implements --server and --client, the compile server.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+
+#if linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun
+#define SERVER  1
+#include <limits.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#if __sun
+#include <ucred.h>
+#endif
+#endif
+
+#include "rmem.h"
+#include "root.h"
+
+#include "aav.h"
+
+#include "mars.h"
+#include "module.h"
+#include "scope.h"
+#include "lexer.h"
+#include "identifier.h"
+#include "incremental.h"
+#include "server.h"
+
+void getenv_setargv(const char *envvar, size_t *pargc, char** *pargv);
+void backend_init();
+
+#if SERVER
+
+/* The file of a module the worker has analyzed.
+ */
+struct WarmFile
+{
+    char *name;                 // file the module was read from
+    char *real;                 // and with its path resolved
+    char *path;                 // module name as a file name, without extension
+    char *found;                // what an import of the module found
+    time_t mtime;
+    time_t checked;             // when its contents were last hashed
+    off_t size;
+    d_uns64 hash;
+};
+
+/* A compile sent by a client.
+ */
+struct Request
+{
+    char *cwd;                  // client's current directory
+    size_t argc;
+    char **argv;                // argv[0] is left for the program name
+    int fds[3];                 // client's standard input, output and error
+};
+
+static char *socketpath;
+static Strings switches;                // the server's, DFLAGS included
+static char *servercwd;
+static char *exepath;                   // to do a compile from scratch
+static pid_t worker;                    // in the server, the worker process
+static OutBuffer carried;               // in the server, what the last worker analyzed
+
+static ArrayBase<WarmFile> warmfiles;   // in the worker
+static Modules sinks;                   // modules importing the analyzed ones
+
+static AA *uses;                        // in the worker, Dsymbols used by each module or instance
+
+static int reportfd = -1;               // in a compile, pipe to the worker
+static size_t nwarm;                    // in a compile, modules it started with
+static Module *adopter;                 // in a compile, the root getting what the sinks have
+static AA *pending;                     // what the sinks have that it hasn't used
+static Dsymbols adopted;                // and what it has
+static AA *reachedset;
+static Dsymbols reached;                // modules and instances whose uses it needs
+
+static bool readAll(int fd, void *p, size_t len)
+{
+    char *s = (char *)p;
+    while (len)
+    {   ssize_t n = read(fd, s, len);
+        if (n <= 0)
+        {   if (n == -1 && errno == EINTR)
+                continue;
+            return false;
+        }
+        s += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const void *p, size_t len)
+{
+    const char *s = (const char *)p;
+    while (len)
+    {   ssize_t n = write(fd, s, len);
+        if (n <= 0)
+        {   if (n == -1 && errno == EINTR)
+                continue;
+            return false;
+        }
+        s += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**************************************
+ * Send len bytes over a socket, along with three file descriptors,
+ * or receive them.
+ */
+
+union FdControl
+{
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE(3 * sizeof(int))];
+};
+
+static bool sendFds(int sock, void *p, size_t len, int fds[3])
+{
+    struct iovec iov;
+    iov.iov_base = p;
+    iov.iov_len = len;
+    FdControl control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(3 * sizeof(int));
+    memcpy(CMSG_DATA(c), fds, 3 * sizeof(int));
+    return sendmsg(sock, &msg, 0) == (ssize_t)len;
+}
+
+static bool recvFds(int sock, void *p, size_t len, int fds[3])
+{
+    struct iovec iov;
+    iov.iov_base = p;
+    iov.iov_len = len;
+    FdControl control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n;
+    while ((n = recvmsg(sock, &msg, 0)) == -1 && errno == EINTR)
+        ;
+    struct cmsghdr *c = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (!c || c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS ||
+        c->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+        return false;
+    memcpy(fds, CMSG_DATA(c), 3 * sizeof(int));
+    if (!readAll(sock, (char *)p + n, len - n))
+    {   for (int i = 0; i < 3; i++)
+            close(fds[i]);
+        return false;
+    }
+    return true;
+}
+
+/**************************************
+ * A request is its length, with the client's standard input, output
+ * and error, then its current directory and its arguments, each
+ * terminated by a 0.
+ */
+
+static bool readRequest(int conn, Request *r)
+{
+    unsigned len;
+    if (!recvFds(conn, &len, sizeof(len), r->fds))
+        return false;
+    char *p = NULL;
+    if (len && len < 0x1000000)
+    {   p = (char *)mem.malloc(len);
+        if (!readAll(conn, p, len) || p[len - 1])
+            p = NULL;
+    }
+    if (!p)
+    {   for (int i = 0; i < 3; i++)
+            close(r->fds[i]);
+        return false;
+    }
+
+    Strings *args = new Strings();
+    args->push(NULL);
+    r->cwd = p;
+    for (char *q = p + strlen(p) + 1; q < p + len; q += strlen(q) + 1)
+        args->push(q);
+    r->argc = args->dim;
+    args->push(NULL);
+    r->argv = args->tdata();
+    return true;
+}
+
+/**************************************
+ * Is the client on the other end of conn run by the server's user?
+ * Only they may have the server compile, as them.
+ */
+
+static bool isOwnUser(int conn)
+{
+    uid_t uid;
+#if linux
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1)
+        return false;
+    uid = cred.uid;
+#elif __sun
+    ucred_t *cred = NULL;
+    if (getpeerucred(conn, &cred) == -1)
+        return false;
+    uid = ucred_geteuid(cred);
+    ucred_free(cred);
+#else
+    gid_t gid;
+    if (getpeereid(conn, &uid, &gid) == -1)
+        return false;
+#endif
+    return uid == geteuid();
+}
+
+static void getSwitches(Strings *sw, size_t argc, char *argv[])
+{
+    for (size_t i = 1; i < argc; i++)
+    {   char *p = argv[i];
+        if (*p == '-' && memcmp(p, "--server=", 9))
+            sw->push(p);
+    }
+}
+
+static char *modulePath(Module *m)
+{
+    char *path = mem.strdup(m->toPrettyChars());
+    for (char *q = path; *q; q++)
+    {
+        if (*q == '.')
+            *q = '/';
+    }
+    return path;
+}
+
+/**************************************
+ * Has a file of the modules analyzed changed, or would an import
+ * of one of them now find a different file?
+ */
+
+static bool isStale()
+{
+    for (size_t i = 0; i < warmfiles.dim; i++)
+    {   WarmFile *wf = warmfiles[i];
+        struct stat st;
+        if (stat(wf->name, &st) || st.st_size != wf->size)
+            return true;
+        /* A change in the second it was hashed in wouldn't change
+         * its time.
+         */
+        if (st.st_mtime != wf->mtime || st.st_mtime >= wf->checked)
+        {   File f(wf->name);
+            if (f.read() || Incremental::hash(f.buffer, f.len) != wf->hash)
+                return true;
+            wf->mtime = st.st_mtime;    // only touched
+            wf->checked = time(NULL);
+        }
+        char *found = Module::lookForSourceFile(wf->path);
+        if (!found || strcmp(found, wf->found))
+            return true;
+    }
+    return false;
+}
+
+/**************************************
+ * Can r be compiled with the modules analyzed?
+ */
+
+static bool canServeWarm(Request *r)
+{
+    if (strcmp(r->cwd, servercwd))
+        return false;           // relative import paths would differ
+
+    size_t argc = r->argc;
+    char **argv = r->argv;
+    getenv_setargv("DFLAGS", &argc, &argv);
+    Strings sw;
+    getSwitches(&sw, argc, argv);
+    if (sw.dim != switches.dim)
+        return false;
+    for (size_t i = 0; i < sw.dim; i++)
+    {
+        if (strcmp(sw[i], switches[i]))
+            return false;
+    }
+
+    // The modules compiled must not be among those analyzed
+    bool anyfiles = false;
+    for (size_t i = 1; i < r->argc; i++)
+    {   char *p = r->argv[i];
+        if (*p == '-')
+            continue;
+        anyfiles = true;
+        char *real = realpath(p, NULL);
+        if (!real)
+            continue;
+        for (size_t j = 0; j < warmfiles.dim; j++)
+        {
+            if (warmfiles[j]->real && strcmp(warmfiles[j]->real, real) == 0)
+            {   free(real);
+                return false;
+            }
+        }
+        free(real);
+    }
+    return anyfiles;
+}
+
+/**************************************
+ * Analyze the modules a compile imported, given as import declarations,
+ * so compiles after it find them done.
+ * Returns:
+ *      false if that went wrong, and the worker is to be replaced
+ */
+
+static bool warmUp(OutBuffer *imports)
+{
+    char name[20];
+    sprintf(name, "__server%u", (unsigned)sinks.dim + 1);
+    OutBuffer buf;
+    buf.printf("module %s;\n", name);
+    buf.write(imports->data, imports->offset);
+    size_t len = buf.offset;
+    buf.writeByte(0);           // the lexer wants it terminated
+    buf.writeByte(0);
+
+    size_t before = Module::amodules.dim;
+    Module *m = new Module(name, Lexer::idPool(name), 0, 0);
+    m->srcfile->setbuffer(buf.extractData(), len);
+    m->importedFrom = m;
+
+    /* If the analysis says anything, the compiles using it wouldn't,
+     * so don't keep it. What -v says isn't a diagnostic.
+     */
+    fflush(stdout);
+    fflush(stderr);
+    FILE *tmp = tmpfile();
+    if (!tmp)
+        return false;
+    int savedout = dup(1);
+    int savederr = dup(2);
+    dup2(fileno(tmp), 1);
+    dup2(fileno(tmp), 2);
+    char verbose = global.params.verbose;
+    global.params.verbose = 0;
+
+    m->parse();
+    if (!global.errors)
+    {   m->importAll(0);
+        m->semantic();
+        Module::dprogress = 1;
+        Module::runDeferredSemantic();
+        m->semantic2();
+    }
+    global.params.verbose = verbose;
+
+    fflush(stdout);
+    fflush(stderr);
+    bool silent = lseek(fileno(tmp), 0, SEEK_END) == 0;
+    dup2(savedout, 1);
+    dup2(savederr, 2);
+    close(savedout);
+    close(savederr);
+    fclose(tmp);
+    if (!silent || global.errors || global.warnings)
+        return false;
+
+    sinks.push(m);
+    for (size_t i = before; i < Module::amodules.dim; i++)
+    {   Module *mi = Module::amodules[i];
+        if (mi == m)
+            continue;
+        WarmFile *wf = new WarmFile();
+        wf->name = mi->srcfile->toChars();
+        struct stat st;
+        if (stat(wf->name, &st))
+            return false;
+        wf->real = realpath(wf->name, NULL);
+        wf->path = modulePath(mi);
+        wf->found = Module::lookForSourceFile(wf->path);
+        if (!wf->found)
+            wf->found = (char *)"";
+        /* The file may have changed since it was read: have the next
+         * check hash it, against the source that was analyzed.
+         */
+        wf->mtime = st.st_mtime;
+        wf->checked = 0;
+        wf->size = st.st_size;
+        wf->hash = mi->srchash;
+        warmfiles.push(wf);
+    }
+    return true;
+}
+
+/**************************************
+ * The worker is to be replaced because the modules it analyzed are
+ * stale: tell the server which they were, for the next worker to
+ * analyze them again from their files as they are now.
+ */
+
+static void retire(int carryfd)
+{
+    OutBuffer buf;
+    for (size_t i = 0; i < Module::amodules.dim; i++)
+    {   Module *m = Module::amodules[i];
+        if (m->importedFrom != m)
+            buf.printf("import %s;\n", m->toPrettyChars());
+    }
+    writeAll(carryfd, buf.data, buf.offset);
+}
+
+/**************************************
+ * The worker: take the compiles sent to listenfd one at a time,
+ * each done by a process of its own. While there are none, check
+ * every second whether what it analyzed has changed.
+ * Returns:
+ *      true    in the process to do a compile, with files to compile
+ *      false   in the worker, which is to be replaced
+ */
+
+static bool serve(int listenfd, int carryfd, Strings *files)
+{
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGPIPE, SIG_IGN);   // clients may go away
+    backend_init();
+
+    /* Number the identifiers a compile makes up as if the analysis
+     * it gets hadn't been done: they're only unique to the module
+     * they're made for, and the compile's modules aren't analyzed.
+     */
+    int uniqueIds = Lexer::uniqueIds;
+    size_t generatedIds = Identifier::generatedIds;
+
+    /* If they no longer compile, start again with nothing analyzed
+     * rather than with part of it.
+     */
+    if (carried.offset && !warmUp(&carried))
+        return false;
+
+    while (1)
+    {
+        struct pollfd pfd;
+        pfd.fd = listenfd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 1000) == 0)
+        {
+            FileName::forgetCached();
+            if (isStale())
+            {   retire(carryfd);
+                return false;
+            }
+            continue;
+        }
+
+        int conn = accept(listenfd, NULL, NULL);
+        if (conn == -1)
+        {   if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return false;
+        }
+        Request r;
+        if (!isOwnUser(conn) || !readRequest(conn, &r))
+        {   close(conn);
+            continue;
+        }
+
+        FileName::forgetCached();       // files may have come and gone
+        bool stale = isStale();
+        bool warm = !stale && canServeWarm(&r);
+        int pipefd[2];
+        if (warm && pipe(pipefd) == -1)
+            warm = false;
+
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(listenfd);
+            close(carryfd);
+            close(conn);
+            for (int i = 0; i < 3; i++)
+            {   dup2(r.fds[i], i);
+                close(r.fds[i]);
+            }
+            signal(SIGPIPE, SIG_DFL);
+            if (chdir(r.cwd))
+            {   error(0, "cannot change to directory %s", r.cwd);
+                _exit(EXIT_FAILURE);
+            }
+            if (!warm)
+            {   r.argv[0] = exepath;
+                execvp(exepath, r.argv);
+                error(0, "cannot run %s", exepath);
+                _exit(EXIT_FAILURE);
+            }
+            close(pipefd[0]);
+            reportfd = pipefd[1];
+            nwarm = Module::amodules.dim;
+            Lexer::uniqueIds = uniqueIds;
+            Identifier::generatedIds = generatedIds;
+            for (size_t i = 1; i < r.argc; i++)
+            {
+                if (r.argv[i][0] != '-')
+                    files->push(r.argv[i]);
+            }
+            return true;
+        }
+
+        // Read what it imported, until it's done
+        OutBuffer imports;
+        if (warm)
+        {   close(pipefd[1]);
+            char tmp[4096];
+            ssize_t n;
+            while ((n = read(pipefd[0], tmp, sizeof(tmp))) != 0)
+            {
+                if (n == -1)
+                {   if (errno == EINTR)
+                        continue;
+                    break;
+                }
+                imports.write(tmp, n);
+            }
+            close(pipefd[0]);
+        }
+
+        int status = EXIT_FAILURE;
+        int ws;
+        OutBuffer msg;
+        if (pid == -1)
+            msg.printf("Error: cannot fork to compile\n");
+        else if (waitpid(pid, &ws, 0) != -1)
+        {
+            if (WIFEXITED(ws))
+                status = WEXITSTATUS(ws);
+            else if (WIFSIGNALED(ws))
+                msg.printf("--- killed by signal %d\n", WTERMSIG(ws));
+        }
+        writeAll(r.fds[2], msg.data, msg.offset);
+        for (int i = 0; i < 3; i++)
+            close(r.fds[i]);
+        writeAll(conn, &status, sizeof(status));
+        close(conn);
+
+        if (stale)
+        {   retire(carryfd);
+            return false;
+        }
+        if (warm && status == EXIT_SUCCESS && imports.offset && !warmUp(&imports))
+            return false;
+    }
+}
+
+static void stopServer(int sig)
+{
+    if (worker > 0)
+        kill(worker, SIGTERM);
+    unlink(socketpath);
+    _exit(EXIT_SUCCESS);
+}
+
+#endif
+
+/**************************************
+ * Send the compile on the command line to the server on socket path.
+ * Returns:
+ *      the compile's exit status, -1 if there's no server
+ */
+
+int Server::client(const char *path, size_t argc, char *argv[])
+{
+#if SERVER
+    struct sockaddr_un addr;
+    char cwd[PATH_MAX];
+    if (strlen(path) >= sizeof(addr.sun_path) || !getcwd(cwd, sizeof(cwd)))
+        return -1;
+
+    OutBuffer buf;
+    buf.writestring(cwd);
+    buf.writeByte(0);
+    for (size_t i = 1; i < argc; i++)
+    {
+        if (memcmp(argv[i], "--client=", 9) == 0)
+            continue;
+        buf.writestring(argv[i]);
+        buf.writeByte(0);
+    }
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == -1)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {   close(sock);
+        return -1;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    unsigned len = buf.offset;
+    int fds[3] = { 0, 1, 2 };
+    int status;
+    if (!sendFds(sock, &len, sizeof(len), fds) ||
+        !writeAll(sock, buf.data, len) ||
+        !readAll(sock, &status, sizeof(status)))
+    {
+        error(0, "lost the compile server on %s", path);
+        status = EXIT_FAILURE;
+    }
+    close(sock);
+    return status;
+#else
+    return -1;
+#endif
+}
+
+/**************************************
+ * Listen for compiles on socket path. Only returns in a process
+ * forked to do a compile, with the source files to compile in files.
+ * Input:
+ *      argc, argv      the command line, after response files and DFLAGS
+ */
+
+void Server::run(char *path, size_t argc, char *argv[], Strings *files)
+{
+#if SERVER
+    socketpath = path;
+    getSwitches(&switches, argc, argv);
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd)))
+    {   error(0, "cannot get the current directory");
+        fatal();
+    }
+    servercwd = mem.strdup(cwd);
+#if linux
+    exepath = realpath("/proc/self/exe", NULL);
+#else
+    exepath = strchr(argv[0], '/') ? realpath(argv[0], NULL) : NULL;
+#endif
+    if (!exepath)
+        exepath = argv[0];
+
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {   error(0, "socket name %s is too long", path);
+        fatal();
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct stat st;
+    if (listenfd != -1 && lstat(path, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {   error(0, "%s is not a socket", path);
+            fatal();
+        }
+        if (connect(listenfd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+        {   error(0, "there is already a server on %s", path);
+            fatal();
+        }
+        unlink(path);           // left by a server that didn't stop
+    }
+    /* Connecting needs write permission on the socket: only the
+     * server's user gets it, and it's given before anyone can connect.
+     */
+    if (listenfd == -1 ||
+        bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        chmod(path, S_IRUSR | S_IWUSR) == -1 ||
+        listen(listenfd, 64) == -1)
+    {
+        error(0, "cannot listen on %s: %s", path, strerror(errno));
+        fatal();
+    }
+
+    signal(SIGTERM, &stopServer);
+    signal(SIGINT, &stopServer);
+    signal(SIGHUP, &stopServer);
+    if (global.params.verbose)
+        printf("server    %s\n", path);
+
+    while (1)
+    {
+        int carryfd[2];
+        if (pipe(carryfd) == -1)
+        {   error(0, "cannot make a pipe for the server's worker");
+            unlink(path);
+            fatal();
+        }
+        fflush(stdout);
+        fflush(stderr);
+        worker = fork();
+        if (worker == 0)
+        {
+            close(carryfd[0]);
+            bool compile = serve(listenfd, carryfd[1], files);
+            close(carryfd[1]);
+            if (compile)
+                return;
+            _exit(EXIT_SUCCESS);
+        }
+        if (worker == -1)
+        {   error(0, "cannot fork the server's worker");
+            unlink(path);
+            fatal();
+        }
+
+        close(carryfd[1]);
+        carried.reset();
+        char tmp[4096];
+        ssize_t n;
+        while ((n = read(carryfd[0], tmp, sizeof(tmp))) != 0)
+        {
+            if (n == -1)
+            {   if (errno == EINTR)
+                    continue;
+                break;
+            }
+            carried.write(tmp, n);
+        }
+        close(carryfd[0]);
+        int status;
+        while (waitpid(worker, &status, 0) == -1 && errno == EINTR)
+            ;
+    }
+#else
+    error(0, "--server is not supported on this platform");
+    fatal();
+#endif
+}
+
+#if SERVER
+
+/* In a compile, s is needed: so are the Dsymbols it used while being
+ * analyzed by the worker, and if one of the sinks has it, it goes in
+ * the adopter's object file.
+ */
+static void reach(Dsymbol *s)
+{
+    Dsymbol **ps = (Dsymbol **)_aaGet(&reachedset, s);
+    if (!*ps)
+    {   *ps = s;
+        reached.push(s);
+    }
+}
+
+static void claim(Dsymbol *s)
+{
+    reach(s);
+    if (_aaGetRvalue(pending, s))
+    {   *(Dsymbol **)_aaGet(&pending, s) = NULL;
+        adopted.push(s);
+    }
+}
+
+#endif
+
+/**************************************
+ * The analysis in scope sc uses s, which has been put in the members
+ * of the module sc->module is imported from, or was found there.
+ * In the worker, a sink's members are only needed by the compiles
+ * that need what used them, so remember what that was. In a compile,
+ * this needs it.
+ */
+
+void Server::use(Scope *sc, Dsymbol *s)
+{
+#if SERVER
+    if (adopter)
+    {   claim(s);
+        return;
+    }
+    Dsymbol *by = sc->tinst ? (Dsymbol *)sc->tinst : (Dsymbol *)sc->module;
+    Dsymbols **pa = (Dsymbols **)_aaGet(&uses, by);
+    if (!*pa)
+        *pa = new Dsymbols();
+    Dsymbols *a = *pa;
+    if (!a->dim || (*a)[a->dim - 1] != s)
+        a->push(s);
+#endif
+}
+
+/**************************************
+ * For a compile by the server, make root module m the one the
+ * analyzed modules are imported from, as a compile from scratch
+ * would, so it gets the template instances and TypeInfo's they
+ * create from now on. Those the sinks already have are only
+ * adopted as the compile uses them, by adoptUsed().
+ */
+
+void Server::adopt(Module *m)
+{
+#if SERVER
+    adopter = m;
+    for (size_t i = 0; i < sinks.dim; i++)
+    {   Dsymbols *members = sinks[i]->members;
+        for (size_t j = 0; j < members->dim; j++)
+        {   Dsymbol *s = (*members)[j];
+            if (!s->isImport())
+                *(Dsymbol **)_aaGet(&pending, s) = s;
+        }
+    }
+    for (size_t i = 0; i < nwarm; i++)
+    {   Module *mi = Module::amodules[i];
+        if (mi->importedFrom != mi)
+            mi->importedFrom = m;
+    }
+#endif
+}
+
+/**************************************
+ * For a compile by the server, after its semantic analysis, adopt
+ * what the sinks have that the modules it imports, directly or not,
+ * used when the worker analyzed them, and finish analyzing it.
+ */
+
+void Server::adoptUsed(Modules *modules)
+{
+#if SERVER
+    if (!adopter)
+        return;
+    for (size_t i = 0; i < modules->dim; i++)
+        reach((*modules)[i]);
+
+    Scope *sc = NULL;
+    size_t i = 0;
+    size_t analyzed = 0;
+    while (i < reached.dim || analyzed < adopted.dim)
+    {
+        if (i < reached.dim)
+        {   Dsymbol *s = reached[i++];
+            Module *m = s->isModule();
+            if (m)
+            {   for (size_t j = 0; j < m->aimports.dim; j++)
+                    reach(m->aimports[j]);
+            }
+            Dsymbols *a = (Dsymbols *)_aaGetRvalue(uses, s);
+            if (a)
+            {   for (size_t j = 0; j < a->dim; j++)
+                    claim((*a)[j]);
+            }
+            continue;
+        }
+
+        // Analyzing it may use yet more
+        Dsymbol *s = adopted[analyzed++];
+        if (!sc)
+            sc = Scope::createGlobal(adopter);
+        s->semantic3(sc);
+        if (global.params.useInline)
+            s->inlineScan();
+    }
+#endif
+}
+
+/**************************************
+ * Generate what the compile adopted into m's object file, if m is
+ * the root module that adopted it.
+ */
+
+void Server::genAdopted(Module *m, int multiobj)
+{
+#if SERVER
+    if (m != adopter)
+        return;
+    for (size_t i = 0; i < adopted.dim; i++)
+        adopted[i]->toObjFile(multiobj);
+#endif
+}
+
+/**************************************
+ * For a compile by the server, tell the worker which modules it
+ * imported that weren't analyzed already.
+ */
+
+void Server::reportImports()
+{
+#if SERVER
+    if (reportfd == -1)
+        return;
+    OutBuffer buf;
+    for (size_t i = nwarm; i < Module::amodules.dim; i++)
+    {   Module *m = Module::amodules[i];
+        if (m->importedFrom != m && !m->isDocFile)
+            buf.printf("import %s;\n", m->toPrettyChars());
+    }
+    writeAll(reportfd, buf.data, buf.offset);
+    close(reportfd);
+    reportfd = -1;
+#endif
+}
@@ -0,0 +1,53 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+#ifndef DMD_SERVER_H
+#define DMD_SERVER_H
+
+#ifdef __DMC__
+#pragma once
+#endif /* __DMC__ */
+
+#include "mars.h"
+#include "arraytypes.h"
+
+struct Module;
+struct Dsymbol;
+struct Scope;
+
+/**************************************
+ * dmd --server=socket switches...
+ * listens on a Unix socket for compiles sent by
+ * dmd --client=socket switches... files...
+ * and keeps the modules they import analyzed, in a worker process,
+ * for the compiles after them. Each compile is done by a process
+ * forked from the worker, with the client's directory, standard
+ * input, output and error, so it behaves as if run by the client.
+ *
+ * A compile only gets the analyzed modules if its switches are the
+ * server's, it is in the server's directory, and none of its source
+ * files is one of them; otherwise it is done from scratch. When one
+ * of their files changes, or an import would now find a different
+ * file, the worker is replaced by a new one, forked from the server
+ * before it had analyzed anything.
+ */
+
+struct Server
+{
+    static int client(const char *path, size_t argc, char *argv[]);
+    static void run(char *path, size_t argc, char *argv[], Strings *files);
+    static void use(Scope *sc, Dsymbol *s);
+    static void adopt(Module *m);
+    static void adoptUsed(Modules *modules);
+    static void genAdopted(Module *m, int multiobj);
+    static void reportImports();
+};
+
+#endif /* DMD_SERVER_H */
@@ -50,6 +50,7 @@ struct DefaultStatement;
 struct LabelStatement;
 struct HdrGenState;
 struct InterState;
+struct CtfeCompiler;
 
 enum TOK;
 
@@ -108,6 +109,7 @@ struct Statement : Object
     virtual Statement *scopeCode(Scope *sc, Statement **sentry, Statement **sexit, Statement **sfinally);
     virtual Statements *flatten(Scope *sc);
     virtual Expression *interpret(InterState *istate);
+    virtual int ctfeCompile(CtfeCompiler *cc);
     virtual Statement *last();
 
     virtual int inlineCost(InlineCostState *ics);
@@ -146,6 +148,7 @@ struct ExpStatement : Statement
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
     int blockExit(bool mustNotThrow);
     int isEmpty();
     Statement *scopeCode(Scope *sc, Statement **sentry, Statement **sexit, Statement **sfinally);
@@ -201,6 +204,7 @@ struct CompoundStatement : Statement
     Statements *flatten(Scope *sc);
     ReturnStatement *isReturnStatement();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
     Statement *last();
 
     int inlineCost(InlineCostState *ics);
@@ -262,6 +266,7 @@ struct ScopeStatement : Statement
     int comeFrom();
     int isEmpty();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
 
     int inlineCost(InlineCostState *ics);
     Expression *doInline(InlineDoState *ids);
@@ -306,6 +311,7 @@ struct DoStatement : Statement
     int blockExit(bool mustNotThrow);
     int comeFrom();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     Statement *inlineScan(InlineScanState *iss);
@@ -338,6 +344,7 @@ struct ForStatement : Statement
     int blockExit(bool mustNotThrow);
     int comeFrom();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     int inlineCost(InlineCostState *ics);
@@ -423,6 +430,7 @@ struct IfStatement : Statement
     Statement *syntaxCopy();
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     bool usesEH();
     int blockExit(bool mustNotThrow);
@@ -619,6 +627,7 @@ struct ReturnStatement : Statement
     Statement *semantic(Scope *sc);
     int blockExit(bool mustNotThrow);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
 
     int inlineCost(InlineCostState *ics);
     Expression *doInline(InlineDoState *ids);
@@ -638,6 +647,7 @@ struct BreakStatement : Statement
     Statement *syntaxCopy();
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
     int blockExit(bool mustNotThrow);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
@@ -652,6 +662,7 @@ struct ContinueStatement : Statement
     Statement *syntaxCopy();
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
     int blockExit(bool mustNotThrow);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
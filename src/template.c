@@ -32,6 +32,8 @@
 #include "identifier.h"
 #include "hdrgen.h"
 #include "id.h"
+#include "vtime.h"
+#include "server.h"
 
 #if WINDOWS_SEH
 #include <windows.h>
@@ -315,6 +317,174 @@ int arrayObjectMatch(Objects *oa1, Objects *oa2, TemplateDeclaration *tempdecl,
     return 1;
 }
 
+/******************************
+ * Hashing for the table of existing template instances.
+ * The hash must be consistent with match(): if match(o1, o2)
+ * then o1 and o2 must hash the same.
+ * Returns 0 if o cannot be hashed, because whether it matches
+ * may change as semantic analysis proceeds.
+ */
+
+inline hash_t mixHash(hash_t h, hash_t x)
+{
+    return h * 37 + (x ^ (x >> 5));
+}
+
+static int expressionHash(Expression *e, hash_t *phash)
+{
+    hash_t h = mixHash(3, e->op);
+    switch (e->op)
+    {
+        case TOKint64:
+            h = mixHash(h, (hash_t)((IntegerExp *)e)->value);
+            break;
+
+        case TOKstring:
+            h = mixHash(h, ((StringExp *)e)->len);
+            break;
+
+        case TOKfloat64:
+        case TOKcomplex80:
+        case TOKnull:
+            break;
+
+        case TOKvar:
+            h = mixHash(h, (hash_t)((VarExp *)e)->var);
+            break;
+
+        case TOKtuple:
+        {   Expressions *exps = ((TupleExp *)e)->exps;
+            h = mixHash(h, exps->dim);
+            for (size_t i = 0; i < exps->dim; i++)
+            {   hash_t h2;
+                if (!expressionHash((*exps)[i], &h2))
+                    return 0;
+                h = mixHash(h, h2);
+            }
+            break;
+        }
+
+        default:
+            // Expression::equals() is identity
+            h = mixHash(h, (hash_t)e);
+            break;
+    }
+    *phash = h;
+    return 1;
+}
+
+static int objectHash(Object *o, hash_t *phash)
+{
+    Type *t = isType(o);
+    Dsymbol *s = isDsymbol(o);
+    Expression *ea = isExpression(o);
+    Expression *e = s ? getValue(s) : getValue(ea);
+    Tuple *u = isTuple(o);
+    hash_t h;
+
+    if (t)
+    {
+        if (t->ty == Ttuple)
+        {   /* TypeTuple::equals() compares the argument types,
+             * ignoring storage classes, so don't use the deco.
+             */
+            Parameters *args = ((TypeTuple *)t)->arguments;
+            h = mixHash(1, args->dim);
+            for (size_t i = 0; i < args->dim; i++)
+            {   Type *ta = (*args)[i]->type;
+                if (!ta || !ta->deco || ta->ty == Ttuple)
+                    return 0;
+                h = mixHash(h, (hash_t)ta->deco);
+            }
+        }
+        else
+        {   // deco strings are unique, but not set until after semantic()
+            if (!t->deco)
+                return 0;
+            h = mixHash(2, (hash_t)t->deco);
+        }
+    }
+    else if (e)
+    {
+        if (e != ea)
+        {   /* The value of a manifest constant may not have
+             * been run through semantic() yet.
+             */
+            switch (e->op)
+            {
+                case TOKint64:
+                case TOKfloat64:
+                case TOKcomplex80:
+                case TOKstring:
+                case TOKnull:
+                    break;
+
+                default:
+                    return 0;
+            }
+        }
+        if (!expressionHash(e, &h))
+            return 0;
+    }
+    else if (s)
+    {
+        if (!s->parent)
+            return 0;
+        h = mixHash(4, (hash_t)s->parent);
+        // Dsymbol::equals() compares identifiers by string
+        h = mixHash(h, s->ident ? s->ident->hashCode() : (hash_t)s);
+    }
+    else if (u)
+    {
+        h = mixHash(5, u->objects.dim);
+        for (size_t i = 0; i < u->objects.dim; i++)
+        {   hash_t h2;
+            if (!objectHash(u->objects[i], &h2))
+                return 0;
+            h = mixHash(h, h2);
+        }
+    }
+    else
+        return 0;
+    *phash = h;
+    return 1;
+}
+
+/******************************
+ * Determine if match() would diagnose a recursive template
+ * expansion when o is compared against an instance of tempdecl.
+ */
+
+static int isRecursiveExpansion(Object *o, TemplateDeclaration *tempdecl, Scope *sc)
+{
+    Type *t = isType(o);
+    Tuple *u = isTuple(o);
+    if (t)
+    {
+        Dsymbol *s = t->toDsymbol(sc);
+        if (s && s->parent)
+        {   TemplateInstance *ti1 = s->parent->isTemplateInstance();
+            if (ti1 && ti1->tempdecl == tempdecl)
+            {
+                for (Scope *sc1 = sc; sc1; sc1 = sc1->enclosing)
+                {
+                    if (sc1->scopesym == ti1)
+                        return 1;
+                }
+            }
+        }
+    }
+    else if (u)
+    {
+        for (size_t i = 0; i < u->objects.dim; i++)
+        {
+            if (isRecursiveExpansion(u->objects[i], tempdecl, sc))
+                return 1;
+        }
+    }
+    return 0;
+}
+
 /****************************************
  * This makes a 'pretty' version of the template arguments.
  * It's analogous to genIdent() which makes a mangled version.
@@ -387,6 +557,119 @@ Object *objectSyntaxCopy(Object *o)
 #endif
 
 
+/* ======================== TemplateStats =================================== */
+
+ArrayBase<TemplateStats> TemplateStats::all;
+
+TemplateStats *TemplateStats::get(TemplateDeclaration *td)
+{
+    if (!td->stats)
+    {
+        TemplateStats *ts = (TemplateStats *)mem.calloc(1, sizeof(TemplateStats));
+        ts->td = td;
+        td->stats = ts;
+        all.push(ts);
+    }
+    return td->stats;
+}
+
+/* Times template instantiation and deduction, charging each
+ * TemplateDeclaration with its own time, not that of the
+ * instantiations nested in it.
+ */
+
+struct TemplateStatsScope
+{
+    TemplateDeclaration *td;    // to charge, NULL if not known (yet)
+    double start;
+    double inner;               // time charged by nested scopes
+    TemplateStatsScope *outer;
+    int active;
+
+    static TemplateStatsScope *current;
+
+    TemplateStatsScope(TemplateDeclaration *td = NULL)
+    {
+        active = global.params.vtemplates;
+        if (active)
+        {   this->td = td;
+            inner = 0;
+            outer = current;
+            current = this;
+            start = VTime::wallclock();
+        }
+    }
+
+    ~TemplateStatsScope()
+    {
+        if (!active)
+            return;
+        double t = VTime::wallclock() - start;
+        current = outer;
+        if (td)
+        {   TemplateStats::get(td)->time += t - inner;
+            if (outer)
+                outer->inner += t;
+        }
+        else if (outer)
+            outer->inner += inner;      // leave the rest to outer
+    }
+};
+
+TemplateStatsScope *TemplateStatsScope::current;
+
+/**************************************
+ * Name of the template, qualified but without its parameters.
+ */
+
+char *TemplateStats::toChars()
+{
+    Dsymbol *p = td->toParent();
+    if (!p)
+        return td->ident->toChars();
+    OutBuffer buf;
+    buf.writestring(p->toPrettyChars());
+    buf.writeByte('.');
+    buf.writestring(td->ident->toChars());
+    buf.writeByte(0);
+    return (char *)buf.extractData();
+}
+
+static int statsCmp(const void *p1, const void *p2)
+{
+    TemplateStats *ts1 = *(TemplateStats **)p1;
+    TemplateStats *ts2 = *(TemplateStats **)p2;
+    if (ts1->time != ts2->time)
+        return ts1->time < ts2->time ? 1 : -1;
+    return (int)ts2->instances - (int)ts1->instances;
+}
+
+/**************************************
+ * Sort all by time taken, most first.
+ */
+
+void TemplateStats::sort()
+{
+    qsort(all.tdata(), all.dim, sizeof(TemplateStats *), &statsCmp);
+}
+
+/**************************************
+ * Print the statistics for -vtemplates.
+ */
+
+void TemplateStats::report()
+{
+    sort();
+    printf("   time ms instances      hits deduced   matches   failed  template\n");
+    for (size_t i = 0; i < all.dim; i++)
+    {   TemplateStats *ts = all[i];
+        printf("%10.2f %9u %9u %7u %9u %8u  %s  %s\n",
+            ts->time * 1e3, ts->instances, ts->hits, ts->deductions,
+            ts->matches, ts->constraintFails,
+            ts->toChars(), ts->td->loc.toChars());
+    }
+}
+
 /* ======================== TemplateDeclaration ============================= */
 
 TemplateDeclaration::TemplateDeclaration(Loc loc, Identifier *id,
@@ -421,6 +704,9 @@ TemplateDeclaration::TemplateDeclaration(Loc loc, Identifier *id,
     this->literal = 0;
     this->ismixin = ismixin;
     this->previous = NULL;
+    this->stats = NULL;
+    this->instancesTable = NULL;
+    this->numUnhashed = 0;
 
     // Compute in advance for Ddoc's use
     if (members)
@@ -719,6 +1005,8 @@ MATCH TemplateDeclaration::matchWithInstance(TemplateInstance *ti,
 #if LOGM
     printf("\n+TemplateDeclaration::matchWithInstance(this = %s, ti = %s, flag = %d)\n", toChars(), ti->toChars(), flag);
 #endif
+    if (global.params.vtemplates)
+        TemplateStats::get(this)->matches++;
 
 #if 0
     printf("dedtypes->dim = %d, parameters->dim = %d\n", dedtypes_dim, parameters->dim);
@@ -844,7 +1132,11 @@ MATCH TemplateDeclaration::matchWithInstance(TemplateInstance *ti,
         if (e->isBool(TRUE))
             ;
         else if (e->isBool(FALSE))
+        {
+            if (global.params.vtemplates)
+                TemplateStats::get(this)->constraintFails++;
             goto Lnomatch;
+        }
         else
         {
             e->error("constraint %s is not constant or does not evaluate to a bool", e->toChars());
@@ -1866,7 +2158,11 @@ Lmatch:
         if (e->isBool(TRUE))
             ;
         else if (e->isBool(FALSE))
+        {
+            if (global.params.vtemplates)
+                TemplateStats::get(this)->constraintFails++;
             goto Lnomatch;
+        }
         else
         {
             e->error("constraint %s is not constant or does not evaluate to a bool", e->toChars());
@@ -2008,6 +2304,66 @@ int TemplateDeclaration::isOverloadable()
     return 1;
 }
 
+/***********************************
+ * Return the existing instances that may match ti,
+ * in the order they were instantiated.
+ * ti->computeHash() must have been run.
+ */
+
+TemplateInstances *TemplateDeclaration::findInstances(TemplateInstance *ti, Scope *sc)
+{
+    /* Fall back to searching all the instances if they cannot all be
+     * found by hash, or if match() may need to diagnose a recursive
+     * expansion against an instance with a different hash.
+     */
+    if (!ti->hashed || numUnhashed)
+        return &instances;
+    for (size_t i = 0; i < ti->tdtypes.dim; i++)
+    {
+        if (isRecursiveExpansion(ti->tdtypes[i], this, sc))
+            return &instances;
+    }
+
+    static TemplateInstances empty;
+    TemplateInstances *tis = (TemplateInstances *)_aaGetRvalue(instancesTable, (void *)ti->hash);
+    return tis ? tis : &empty;
+}
+
+void TemplateDeclaration::addInstance(TemplateInstance *ti)
+{
+    instances.push(ti);
+    if (ti->hashed)
+    {
+        TemplateInstances **ptis = (TemplateInstances **)_aaGet(&instancesTable, (void *)ti->hash);
+        if (!*ptis)
+            *ptis = new TemplateInstances();
+        (*ptis)->push(ti);
+    }
+    else
+        numUnhashed++;
+}
+
+void TemplateDeclaration::removeInstance(size_t idx)
+{
+    TemplateInstance *ti = instances[idx];
+    instances.remove(idx);
+    if (ti->hashed)
+    {
+        TemplateInstances *tis = (TemplateInstances *)_aaGetRvalue(instancesTable, (void *)ti->hash);
+        assert(tis);
+        for (size_t i = tis->dim; i--;)
+        {
+            if ((*tis)[i] == ti)
+            {   tis->remove(i);
+                return;
+            }
+        }
+        assert(0);
+    }
+    else
+        numUnhashed--;
+}
+
 /*************************************************
  * Given function arguments, figure out which template function
  * to expand, and return that function.
@@ -2031,6 +2387,9 @@ FuncDeclaration *TemplateDeclaration::deduceFunctionTemplate(Scope *sc, Loc loc,
     Objects *tdargs = new Objects();
     TemplateInstance *ti;
     FuncDeclaration *fd_best;
+    TemplateStatsScope tss(this);
+    if (global.params.vtemplates)
+        TemplateStats::get(this)->deductions++;
 
 #if 0
     printf("TemplateDeclaration::deduceFunctionTemplate() %s\n", toChars());
@@ -4613,6 +4972,8 @@ TemplateInstance::TemplateInstance(Loc loc, Identifier *ident)
     this->havetempdecl = 0;
     this->isnested = NULL;
     this->speculative = 0;
+    this->hash = 0;
+    this->hashed = 0;
 }
 
 /*****************
@@ -4641,6 +5002,8 @@ TemplateInstance::TemplateInstance(Loc loc, TemplateDeclaration *td, Objects *ti
     this->havetempdecl = 1;
     this->isnested = NULL;
     this->speculative = 0;
+    this->hash = 0;
+    this->hashed = 0;
 
     assert((size_t)tempdecl->scope > 0x10000);
 }
@@ -4784,6 +5147,8 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
 #endif
         return;
     }
+    VTimeScope vt("template", this);
+    TemplateStatsScope tss;
 
     // get the enclosing template instance from the scope tinst
     tinst = sc->tinst;
@@ -4849,6 +5214,8 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
         }
     }
 
+    tss.td = tempdecl;
+
     // If tempdecl is a mixin, disallow it
     if (tempdecl->ismixin)
         error("mixin templates are not regular templates");
@@ -4859,9 +5226,11 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
      * implements the typeargs. If so, just refer to that one instead.
      */
 
-    for (size_t i = 0; i < tempdecl->instances.dim; i++)
+    computeHash();
+    TemplateInstances *tis = tempdecl->findInstances(this, sc);
+    for (size_t i = 0; i < tis->dim; i++)
     {
-        TemplateInstance *ti = tempdecl->instances[i];
+        TemplateInstance *ti = (*tis)[i];
 #if LOG
         printf("\t%s: checking for match with instance %d (%p): '%s'\n", toChars(), i, ti, ti->toChars());
 #endif
@@ -4909,6 +5278,8 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
         // It's a match
         inst = ti;
         parent = ti->parent;
+        if (global.params.server)
+            Server::use(sc, ti);
 
         // If both this and the previous instantiation were speculative,
         // use the number of errors that happened last time.
@@ -4933,6 +5304,8 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
 #if LOG
         printf("\tit's a match with instance %p, %d\n", inst, inst->semanticRun);
 #endif
+        if (global.params.vtemplates)
+            TemplateStats::get(tempdecl)->hits++;
         return;
 
      L1:
@@ -4952,7 +5325,9 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
         speculative = 1;
 
     size_t tempdecl_instance_idx = tempdecl->instances.dim;
-    tempdecl->instances.push(this);
+    tempdecl->addInstance(this);
+    if (global.params.vtemplates)
+        TemplateStats::get(tempdecl)->instances++;
     parent = tempdecl->parent;
     //printf("parent = '%s'\n", parent->kind());
 
@@ -5022,6 +5397,8 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
             if (this == (*a)[i])  // if already in Array
                 break;
         }
+        if (global.params.server)
+            Server::use(sc, this);
     }
 #endif
 
@@ -5196,7 +5573,7 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
             // instance/symbol lists we added it to and reset our state to
             // finish clean and so we can try to instantiate it again later
             // (see bugzilla 4302 and 6602).
-            tempdecl->instances.remove(tempdecl_instance_idx);
+            tempdecl->removeInstance(tempdecl_instance_idx);
             if (target_symbol_list)
             {
                 // Because we added 'this' in the last position above, we
@@ -5676,6 +6053,29 @@ TemplateDeclaration *TemplateInstance::findBestMatch(Scope *sc, Expressions *far
 }
 
 
+/*****************************************
+ * Compute hash of tdtypes and isnested, for looking up
+ * existing instances in tempdecl->instancesTable.
+ * Sets hashed property if successful, and returns != 0;
+ */
+
+int TemplateInstance::computeHash()
+{
+    hash_t h = (hash_t)isnested;
+    h ^= h >> 4;
+    for (size_t i = 0; i < tdtypes.dim; i++)
+    {   hash_t h2;
+        if (!objectHash(tdtypes[i], &h2))
+        {   hashed = 0;
+            return 0;
+        }
+        h = mixHash(h, h2);
+    }
+    hash = h;
+    hashed = 1;
+    return 1;
+}
+
 /*****************************************
  * Determines if a TemplateInstance will need a nested
  * generation of the TemplateDeclaration.
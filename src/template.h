@@ -21,6 +21,7 @@
 
 
 struct OutBuffer;
+struct AA;
 struct Identifier;
 struct TemplateInstance;
 struct TemplateParameter;
@@ -37,6 +38,7 @@ struct AliasDeclaration;
 struct FuncDeclaration;
 struct HdrGenState;
 struct Parameter;
+struct TemplateStats;
 enum MATCH;
 enum PASS;
 
@@ -55,6 +57,8 @@ struct TemplateDeclaration : ScopeDsymbol
     TemplateParameters *origParameters; // originals for Ddoc
     Expression *constraint;
     TemplateInstances instances;        // array of TemplateInstance's
+    AA *instancesTable;                 // hash of instances[], maps hash to TemplateInstances*
+    size_t numUnhashed;                 // number of instances[] not in instancesTable
 
     TemplateDeclaration *overnext;      // next overloaded TemplateDeclaration
     TemplateDeclaration *overroot;      // first in overnext list
@@ -74,6 +78,8 @@ struct TemplateDeclaration : ScopeDsymbol
     };
     Previous *previous;         // threaded list of previous instantiation attempts on stack
 
+    TemplateStats *stats;       // for -vtemplates, NULL if none yet
+
     TemplateDeclaration(Loc loc, Identifier *id, TemplateParameters *parameters,
         Expression *constraint, Dsymbols *decldefs, int ismixin);
     Dsymbol *syntaxCopy(Dsymbol *);
@@ -102,6 +108,32 @@ struct TemplateDeclaration : ScopeDsymbol
     int isOverloadable();
 
     void makeParamNamesVisibleInConstraint(Scope *paramscope, Expressions *fargs);
+
+    TemplateInstances *findInstances(TemplateInstance *ti, Scope *sc);
+    void addInstance(TemplateInstance *ti);
+    void removeInstance(size_t idx);
+};
+
+/**************************************
+ * For -vtemplates, what instantiating a TemplateDeclaration cost.
+ */
+
+struct TemplateStats
+{
+    TemplateDeclaration *td;
+    unsigned instances;         // new instances
+    unsigned hits;              // instantiations that reused an existing instance
+    unsigned deductions;        // function calls deduced against td's overloads
+    unsigned matches;           // matchWithInstance() calls
+    unsigned constraintFails;   // constraints that evaluated to false
+    double time;                // seconds, less that of nested instantiations
+
+    static ArrayBase<TemplateStats> all;
+
+    static TemplateStats *get(TemplateDeclaration *td);
+    char *toChars();
+    static void sort();
+    static void report();
 };
 
 struct TemplateParameter
@@ -298,6 +330,8 @@ struct TemplateInstance : ScopeDsymbol
     int havetempdecl;   // 1 if used second constructor
     Dsymbol *isnested;  // if referencing local symbols, this is the context
     int speculative;    // 1 if only instantiated with errors gagged
+    hash_t hash;        // hash of tdtypes and isnested, if hashed
+    int hashed;         // 1 if hash is valid and this is in tempdecl->instancesTable
 #ifdef IN_GCC
     /* On some targets, it is necessary to know whether a symbol
        will be emitted in the output or not before the symbol
@@ -332,6 +366,7 @@ struct TemplateInstance : ScopeDsymbol
     TemplateDeclaration *findBestMatch(Scope *sc, Expressions *fargs);
     void declareParameters(Scope *sc);
     int hasNestedArgs(Objects *tiargs);
+    int computeHash();
     Identifier *genIdent(Objects *args);
     void expandMembers(Scope *sc);
     void tryExpandMembers(Scope *sc);
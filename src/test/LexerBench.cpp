@@ -0,0 +1,141 @@
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+/* Lexer throughput benchmark, over a large source file of the kind
+ * code generators write: long identifiers, deep indentation, a comment
+ * on most declarations, and plenty of string literals.
+ *
+ * Build from the src directory, after building dmd (for id.c), with:
+ *      g++ -O2 -DMARS=1 -DTARGET_LINUX=1 -I. -Iroot test/LexerBench.cpp \
+ *          lexer.c identifier.c id.c utf.c entity.c root/stringtable.c \
+ *          root/rmem.c root/root.c root/array.c root/port.c root/thread.c \
+ *          root/response.c -lpthread -o lexbench
+ * Run:
+ *      ./lexbench [lines]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "root.h"
+#include "mars.h"
+#include "lexer.h"
+#include "id.h"
+#include "tokcache.h"
+
+/* Just enough of the rest of the compiler for the Lexer.
+ */
+
+Global global;
+
+Global::Global()
+{
+}
+
+char *Loc::toChars()
+{
+    return (char *)"";
+}
+
+Loc::Loc(Module *mod, unsigned linnum)
+{
+    this->linnum = linnum;
+    this->filename = NULL;
+}
+
+void verror(Loc loc, const char *format, va_list ap, const char *p1, const char *p2, const char *header)
+{
+    global.errors++;
+}
+
+void vdeprecation(Loc loc, const char *format, va_list ap, const char *p1, const char *p2)
+{
+}
+
+void TokenCache::scan(Lexer *lex, Token *t)
+{
+    lex->scan(t);
+}
+
+/* Generate the source: lines kinds of lines, cycling through
+ * the kinds below.
+ */
+static void generate(OutBuffer *buf, size_t lines)
+{
+    buf->writestring("module generated;\n\n");
+    for (size_t i = 0; i < lines; i++)
+    {
+        unsigned n = (unsigned)i;
+        switch (i % 8)
+        {
+            case 0:
+                buf->printf("/* Record %u of the generated tables, from the schema\n"
+                            " * description; do not edit by hand.\n */\n", n);
+                i += 2;
+                break;
+            case 1:
+                buf->printf("struct GeneratedRecord%u\n{\n", n);
+                i++;
+                break;
+            case 2:
+                buf->printf("    immutable(char)[] fieldNameForColumn%u = \"column_%u_description_text\";\n", n, n);
+                break;
+            case 3:
+                buf->printf("    // The value of column %u, as read from the input stream\n", n);
+                break;
+            case 4:
+                buf->printf("    long valueOfColumnNumber%u = 0x%xL + defaultValueOffset * %u;\n", n, n, n & 63);
+                break;
+            case 5:
+                buf->printf("    void setColumn%u(long newValue) { valueOfColumnNumber%u = newValue; }\n", n, n - 1);
+                break;
+            case 6:
+                buf->printf("    string describeColumn%u() { return \"Column %u holds \" ~ fieldNameForColumn%u; }\n", n, n, n - 4);
+                break;
+            case 7:
+                buf->writestring("}\n\n");
+                i++;
+                break;
+        }
+    }
+    buf->writeByte(0);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t lines = 400000;
+    if (argc > 1)
+        lines = strtoul(argv[1], NULL, 10);
+
+    Lexer::initKeywords();
+    Id::initialize();
+
+    OutBuffer buf;
+    generate(&buf, lines);
+    size_t length = buf.offset - 1;
+
+    double best = 1e9;
+    size_t ntokens = 0;
+    for (int run = 0; run < 5; run++)
+    {
+        Lexer lex(NULL, buf.data, 0, length, 0, 0);
+        ntokens = 0;
+        clock_t start = clock();
+        while (lex.nextToken() != TOKeof)
+            ntokens++;
+        double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (secs < best)
+            best = secs;
+    }
+    printf("lex:    %u lines, %u bytes, %u tokens, %.3f secs, %.1f MB/sec\n",
+        (unsigned)lines, (unsigned)length, (unsigned)ntokens, best,
+        length / best / 1e6);
+    return global.errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
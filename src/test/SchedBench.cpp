@@ -0,0 +1,150 @@
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+/* Benchmark of the code the instruction schedulers produce, over the
+ * kernels in SchedBench.d. Each kernel is timed as the minimum over a
+ * number of rounds of the processor time clock() reports, which is
+ * what stays put from run to run on a busy machine.
+ *
+ * Build from the src directory, once for each scheduler, with:
+ *      dmd -O -release -inline -c test/SchedBench.d -oftest/sched.o
+ *      g++ -O2 test/SchedBench.cpp test/sched.o -o schedbench
+ * adding -mcpu=modern (or pentiumpro) to the dmd command line for the
+ * scheduler being measured, and -no-pie to the g++ one where it makes
+ * position independent executables by default.
+ * Run:
+ *      ./schedbench [rounds]
+ * The first line is the kernels' results: it must be the same for
+ * every scheduler. Compare the times of two builds run one after the
+ * other, more than once: a few percent either way is noise.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+struct S { int32_t a; int64_t b; double c; };
+
+extern "C"
+{
+double dot(double *a, double *b, size_t n);
+void nbody(double *x, double *y, double *z, double *vx, double *vy, double *vz,
+        double *m, size_t n, double dt);
+void matmul(double *c, double *a, double *b, size_t n);
+float mandel(int w, int h, int maxit);
+uint64_t mix(uint64_t *p, size_t n);
+int sieve(unsigned char *flags, int n);
+uint32_t crc32(unsigned char *p, size_t n);
+int collatz(int n);
+void isort(int *a, size_t n);
+int fsm(char *s, size_t n);
+int64_t divs(int64_t *p, size_t n, int64_t d);
+long double rsum(long double *p, size_t n);
+double structs(S *p, size_t n);
+int fib(int n);
+int64_t manyargs(int64_t a, int64_t b, int64_t c, int64_t d, int64_t e,
+        int64_t f, int64_t g, int64_t h, double x, double y);
+
+/* What the kernels refer to from druntime.
+ */
+
+void *_Dmodule_ref;
+void *_D15TypeInfo_Struct6__vtblZ[32];
+void _d_dso_registry(void *p) { }
+}
+
+#define N       100000
+
+static double a[N], b[N];
+static uint64_t u[N];
+static int64_t l[N];
+static long double ld[N];
+static char s[N];
+static unsigned char flags[1000000];
+static S st[N];
+static int ia[5000];
+static double body[7][600];
+static double mc[120 * 120];
+
+static double best[16];
+static const char *names[16];
+
+/* Run expr, keeping the shortest time for the k'th kernel.
+ */
+#define TIME(k, name, expr)                                             \
+    do {                                                                \
+        clock_t start = clock();                                        \
+        expr;                                                           \
+        double ms = (double)(clock() - start) / CLOCKS_PER_SEC * 1e3;   \
+        if (round == 0 || ms < best[k])                                 \
+            best[k] = ms;                                               \
+        names[k] = name;                                                \
+    } while (0)
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 15;
+
+    srand(1);
+    for (size_t i = 0; i < N; i++)
+    {
+        a[i] = rand() / 1e6;
+        b[i] = rand() / 1e7;
+        u[i] = (uint64_t)rand() << 32 ^ rand();
+        l[i] = rand() - RAND_MAX / 2;
+        ld[i] = rand() / 1e5;
+        s[i] = " abcxyz0129.,"[rand() % 13];
+        st[i].a = rand() % 100;
+        st[i].b = rand() % 1000;
+        st[i].c = rand() / 1e9;
+    }
+    for (int j = 0; j < 7; j++)
+    {
+        for (size_t i = 0; i < 600; i++)
+            body[j][i] = rand() / 1e9 + j;
+    }
+
+    double r_dot = 0, r_nb = 0, r_mm = 0, r_st = 0;
+    float r_md = 0;
+    uint64_t r_mix = 0;
+    int r_sv = 0, r_col = 0, r_fsm = 0, r_fib = 0;
+    uint32_t r_crc = 0;
+    int64_t r_is = 0, r_div = 0, r_ma = 0;
+    long double r_rs = 0;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        TIME(0, "dot", r_dot += dot(a, b, N));
+        TIME(1, "nbody", nbody(body[0], body[1], body[2], body[3], body[4], body[5], body[6], 600, 0.01));
+        r_nb += body[3][7] + body[4][9] + body[5][11];
+        TIME(2, "matmul", matmul(mc, a, b, 120));
+        r_mm += mc[17] + mc[120 * 120 - 1];
+        TIME(3, "mandel", r_md += mandel(200, 100, 200));
+        TIME(4, "mix", r_mix ^= mix(u, N));
+        TIME(5, "sieve", r_sv += sieve(flags, 1000000));
+        TIME(6, "crc32", r_crc ^= crc32((unsigned char *)s, N));
+        TIME(7, "collatz", r_col += collatz(30000));
+        memcpy(ia, u, sizeof(ia));
+        TIME(8, "isort", isort(ia, 5000));
+        r_is += ia[0] + ia[2500] + ia[4999];
+        TIME(9, "fsm", r_fsm += fsm(s, N));
+        TIME(10, "divs", r_div += divs(l, N, 7));
+        TIME(11, "rsum", r_rs += rsum(ld, N));
+        TIME(12, "structs", r_st += structs(st, N));
+        TIME(13, "fib", r_fib += fib(25));
+        TIME(14, "manyargs", r_ma += manyargs(100000, 3, 5, 7, 11, 13, 17, 19, 0.5, 0.25));
+    }
+
+    printf("%.17g %.17g %.17g %.9g %llu %d %u %d %lld %d %lld %.17Lg %.17g %d %lld\n",
+        r_dot, r_nb, r_mm, r_md, (unsigned long long)r_mix, r_sv, r_crc, r_col,
+        (long long)r_is, r_fsm, (long long)r_div, r_rs, r_st, r_fib, (long long)r_ma);
+    for (int k = 0; k < 15; k++)
+        printf("%-9s %8.3f ms\n", names[k], best[k]);
+    return 0;
+}
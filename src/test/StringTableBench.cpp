@@ -0,0 +1,104 @@
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+/* Micro-benchmark for StringTable, driving it the way
+ * Lexer::idPool() and Type::merge() do.
+ *
+ * Build from the src directory with:
+ *      g++ -O2 -Iroot test/StringTableBench.cpp root/stringtable.c root/rmem.c -o stbench
+ * Run:
+ *      ./stbench [count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "root.h"
+#include "stringtable.h"
+
+/* Identifiers: a small set of very common ones (as in any D source)
+ * mixed in with a large number of unique ones, as in generated code.
+ */
+static void benchIdPool(size_t count)
+{
+    static const char *common[] =
+    {   "i", "j", "n", "length", "ptr", "opCall", "this", "value",
+        "result", "T", "size_t", "string", "writeln", "std", "core",
+    };
+    const size_t ncommon = sizeof(common) / sizeof(common[0]);
+
+    StringTable tab;
+    tab.init(6151);                     // as Lexer::initKeywords()
+
+    char buf[32];
+    size_t hits = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *s;
+        if (i & 3)
+            s = common[i % ncommon];
+        else
+        {   sprintf(buf, "_identifier%u", (unsigned)(i / 4));
+            s = buf;
+        }
+        StringValue *sv = tab.update(s, strlen(s));
+        if (sv->ptrvalue)
+            hits++;
+        else
+            sv->ptrvalue = sv;          // stand in for the Identifier
+    }
+    clock_t end = clock();
+    double secs = (double)(end - start) / CLOCKS_PER_SEC;
+    printf("idPool: %u lookups, %u new, %.3f secs, %.1f M/sec\n",
+        (unsigned)count, (unsigned)(count - hits), secs, count / secs / 1e6);
+}
+
+/* Decos: long strings sharing prefixes, most of them looked up
+ * many times, as Type::merge() does for every type it sees.
+ */
+static void benchMerge(size_t count)
+{
+    StringTable tab;
+    tab.init(1543);                     // as Type::init()
+
+    char buf[128];
+    size_t hits = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned n = (unsigned)(i % (count / 8 + 1));
+        switch (i % 4)
+        {
+            case 0: sprintf(buf, "S3std9container5Array%u", n); break;
+            case 1: sprintf(buf, "PxS3std9container5Array%u", n); break;
+            case 2: sprintf(buf, "AyaS4core4time8Duration%u", n); break;
+            case 3: sprintf(buf, "FNaNbNfKS3std5range%uZv", n); break;
+        }
+        StringValue *sv = tab.update(buf, strlen(buf));
+        if (sv->ptrvalue)
+            hits++;
+        else
+            sv->ptrvalue = sv;          // stand in for the Type
+    }
+    clock_t end = clock();
+    double secs = (double)(end - start) / CLOCKS_PER_SEC;
+    printf("merge:  %u lookups, %u new, %.3f secs, %.1f M/sec\n",
+        (unsigned)count, (unsigned)(count - hits), secs, count / secs / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = 4000000;
+    if (argc > 1)
+        count = strtoul(argv[1], NULL, 10);
+    benchIdPool(count);
+    benchMerge(count);
+    return 0;
+}
@@ -0,0 +1,205 @@
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+/* Benchmark of the bit vector package used by the global optimizer,
+ * against the plain word loops it used to have, at the sizes the data
+ * flow problems use. The results are checked against the word loops.
+ *
+ * Build from the src directory with:
+ *      g++ -O2 -Itk test/VecBench.cpp tk/vec.c -o vecbench
+ * Run:
+ *      ./vecbench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vec.h"
+
+/* Just enough of the mem package for vec.c.
+ */
+
+void *mem_calloc(size_t n)
+{
+    return calloc(n, 1);
+}
+
+void mem_free(void *p)
+{
+    free(p);
+}
+
+/* The word loops vec.c had before, out of line like vec.c's functions.
+ */
+
+#if __GNUC__
+#define NOINLINE        __attribute__((noinline))
+#else
+#define NOINLINE
+#endif
+
+NOINLINE static void word_orass(vec_t v1, vec_t v2)
+{
+    vec_t vtop = &v1[vec_dim(v1)];
+    for (; v1 < vtop; v1++,v2++)
+        *v1 |= *v2;
+}
+
+NOINLINE static void word_sub(vec_t v1, vec_t v2, vec_t v3)
+{
+    vec_t vtop = &v1[vec_dim(v1)];
+    for (; v1 < vtop; v1++,v2++,v3++)
+        *v1 = *v2 & ~*v3;
+}
+
+NOINLINE static size_t word_index(size_t b, vec_t vec)
+{
+    vec_t v = vec;
+    if (b < vec_numbits(v))
+    {   vec_t vtop = &vec[vec_dim(v)];
+        size_t bit = b & VECMASK;
+        if (bit != b)
+            v += b >> VECSHIFT;
+        size_t starv = *v >> bit;
+        while (1)
+        {
+            while (starv)
+            {   if (starv & 1)
+                    return b;
+                b++;
+                starv >>= 1;
+            }
+            b = (b + VECBITS) & ~VECMASK;
+            if (++v >= vtop)
+                break;
+            starv = *v;
+        }
+    }
+    return vec_numbits(vec);
+}
+
+/* The transfer function as gflow.c computed it, into a scratch vector.
+ */
+NOINLINE static int word_transfer(vec_t out, vec_t in, vec_t kill, vec_t gen, vec_t tmp)
+{
+    word_sub(tmp, in, kill);
+    word_orass(tmp, gen);
+    if (!memcmp(tmp, out, vec_dim(out) * sizeof(vec_base_t)))
+        return 0;
+    memcpy(out, tmp, vec_dim(out) * sizeof(vec_base_t));
+    return 1;
+}
+
+static vec_t random_vec(size_t numbits, unsigned density)
+{
+    vec_t v = vec_calloc(numbits);
+    for (size_t i = 0; i < numbits; i++)
+        if (rand() % density == 0)
+            vec_setbit(i, v);
+    return v;
+}
+
+static double nsecs(clock_t start, size_t n)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / n;
+}
+
+static int failed;
+
+static void check(int ok, const char *what, size_t numbits)
+{
+    if (!ok)
+    {   printf("FAILED: %s, %u bits\n", what, (unsigned)numbits);
+        failed = 1;
+    }
+}
+
+static void bench(size_t numbits, size_t iterations)
+{
+    vec_t in = random_vec(numbits, 2);
+    vec_t kill = random_vec(numbits, 4);
+    vec_t gen = random_vec(numbits, 8);
+    vec_t a = vec_calloc(numbits);
+    vec_t b = vec_calloc(numbits);
+    vec_t tmp = vec_calloc(numbits);
+    size_t n = iterations / (vec_dim(in) + 4);
+    clock_t start;
+
+    // Correctness
+    word_sub(a, in, kill);
+    word_orass(a, gen);
+    vec_sub(b, in, kill);
+    vec_orass(b, gen);
+    check(vec_equal(a, b), "vec_sub/vec_orass", numbits);
+    vec_clear(b);
+    check(vec_subor(b, in, kill, gen) == (vec_index(0, a) < numbits) && vec_equal(a, b), "vec_subor", numbits);
+    check(vec_subor(b, in, kill, gen) == 0, "vec_subor unchanged", numbits);
+    for (size_t i = 0; i <= numbits; i++)
+        check(vec_index(i, gen) == word_index(i, gen), "vec_index", numbits);
+
+    start = clock();
+    for (size_t i = 0; i < n; i++)
+        word_orass(a, gen);
+    double word_or = nsecs(start, n);
+    start = clock();
+    for (size_t i = 0; i < n; i++)
+        vec_orass(b, gen);
+    double vec_or = nsecs(start, n);
+
+    start = clock();
+    for (size_t i = 0; i < n; i++)
+    {   word_transfer(a, in, kill, gen, tmp);
+        a[0] ^= 1;
+    }
+    double word_tr = nsecs(start, n);
+    start = clock();
+    for (size_t i = 0; i < n; i++)
+    {   vec_subor(b, in, kill, gen);
+        b[0] ^= 1;
+    }
+    double vec_tr = nsecs(start, n);
+
+    size_t sum = 0;
+    size_t nf = n / 8 + 1;
+    start = clock();
+    for (size_t k = 0; k < nf; k++)
+        for (size_t i = 0; (i = word_index(i, gen)) < numbits; i++)
+            sum += i;
+    double word_fe = nsecs(start, nf);
+    start = clock();
+    for (size_t k = 0; k < nf; k++)
+    {   size_t i;
+        foreach (i, numbits, gen)
+            sum -= i;
+    }
+    double vec_fe = nsecs(start, nf);
+    check(sum == 0, "foreach", numbits);
+
+    printf("%5u bits: orass %6.1f -> %6.1f ns, transfer %6.1f -> %6.1f ns, foreach %8.1f -> %8.1f ns\n",
+        (unsigned)numbits, word_or, vec_or, word_tr, vec_tr, word_fe, vec_fe);
+
+    vec_free(in);
+    vec_free(kill);
+    vec_free(gen);
+    vec_free(a);
+    vec_free(b);
+    vec_free(tmp);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t iterations = 200000000;
+    if (argc > 1)
+        iterations = strtoul(argv[1], NULL, 10);
+
+    static const size_t sizes[] = { 50, 200, 1000, 3000, 10000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        bench(sizes[i], iterations);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
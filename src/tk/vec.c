@@ -10,6 +10,59 @@
 #include        "vec.h"
 #include        "mem.h"
 
+/* The bulk operations work on 16 bytes at a time with SSE2, and on 32
+ * bytes at a time with AVX2 when the CPU has it and the vector is long
+ * enough for it to pay.
+ */
+
+#if (__GNUC__ && (__x86_64__ || __SSE2__)) || (_MSC_VER && (_M_X64 || _M_IX86_FP >= 2))
+#define VEC_SSE2        1
+#include        <emmintrin.h>
+#endif
+
+#if VEC_SSE2 && __GNUC__ && (__GNUC__ >= 5 || __clang__)
+#define VEC_AVX2        1
+#include        <immintrin.h>
+#define VEC_AVX2_TARGET __attribute__((target("avx2")))
+#define VEC_AVX2MIN     4       // fewest words worth using AVX2 for
+
+static int vec_hasavx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static int vec_avx2 = vec_hasavx2();
+#endif
+
+/* Index of the lowest set bit in x, which must not be 0.
+ */
+
+#if _MSC_VER
+#include        <intrin.h>
+#endif
+
+static size_t vec_ctz(vec_base_t x)
+{
+#if __GNUC__
+    return sizeof(x) == sizeof(long long) ? __builtin_ctzll(x) : __builtin_ctz(x);
+#elif _MSC_VER && _M_X64
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return i;
+#elif _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return i;
+#else
+    size_t i;
+
+    for (i = 0; !(x & 1); i++)
+        x >>= 1;
+    return i;
+#endif
+}
+
 static int vec_count;           /* # of vectors allocated               */
 static int vec_initcount = 0;   /* # of times package is initialized    */
 
@@ -344,50 +397,100 @@ size_t vec_testbit(size_t b,vec_t v)
  */
 
 size_t vec_index(size_t b,vec_t vec)
-{       register size_t starv;
+{       register vec_base_t starv;
         register vec_t v,vtop;
-        size_t bit;
 
     if (!vec)
         return 0;
-    v = vec;
-    if (b < vec_numbits(v))
-    {   vtop = &vec[vec_dim(v)];
-        bit = b & VECMASK;
-        if (bit != b)                   /* if not starting in first word */
-                v += b >> VECSHIFT;
-        starv = *v >> bit;
-        while (1)
+    if (b < vec_numbits(vec))
+    {   v = vec + (b >> VECSHIFT);
+        vtop = &vec[vec_dim(vec)];
+        starv = *v & (~(vec_base_t)0 << (b & VECMASK));
+        while (!starv)
         {
-                while (starv)
-                {       if (starv & 1)
-                                return b;
-                        b++;
-                        starv >>= 1;
-                }
-                b = (b + VECBITS) & ~VECMASK;   /* round up to next word */
                 if (++v >= vtop)
-                    break;
+                    return vec_numbits(vec);
                 starv = *v;
         }
+        return ((v - vec) << VECSHIFT) + vec_ctz(starv);
     }
     return vec_numbits(vec);
 }
 
+/********************************
+ * Compute v1[i] = v2[i] op v3[i] for the dim words of the vectors,
+ * for the bulk operations below. v1 may be the same as v2.
+ *      wordop          the operation on a vec_base_t
+ *      sse2op          the operation on an __m128i
+ *      avx2op          the operation on an __m256i
+ */
+
+#define VEC_WORDLOOP(v1,v2,v3,dim,wordop)                               \
+    {   for (size_t i = 0; i < dim; i++)                                \
+            v1[i] = wordop(v2[i],v3[i]);                                \
+    }
+
+#if VEC_SSE2
+#define VEC_LOOP(v1,v2,v3,dim,wordop,sse2op)                            \
+    {   size_t i;                                                       \
+        for (i = 0; i + 16 / sizeof(vec_base_t) <= dim; i += 16 / sizeof(vec_base_t)) \
+            _mm_storeu_si128((__m128i *)(v1 + i),                       \
+                sse2op(_mm_loadu_si128((__m128i *)(v2 + i)),            \
+                       _mm_loadu_si128((__m128i *)(v3 + i))));          \
+        for (; i < dim; i++)                                            \
+            v1[i] = wordop(v2[i],v3[i]);                                \
+    }
+#else
+#define VEC_LOOP(v1,v2,v3,dim,wordop,sse2op)    VEC_WORDLOOP(v1,v2,v3,dim,wordop)
+#endif
+
+#define VEC_AND(a,b)            ((a) & (b))
+#define VEC_OR(a,b)             ((a) | (b))
+#define VEC_XOR(a,b)            ((a) ^ (b))
+#define VEC_SUB(a,b)            ((a) & ~(b))
+#define VEC_SSE2SUB(a,b)        _mm_andnot_si128(b,a)
+#define VEC_AVX2SUB(a,b)        _mm256_andnot_si256(b,a)
+
+#if VEC_AVX2
+
+#define VEC_AVX2KERNEL(name,wordop,avx2op)                              \
+VEC_AVX2_TARGET static void name(vec_t v1,vec_t v2,vec_t v3,size_t dim) \
+{   size_t i;                                                           \
+    for (i = 0; i + 32 / sizeof(vec_base_t) <= dim; i += 32 / sizeof(vec_base_t)) \
+        _mm256_storeu_si256((__m256i *)(v1 + i),                        \
+            avx2op(_mm256_loadu_si256((__m256i *)(v2 + i)),             \
+                   _mm256_loadu_si256((__m256i *)(v3 + i))));           \
+    for (; i < dim; i++)                                                \
+        v1[i] = wordop(v2[i],v3[i]);                                    \
+}
+
+VEC_AVX2KERNEL(vec_avx2and,VEC_AND,_mm256_and_si256)
+VEC_AVX2KERNEL(vec_avx2or,VEC_OR,_mm256_or_si256)
+VEC_AVX2KERNEL(vec_avx2xor,VEC_XOR,_mm256_xor_si256)
+VEC_AVX2KERNEL(vec_avx2sub,VEC_SUB,VEC_AVX2SUB)
+
+#define VEC_KERNEL(v1,v2,v3,dim,wordop,sse2op,avx2kernel)               \
+    {   if (dim >= VEC_AVX2MIN && vec_avx2)                             \
+            avx2kernel(v1,v2,v3,dim);                                   \
+        else                                                            \
+            VEC_LOOP(v1,v2,v3,dim,wordop,sse2op)                        \
+    }
+#else
+#define VEC_KERNEL(v1,v2,v3,dim,wordop,sse2op,avx2kernel)               \
+            VEC_LOOP(v1,v2,v3,dim,wordop,sse2op)
+#endif
+
 /********************************
  * Compute v1 &= v2.
  */
 
 void vec_andass(vec_t v1,vec_t v2)
-{   vec_t vtop;
-
+{
     if (v1)
     {
         assert(v2);
         assert(vec_numbits(v1)==vec_numbits(v2));
-        vtop = &v1[vec_dim(v1)];
-        for (; v1 < vtop; v1++,v2++)
-            *v1 &= *v2;
+        VEC_KERNEL(v1,v1,v2,vec_dim(v1),VEC_AND,_mm_and_si128,vec_avx2and)
     }
     else
         assert(!v2);
@@ -398,15 +501,12 @@ void vec_andass(vec_t v1,vec_t v2)
  */
 
 void vec_and(vec_t v1,vec_t v2,vec_t v3)
-{   vec_t vtop;
-
+{
     if (v1)
     {
         assert(v2 && v3);
         assert(vec_numbits(v1)==vec_numbits(v2) && vec_numbits(v1)==vec_numbits(v3));
-        vtop = &v1[vec_dim(v1)];
-        for (; v1 < vtop; v1++,v2++,v3++)
-            *v1 = *v2 & *v3;
+        VEC_KERNEL(v1,v2,v3,vec_dim(v1),VEC_AND,_mm_and_si128,vec_avx2and)
     }
     else
         assert(!v2 && !v3);
@@ -417,15 +517,12 @@ void vec_and(vec_t v1,vec_t v2,vec_t v3)
  */
 
 void vec_xorass(vec_t v1,vec_t v2)
-{   vec_t vtop;
-
+{
     if (v1)
     {
         assert(v2);
         assert(vec_numbits(v1)==vec_numbits(v2));
-        vtop = &v1[vec_dim(v1)];
-        for (; v1 < vtop; v1++,v2++)
-            *v1 ^= *v2;
+        VEC_KERNEL(v1,v1,v2,vec_dim(v1),VEC_XOR,_mm_xor_si128,vec_avx2xor)
     }
     else
         assert(!v2);
@@ -436,15 +533,12 @@ void vec_xorass(vec_t v1,vec_t v2)
  */
 
 void vec_xor(vec_t v1,vec_t v2,vec_t v3)
-{   vec_t vtop;
-
+{
     if (v1)
     {
         assert(v2 && v3);
         assert(vec_numbits(v1)==vec_numbits(v2) && vec_numbits(v1)==vec_numbits(v3));
-        vtop = &v1[vec_dim(v1)];
-        for (; v1 < vtop; v1++,v2++,v3++)
-            *v1 = *v2 ^ *v3;
+        VEC_KERNEL(v1,v2,v3,vec_dim(v1),VEC_XOR,_mm_xor_si128,vec_avx2xor)
     }
     else
         assert(!v2 && !v3);
@@ -485,8 +579,7 @@ void vec_orass(vec_t v1,vec_t v2)
         #endif
         }
 #else
-        for (; v1 < vtop; v1++,v2++)
-            *v1 |= *v2;
+        VEC_KERNEL(v1,v1,v2,vec_dim(v1),VEC_OR,_mm_or_si128,vec_avx2or)
 #endif
     }
     else
@@ -498,15 +591,12 @@ void vec_orass(vec_t v1,vec_t v2)
  */
 
 void vec_or(vec_t v1,vec_t v2,vec_t v3)
-{   vec_t vtop;
-
+{
     if (v1)
     {
         assert(v2 && v3);
         assert(vec_numbits(v1)==vec_numbits(v2) && vec_numbits(v1)==vec_numbits(v3));
-        vtop = &v1[vec_dim(v1)];
-        for (; v1 < vtop; v1++,v2++,v3++)
-                *v1 = *v2 | *v3;
+        VEC_KERNEL(v1,v2,v3,vec_dim(v1),VEC_OR,_mm_or_si128,vec_avx2or)
     }
     else
         assert(!v2 && !v3);
@@ -517,15 +607,12 @@ void vec_or(vec_t v1,vec_t v2,vec_t v3)
  */
 
 void vec_subass(vec_t v1,vec_t v2)
-{   vec_t vtop;
-
+{
     if (v1)
     {
         assert(v2);
         assert(vec_numbits(v1)==vec_numbits(v2));
-        vtop = &v1[vec_dim(v1)];
-        for (; v1 < vtop; v1++,v2++)
-            *v1 &= ~*v2;
+        VEC_KERNEL(v1,v1,v2,vec_dim(v1),VEC_SUB,VEC_SSE2SUB,vec_avx2sub)
     }
     else
         assert(!v2);
@@ -536,20 +623,85 @@ void vec_subass(vec_t v1,vec_t v2)
  */
 
 void vec_sub(vec_t v1,vec_t v2,vec_t v3)
-{   vec_t vtop;
-
+{
     if (v1)
     {
         assert(v2 && v3);
         assert(vec_numbits(v1)==vec_numbits(v2) && vec_numbits(v1)==vec_numbits(v3));
-        vtop = &v1[vec_dim(v1)];
-        for (; v1 < vtop; v1++,v2++,v3++)
-            *v1 = *v2 & ~*v3;
+        VEC_KERNEL(v1,v2,v3,vec_dim(v1),VEC_SUB,VEC_SSE2SUB,vec_avx2sub)
     }
     else
         assert(!v2 && !v3);
 }
 
+/********************************
+ * Compute v1 = (v2 - v3) | v4, the transfer function of the
+ * data flow problems.
+ * Returns:
+ *      !=0 if v1 changed
+ */
+
+#if VEC_AVX2
+VEC_AVX2_TARGET static int vec_avx2subor(vec_t v1,vec_t v2,vec_t v3,vec_t v4,size_t dim)
+{   size_t i;
+    __m256i chg = _mm256_setzero_si256();
+    vec_base_t wchg = 0;
+
+    for (i = 0; i + 32 / sizeof(vec_base_t) <= dim; i += 32 / sizeof(vec_base_t))
+    {   __m256i x = _mm256_or_si256(
+            _mm256_andnot_si256(_mm256_loadu_si256((__m256i *)(v3 + i)),
+                                _mm256_loadu_si256((__m256i *)(v2 + i))),
+            _mm256_loadu_si256((__m256i *)(v4 + i)));
+        chg = _mm256_or_si256(chg,_mm256_xor_si256(x,_mm256_loadu_si256((__m256i *)(v1 + i))));
+        _mm256_storeu_si256((__m256i *)(v1 + i),x);
+    }
+    for (; i < dim; i++)
+    {   vec_base_t x = (v2[i] & ~v3[i]) | v4[i];
+        wchg |= x ^ v1[i];
+        v1[i] = x;
+    }
+    return !_mm256_testz_si256(chg,chg) || wchg;
+}
+#endif
+
+int vec_subor(vec_t v1,vec_t v2,vec_t v3,vec_t v4)
+{   size_t i,dim;
+    vec_base_t wchg = 0;
+
+    if (!v1)
+    {   assert(!v2 && !v3 && !v4);
+        return 0;
+    }
+    assert(v2 && v3 && v4);
+    assert(vec_numbits(v1)==vec_numbits(v2) && vec_numbits(v1)==vec_numbits(v3) &&
+           vec_numbits(v1)==vec_numbits(v4));
+    dim = vec_dim(v1);
+    i = 0;
+#if VEC_AVX2
+    if (dim >= VEC_AVX2MIN && vec_avx2)
+        return vec_avx2subor(v1,v2,v3,v4,dim);
+#endif
+#if VEC_SSE2
+    __m128i chg = _mm_setzero_si128();
+    for (; i + 16 / sizeof(vec_base_t) <= dim; i += 16 / sizeof(vec_base_t))
+    {   __m128i x = _mm_or_si128(
+            _mm_andnot_si128(_mm_loadu_si128((__m128i *)(v3 + i)),
+                             _mm_loadu_si128((__m128i *)(v2 + i))),
+            _mm_loadu_si128((__m128i *)(v4 + i)));
+        chg = _mm_or_si128(chg,_mm_xor_si128(x,_mm_loadu_si128((__m128i *)(v1 + i))));
+        _mm_storeu_si128((__m128i *)(v1 + i),x);
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(chg,_mm_setzero_si128())) != 0xFFFF)
+        wchg = 1;
+#endif
+    for (; i < dim; i++)
+    {   vec_base_t x = (v2[i] & ~v3[i]) | v4[i];
+        wchg |= x ^ v1[i];
+        v1[i] = x;
+    }
+    return wchg != 0;
+}
+
 /****************
  * Clear vector.
  */
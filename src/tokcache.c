@@ -0,0 +1,371 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+// This implements the -cache=dir token cache.
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#if _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "rmem.h"
+#include "root.h"
+#include "aav.h"
+#include "thread.h"
+
+#include "mars.h"
+#include "lexer.h"
+#include "identifier.h"
+#include "module.h"
+#include "tokcache.h"
+
+/* Layout of a cache file:
+ *      TokenCacheHeader
+ *      CachedToken[ntokens]
+ *      TokenValue[nvalues]
+ *      identifier names, each 0 terminated (identsize bytes)
+ *      string literals, each as length, postfix, 0 terminated string
+ *              (stringsize bytes)
+ * It is only ever read back by the same compiler on the same machine,
+ * so no attention is paid to byte order or padding.
+ */
+
+#define TOKCACHE_MAGIC  "DTC1"
+
+struct TokenCacheHeader
+{
+    char magic[4];              // TOKCACHE_MAGIC
+    unsigned dversion;          // global.params.Dversion
+    char version[16];           // global.version
+    d_uns64 check;              // second hash of the source text
+    unsigned srclen;            // length of source text
+    unsigned ntokens;
+    unsigned nvalues;
+    unsigned nidents;
+    unsigned identsize;
+    unsigned stringsize;
+};
+
+struct CachedToken
+{
+    unsigned value;             // enum TOK
+    unsigned ptr;               // offset of the token in the source text
+    unsigned linnum;            // Lexer::loc.linnum after scanning the token
+    unsigned index;             // of identifier, value, or string literal
+};
+
+/* Value of a numeric literal, copied as is.
+ */
+union TokenValue
+{
+    d_uns64 uns64value;
+    d_float80 float80value;
+};
+
+/* Tokens with these values carry an Identifier: TOKidentifier and
+ * all the keywords.
+ */
+static unsigned char identtok[TOKMAX];
+static int identtok_inited;
+
+static void identtok_init()
+{
+    for (int v = 0; v < TOKMAX; v++)
+    {
+        Token t;
+        t.value = (enum TOK)v;
+        identtok[v] = t.isKeyword();
+    }
+    identtok[TOKidentifier] = 1;
+    identtok_inited = 1;
+}
+
+/**************************************
+ * Two 64 bit hashes of the source text, mixed with everything
+ * else the tokens depend on: FNV-1a for naming the cache file,
+ * and a multiplicative one to check it.
+ */
+
+static void tokcache_hash(unsigned char *base, size_t length,
+        d_uns64 *phash, d_uns64 *pcheck)
+{
+    d_uns64 hash = 14695981039346656037ULL;
+    d_uns64 check = length;
+    for (size_t i = 0; i < length; i++)
+    {   hash = (hash ^ base[i]) * 1099511628211ULL;
+        check = check * 31 + base[i];
+    }
+    for (const char *p = global.version; *p; p++)
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    hash = (hash ^ global.params.Dversion) * 1099511628211ULL;
+    *phash = hash;
+    *pcheck = check;
+}
+
+TokenCache::TokenCache(Module *mod, unsigned char *base, size_t length)
+{
+    this->mod = mod;
+    this->base = base;
+    this->length = length;
+
+    d_uns64 hash;
+    tokcache_hash(base, length, &hash, &check);
+    char name[16 + 4 + 1];
+    sprintf(name, "%016llx.tok", (unsigned long long)hash);
+    filename = FileName::combine(global.params.cachedir, name);
+
+    file = NULL;
+    tokens = NULL;
+    ntokens = 0;
+    next = 0;
+    idents = NULL;
+    values = NULL;
+    strings = NULL;
+
+    identmap = NULL;
+    nidents = 0;
+}
+
+/**************************************
+ * Get the token cache for the source text base[0 .. length] of mod.
+ * If it is in the cache directory, tokens will be replayed from it,
+ * otherwise they will be lexed and recorded for next time.
+ */
+
+TokenCache *TokenCache::open(Module *mod, unsigned char *base, size_t length)
+{
+    //printf("TokenCache::open(%s)\n", mod->toChars());
+    if (length >= 0xFFFFFFFF)
+        return NULL;
+
+    if (global.mutex)
+        global.mutex->lock();
+    if (!identtok_inited)
+        identtok_init();
+    if (global.mutex)
+        global.mutex->unlock();
+
+    TokenCache *tc = new TokenCache(mod, base, length);
+    if (tc->load() && global.params.verbose)
+        printf("replay    %s\t(%s)\n", mod->srcfile->toChars(), tc->filename);
+    return tc;
+}
+
+/**************************************
+ * Read the cache file, and check it is for this source text.
+ * Returns:
+ *      !=0 if tokens can be replayed from it
+ */
+
+int TokenCache::load()
+{
+    File *f = new File(filename);
+    if (f->mmread())
+    {   delete f;
+        return 0;
+    }
+
+    TokenCacheHeader *h = (TokenCacheHeader *)f->buffer;
+    if (f->len < sizeof(TokenCacheHeader) ||
+        memcmp(h->magic, TOKCACHE_MAGIC, sizeof(h->magic)) ||
+        h->dversion != global.params.Dversion ||
+        strncmp(h->version, global.version, sizeof(h->version)) ||
+        h->srclen != length ||
+        h->check != check)
+        goto Lerr;
+
+    {
+        size_t tokoffset = sizeof(TokenCacheHeader);
+        size_t valueoffset = tokoffset + h->ntokens * sizeof(CachedToken);
+        size_t identoffset = valueoffset + h->nvalues * sizeof(TokenValue);
+        size_t stringoffset = identoffset + h->identsize;
+        if (stringoffset + h->stringsize != f->len ||
+            h->ntokens == 0)
+            goto Lerr;
+
+        tokens = f->buffer + tokoffset;
+        ntokens = h->ntokens;
+        values = f->buffer + valueoffset;
+        strings = f->buffer + stringoffset;
+
+        /* Look up each identifier once, rather than once per use
+         * as the Lexer does, and with -j under one lock.
+         */
+        idents = (Identifier **)mem.malloc(h->nidents * sizeof(Identifier *));
+        const char *s = (const char *)(f->buffer + identoffset);
+        if (global.mutex)
+            global.mutex->lock();
+        for (size_t i = 0; i < h->nidents; i++)
+        {
+            idents[i] = Lexer::idPool(s);
+            s += strlen(s) + 1;
+        }
+        if (global.mutex)
+            global.mutex->unlock();
+    }
+    file = f;
+    return 1;
+
+Lerr:
+    f->freeBuffer();
+    delete f;
+    return 0;
+}
+
+/**************************************
+ * Get the next token into t, in place of lex->scan(t).
+ */
+
+void TokenCache::scan(Lexer *lex, Token *t)
+{
+    if (file)
+        replay(lex, t);
+    else
+    {   lex->scan(t);
+        record(lex, t);
+    }
+}
+
+void TokenCache::replay(Lexer *lex, Token *t)
+{
+    if (next == ntokens)
+        next--;                 // the EOF token over again
+    CachedToken *ct = (CachedToken *)tokens + next;
+    next++;
+
+    t->value = (enum TOK)ct->value;
+    t->ptr = base + ct->ptr;
+    t->blockComment = NULL;
+    t->lineComment = NULL;
+    if (identtok[t->value])
+        t->ident = idents[ct->index];
+    else if (t->value == TOKstring)
+    {
+        unsigned char *s = strings + ct->index;
+        memcpy(&t->len, s, sizeof(unsigned));
+        t->postfix = s[sizeof(unsigned)];
+        s += sizeof(unsigned) + 1;
+        t->ustring = (unsigned char *)mem.malloc(t->len + 1);
+        memcpy(t->ustring, s, t->len + 1);
+    }
+    else if (ct->index != ~0u)
+        memcpy(&t->float80value, values + ct->index * sizeof(TokenValue), sizeof(TokenValue));
+    lex->p = t->ptr;
+    lex->loc.linnum = ct->linnum;
+}
+
+void TokenCache::record(Lexer *lex, Token *t)
+{
+    CachedToken ct;
+    ct.value = t->value;
+    ct.ptr = t->ptr - base;
+    ct.linnum = lex->loc.linnum;
+    ct.index = ~0u;
+    switch (t->value)
+    {
+        case TOKint32v: case TOKuns32v:
+        case TOKint64v: case TOKuns64v:
+        case TOKfloat32v: case TOKfloat64v: case TOKfloat80v:
+        case TOKimaginary32v: case TOKimaginary64v: case TOKimaginary80v:
+        case TOKcharv: case TOKwcharv: case TOKdcharv:
+        {   TokenValue v;
+            memset(&v, 0, sizeof(v));
+            memcpy(&v, &t->float80value, sizeof(v));
+            ct.index = valuebuf.offset / sizeof(TokenValue);
+            valuebuf.write(&v, sizeof(v));
+            break;
+        }
+
+        case TOKstring:
+            ct.index = stringbuf.offset;
+            stringbuf.write(&t->len, sizeof(unsigned));
+            stringbuf.writeByte(t->postfix);
+            stringbuf.write(t->ustring, t->len + 1);
+            break;
+
+        default:
+            if (identtok[t->value])
+            {
+                Value *pv = _aaGet(&identmap, t->ident);
+                if (!*pv)
+                {   *pv = (Value)++nidents;
+                    identbuf.write(t->ident->string, t->ident->len + 1);
+                }
+                ct.index = (size_t)*pv - 1;
+            }
+            break;
+    }
+    tokbuf.write(&ct, sizeof(ct));
+}
+
+/**************************************
+ * Done with lexing. If the tokens were recorded, and they depend
+ * only on the source text, save them in the cache directory.
+ */
+
+void TokenCache::close(Lexer *lex)
+{
+    if (file)
+    {   file->freeBuffer();
+        delete file;
+        file = NULL;
+        mem.free(idents);
+        idents = NULL;
+    }
+    else if (!lex->uncacheable)
+        write();
+}
+
+void TokenCache::write()
+{
+    TokenCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TOKCACHE_MAGIC, sizeof(h.magic));
+    h.dversion = global.params.Dversion;
+    strncpy(h.version, global.version, sizeof(h.version));
+    h.check = check;
+    h.srclen = length;
+    h.ntokens = tokbuf.offset / sizeof(CachedToken);
+    h.nvalues = valuebuf.offset / sizeof(TokenValue);
+    h.nidents = nidents;
+    h.identsize = identbuf.offset;
+    h.stringsize = stringbuf.offset;
+
+    OutBuffer buf;
+    buf.reserve(sizeof(h) + tokbuf.offset + valuebuf.offset + identbuf.offset + stringbuf.offset);
+    buf.write(&h, sizeof(h));
+    buf.write(&tokbuf);
+    buf.write(&valuebuf);
+    buf.write(&identbuf);
+    buf.write(&stringbuf);
+
+    /* Other compiles may be reading or writing the same file,
+     * so write it under a unique name, then rename it into place.
+     */
+    char *tmpname = (char *)mem.malloc(strlen(filename) + 32);
+    sprintf(tmpname, "%s.%d.%p", filename, (int)getpid(), this);
+    File f(tmpname);
+    f.setbuffer(buf.data, buf.offset);
+    f.ref = 1;
+    if (f.write() == 0)
+    {
+        if (rename(tmpname, filename) != 0)
+            remove(tmpname);
+        else if (global.params.verbose)
+            printf("record    %s\t(%s)\n", mod->srcfile->toChars(), filename);
+    }
+    mem.free(tmpname);
+}
@@ -0,0 +1,74 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+#ifndef DMD_TOKCACHE_H
+#define DMD_TOKCACHE_H
+
+#ifdef __DMC__
+#pragma once
+#endif /* __DMC__ */
+
+#include "mars.h"
+
+struct Module;
+struct Lexer;
+struct Token;
+struct Identifier;
+struct File;
+struct AA;
+
+/**************************************
+ * The token stream of a source file, kept in the -cache=dir directory
+ * in a file named after the hash of the source text. A later compile of
+ * the same text replays the tokens into the Parser instead of lexing it.
+ *
+ * Only the lexing, and the looking up of each use of an identifier,
+ * are saved; the source file is still read (to find the cache file
+ * and to check it matches) and still parsed.
+ */
+
+struct TokenCache
+{
+    Module *mod;
+    unsigned char *base;        // source text being lexed
+    size_t length;              // and its length
+    d_uns64 check;              // second hash of the source text
+    char *filename;             // name of cache file
+
+    // Replaying
+    File *file;                 // the cache file, NULL if recording
+    unsigned char *tokens;      // first cached token
+    size_t ntokens;
+    size_t next;                // index of next token to replay
+    Identifier **idents;        // identifiers by index
+    unsigned char *values;      // numeric literal values
+    unsigned char *strings;     // string literal data
+
+    // Recording
+    OutBuffer tokbuf;           // cached tokens
+    OutBuffer identbuf;         // identifier names
+    OutBuffer valuebuf;         // numeric literal values
+    OutBuffer stringbuf;        // string literal data
+    AA *identmap;               // Identifier* => 1 + index in idents
+    size_t nidents;
+
+    TokenCache(Module *mod, unsigned char *base, size_t length);
+
+    static TokenCache *open(Module *mod, unsigned char *base, size_t length);
+    void scan(Lexer *lex, Token *t);
+    void close(Lexer *lex);
+
+    int load();
+    void replay(Lexer *lex, Token *t);
+    void record(Lexer *lex, Token *t);
+    void write();
+};
+
+#endif /* DMD_TOKCACHE_H */
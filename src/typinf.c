@@ -26,6 +26,7 @@
 #include "enum.h"
 #include "import.h"
 #include "aggregate.h"
+#include "server.h"
 
 #ifndef TARGET_NET
 #include "rmem.h"
@@ -164,6 +165,8 @@ Expression *Type::getTypeInfo(Scope *sc)
             }
         }
     }
+    if (global.params.server && sc && !t->builtinTypeInfo())
+        Server::use(sc, t->vtinfo);
     if (!vtinfo)
         vtinfo = t->vtinfo;     // Types aren't merged, but we can share the vtinfo's
     Expression *e = new VarExp(0, t->vtinfo);
@@ -14,6 +14,7 @@
 void unittest_speller();
 void unittest_importHint();
 void unittest_aa();
+void unittest_stringtable();
 
 void unittests()
 {
@@ -21,5 +22,6 @@ void unittests()
     unittest_speller();
     unittest_importHint();
     unittest_aa();
+    unittest_stringtable();
 #endif
 }
@@ -0,0 +1,371 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+// This implements the -vtime report and trace.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if _WIN32
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "rmem.h"
+#include "root.h"
+#include "thread.h"
+
+#include "mars.h"
+#include "module.h"
+#include "vtime.h"
+
+/* Template instances, CTFE calls and back end functions that take
+ * less than this many seconds are left out of the trace, else there'd
+ * be far too many of them.
+ */
+#define VTIME_GRANULARITY       100e-6
+
+static const char *phasenames[PHASEMAX] =
+{
+    "read", "parse", "import", "semantic", "semantic2", "semantic3",
+    "inline", "codegen", "link",
+};
+
+static int mainpid;             // process doing the timing, 0 if none
+static ThreadId mainthread;
+static double starttime;
+static FILE *tracefp;           // trace file, NULL if none
+
+static enum PHASE curphase;
+static VTimeStats phasestart;
+static VTimeStats phases[PHASEMAX];
+
+static size_t otheralloc;       // by other threads and worker processes
+static THREADLOCAL VTimeScope *current;        // innermost module scope
+
+void VTimeStats::add(VTimeStats *s)
+{
+    wall += s->wall;
+    cpu += s->cpu;
+    alloc += s->alloc;
+}
+
+/**************************************
+ * Elapsed time, in seconds, from some fixed point.
+ */
+
+double VTime::wallclock()
+{
+#if _WIN32
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / freq.QuadPart;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+#if _WIN32
+static double filetime(FILETIME *ft)
+{
+    return (((unsigned long long)ft->dwHighDateTime << 32) | ft->dwLowDateTime) * 100e-9;
+}
+#else
+static double rutime(struct rusage *ru)
+{
+    return ru->ru_utime.tv_sec + ru->ru_stime.tv_sec +
+           (ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * 1e-6;
+}
+#endif
+
+/**************************************
+ * Processor time used by the calling thread, or by the whole process
+ * and the child processes it has waited for (workers and the linker).
+ */
+
+static double cputime(bool thread)
+{
+#if _WIN32
+    FILETIME create, exit, kernel, user;
+    if (thread)
+        GetThreadTimes(GetCurrentThread(), &create, &exit, &kernel, &user);
+    else
+        GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel, &user);
+    return filetime(&kernel) + filetime(&user);
+#else
+    double t;
+    struct rusage ru;
+#if linux
+    // getrusage() only counts whole clock ticks
+    struct timespec ts;
+    clock_gettime(thread ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts);
+    t = ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    getrusage(RUSAGE_SELF, &ru);
+    t = rutime(&ru);
+#endif
+    if (!thread)
+    {   getrusage(RUSAGE_CHILDREN, &ru);
+        t += rutime(&ru);
+    }
+    return t;
+#endif
+}
+
+static void phasenow(VTimeStats *s)
+{
+    s->wall = VTime::wallclock();
+    s->cpu = cputime(false);
+    s->alloc = mem.allocated() + otheralloc;
+}
+
+static void writeString(OutBuffer *buf, const char *s)
+{
+    for (; *s; s++)
+    {   unsigned char c = *s;
+        if (c == '"' || c == '\\')
+        {   buf->writeByte('\\');
+            buf->writeByte(c);
+        }
+        else if (c < 0x20)
+            buf->printf("\\u%04x", c);
+        else
+            buf->writeByte(c);
+    }
+}
+
+/**************************************
+ * Append a complete event to the trace. Each is written and flushed
+ * in one go, so events from parse threads and from the back end's
+ * worker processes don't get mixed up.
+ */
+
+static void traceEvent(const char *cat, const char *name, const char *name2,
+        double start, VTimeStats *t, const char *end)
+{
+    OutBuffer buf;
+    buf.writestring("{\"name\":\"");
+    writeString(&buf, name);
+    if (name2)
+    {   buf.writeByte(' ');
+        writeString(&buf, name2);
+    }
+    buf.printf("\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.1f,\"dur\":%.1f,\"pid\":%d,\"tid\":%ld,\"args\":{\"alloc\":%llu}}%s\n",
+        cat, (start - starttime) * 1e6, t->wall * 1e6, (int)getpid(),
+        (long)Thread::getId(), (unsigned long long)t->alloc, end);
+
+    if (global.mutex)
+        global.mutex->lock();
+    fwrite(buf.data, 1, buf.offset, tracefp);
+    fflush(tracefp);
+    if (global.mutex)
+        global.mutex->unlock();
+}
+
+/**************************************
+ * Start timing, in phase PHASEread.
+ * Input:
+ *      tracefile       file to write the trace to, NULL if none
+ */
+
+void VTime::init(const char *tracefile)
+{
+    mainpid = getpid();
+    mainthread = Thread::getId();
+    starttime = VTime::wallclock();
+    if (tracefile)
+    {
+        /* Worker processes write to the same file, so append
+         * to it rather than each writing at its own offset.
+         */
+        FILE *fp = fopen(tracefile, "w");
+        if (fp)
+        {   fclose(fp);
+            tracefp = fopen(tracefile, "a");
+        }
+        if (!tracefp)
+            error(0, "cannot write trace file %s", tracefile);
+        else
+        {   fputs("{\"traceEvents\":[\n", tracefp);
+            fflush(tracefp);
+        }
+    }
+    curphase = PHASEread;
+    phasenow(&phasestart);
+}
+
+static void endPhase()
+{
+    VTimeStats t;
+    phasenow(&t);
+    t.wall -= phasestart.wall;
+    t.cpu -= phasestart.cpu;
+    t.alloc -= phasestart.alloc;
+    phases[curphase].add(&t);
+    if (tracefp)
+        traceEvent("phase", phasenames[curphase], NULL, phasestart.wall, &t, ",");
+}
+
+/**************************************
+ * The compile moves on to phase.
+ */
+
+void VTime::phase(enum PHASE phase)
+{
+    if (!mainpid)
+        return;
+    endPhase();
+    curphase = phase;
+    phasenow(&phasestart);
+}
+
+/**************************************
+ * Account for a module the back end did in a worker process.
+ */
+
+void VTime::addWorker(Module *m, VTimeStats *s)
+{
+    if (!m->times)
+        m->times = (VTimeStats *)mem.calloc(PHASEMAX, sizeof(VTimeStats));
+    m->times[PHASEcodegen].add(s);
+    otheralloc += s->alloc;
+}
+
+static double moduleWall(Module *m)
+{
+    double wall = 0;
+    for (int p = 0; p < PHASEMAX; p++)
+        wall += m->times[p].wall;
+    return wall;
+}
+
+static int moduleCmp(const void *p1, const void *p2)
+{
+    double w1 = moduleWall(*(Module **)p1);
+    double w2 = moduleWall(*(Module **)p2);
+    return w1 < w2 ? 1 : w1 > w2 ? -1 : 0;
+}
+
+/**************************************
+ * Done timing: print the report, and finish the trace.
+ * Only the process that started it does this.
+ */
+
+void VTime::term()
+{
+    if (mainpid != getpid())
+        return;
+    endPhase();
+    mainpid = 0;
+
+    VTimeStats total;
+    memset(&total, 0, sizeof(total));
+    printf("phase          wall ms     cpu ms   alloc KB\n");
+    for (int p = 0; p < PHASEMAX; p++)
+    {   VTimeStats *t = &phases[p];
+        printf("%-10s %11.2f %10.2f %10llu\n", phasenames[p],
+            t->wall * 1e3, t->cpu * 1e3, (unsigned long long)(t->alloc / 1024));
+        total.add(t);
+    }
+    printf("%-10s %11.2f %10.2f %10llu\n", "total",
+        total.wall * 1e3, total.cpu * 1e3, (unsigned long long)(total.alloc / 1024));
+
+    Modules modules;
+    for (size_t i = 0; i < Module::amodules.dim; i++)
+    {   Module *m = Module::amodules[i];
+        if (m->times)
+            modules.push(m);
+    }
+    qsort(modules.tdata(), modules.dim, sizeof(Module *), &moduleCmp);
+
+    printf("\n   wall ms    cpu ms  alloc KB");
+    for (int p = PHASEparse; p <= PHASEcodegen; p++)
+        printf(" %9s", phasenames[p]);
+    printf("  module\n");
+    for (size_t i = 0; i < modules.dim; i++)
+    {   Module *m = modules[i];
+        VTimeStats t;
+        memset(&t, 0, sizeof(t));
+        for (int p = 0; p < PHASEMAX; p++)
+            t.add(&m->times[p]);
+        printf("%10.2f %9.2f %9llu", t.wall * 1e3, t.cpu * 1e3,
+            (unsigned long long)(t.alloc / 1024));
+        for (int p = PHASEparse; p <= PHASEcodegen; p++)
+            printf(" %9.2f", m->times[p].wall * 1e3);
+        printf("  %s\n", m->toChars());
+    }
+    fflush(stdout);
+
+    if (tracefp)
+    {   traceEvent("phase", "compile", NULL, starttime, &total, "\n]}");
+        fclose(tracefp);
+        tracefp = NULL;
+    }
+}
+
+/**************************************
+ * Time a module pass, or a symbol.
+ */
+
+void VTimeScope::begin()
+{
+    if (m)
+    {
+        if (!m->times)
+            m->times = (VTimeStats *)mem.calloc(PHASEMAX, sizeof(VTimeStats));
+        memset(&inner, 0, sizeof(inner));
+        outer = current;
+        current = this;
+        start.cpu = cputime(true);
+    }
+    start.alloc = mem.allocated();
+    start.wall = VTime::wallclock();
+}
+
+void VTimeScope::end()
+{
+    VTimeStats t;
+    t.wall = VTime::wallclock() - start.wall;
+    t.alloc = mem.allocated() - start.alloc;
+    if (m)
+    {
+        t.cpu = cputime(true) - start.cpu;
+        current = outer;
+        if (outer)
+            outer->inner.add(&t);
+        else if (Thread::getId() != mainthread)
+        {   // Not seen by the phase totals otherwise
+            global.mutex->lock();
+            otheralloc += t.alloc;
+            global.mutex->unlock();
+        }
+
+        VTimeStats self = t;
+        self.wall -= inner.wall;
+        self.cpu -= inner.cpu;
+        self.alloc -= inner.alloc;
+        m->times[phase].add(&self);
+        if (tracefp)
+            traceEvent(cat, phasenames[phase], m->toChars(), start.wall, &t, ",");
+    }
+    else if (tracefp && t.wall >= VTIME_GRANULARITY)
+        traceEvent(cat, s->toPrettyChars(), NULL, start.wall, &t, ",");
+}
@@ -0,0 +1,111 @@
+
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// written by Walter Bright
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+#ifndef DMD_VTIME_H
+#define DMD_VTIME_H
+
+#ifdef __DMC__
+#pragma once
+#endif /* __DMC__ */
+
+#include "mars.h"
+
+struct Dsymbol;
+struct Module;
+
+/**************************************
+ * For -vtime, where the time and the memory of a compile go:
+ * by phase, by module, and in a trace of module passes, template
+ * instances, CTFE calls and back end functions that can be loaded
+ * into chrome://tracing.
+ */
+
+enum PHASE
+{
+    PHASEread,          // start reading the source files
+    PHASEparse,
+    PHASEimport,        // header generation and importAll()
+    PHASEsemantic,
+    PHASEsemantic2,
+    PHASEsemantic3,
+    PHASEinline,
+    PHASEcodegen,       // object, library and json files
+    PHASElink,
+    PHASEMAX
+};
+
+struct VTimeStats
+{
+    double wall;        // elapsed time, in seconds
+    double cpu;         // processor time, in seconds
+    size_t alloc;       // bytes allocated
+
+    void add(VTimeStats *s);
+};
+
+struct VTime
+{
+    static void init(const char *tracefile);
+    static void phase(enum PHASE phase);
+    static void term();
+    static void addWorker(Module *m, VTimeStats *s);
+    static double wallclock();
+};
+
+/**************************************
+ * Time the rest of the enclosing block, if -vtime.
+ * For a module, the time is that module's alone: modules it
+ * imports and analyzes meanwhile count towards their own times.
+ */
+
+struct VTimeScope
+{
+    const char *cat;            // trace event category
+    Dsymbol *s;                 // symbol being timed, NULL if not timing
+    Module *m;                  // or module
+    enum PHASE phase;           // and the pass over it
+    VTimeStats start;
+    VTimeStats inner;           // of nested module scopes
+    VTimeScope *outer;          // enclosing module scope on this thread
+
+    VTimeScope(const char *cat, Dsymbol *s)
+    {
+        this->m = NULL;
+        this->s = NULL;
+        if (global.params.vtime && s)
+        {   this->cat = cat;
+            this->s = s;
+            begin();
+        }
+    }
+
+    VTimeScope(Module *m, enum PHASE phase)
+    {
+        this->m = NULL;
+        this->s = NULL;
+        if (global.params.vtime)
+        {   this->cat = "module";
+            this->m = m;
+            this->phase = phase;
+            begin();
+        }
+    }
+
+    ~VTimeScope()
+    {
+        if (s || m)
+            end();
+    }
+
+    void begin();
+    void end();
+};
+
+#endif /* DMD_VTIME_H */
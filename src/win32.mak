@@ -156,11 +156,11 @@ OBJ1= mars.obj enum.obj struct.obj dsymbol.obj import.obj id.obj \
 	module.obj scope.obj dump.obj cond.obj inline.obj opover.obj \
 	entity.obj class.obj mangle.obj attrib.obj impcnvtab.obj \
 	link.obj access.obj doc.obj macro.obj hdrgen.obj delegatize.obj \
-	interpret.obj ctfeexpr.obj traits.obj aliasthis.obj \
+	interpret.obj ctfecode.obj ctfeexpr.obj traits.obj aliasthis.obj \
 	builtin.obj clone.obj libomf.obj arrayop.obj irstate.obj \
 	glue.obj msc.obj ph.obj tk.obj s2ir.obj todt.obj e2ir.obj tocsym.obj \
 	util.obj eh.obj toobj.obj toctype.obj tocvdebug.obj toir.obj \
-	json.obj unittests.obj imphint.obj argtypes.obj apply.obj \
+	json.obj tokcache.obj vtime.obj incremental.obj server.obj unittests.obj imphint.obj argtypes.obj apply.obj \
 	sideeffect.obj libmscoff.obj scanmscoff.obj \
 	intrange.obj canthrow.obj
 
@@ -180,7 +180,7 @@ GCOBJS=rmem.obj
 # Removed garbage collector (look in history)
 #GCOBJS=dmgcmem.obj bits.obj win32.obj gc.obj
 ROOTOBJS= array.obj gnuc.obj man.obj root.obj port.obj \
-	stringtable.obj response.obj async.obj speller.obj aav.obj \
+	stringtable.obj response.obj async.obj thread.obj speller.obj aav.obj \
 	$(GCOBJS)
 
 # All objects
@@ -200,10 +200,10 @@ SRCS= mars.c enum.c struct.c dsymbol.c import.c idgen.c impcnvgen.c utf.h \
 	typinf.c tocvdebug.c toelfdebug.c mars.h module.h mtype.h dsymbol.h \
 	declaration.h lexer.h expression.h statement.h doc.h doc.c \
 	macro.h macro.c hdrgen.h hdrgen.c arraytypes.h \
-	delegatize.c toir.h toir.c interpret.c ctfeexpr.c traits.c builtin.c \
+	delegatize.c toir.h toir.c interpret.c ctfecode.c ctfeexpr.c traits.c builtin.c \
 	clone.c lib.h libomf.c libelf.c libmach.c arrayop.c \
 	aliasthis.h aliasthis.c json.h json.c unittests.c imphint.c argtypes.c \
-	apply.c sideeffect.c libmscoff.c scanmscoff.c ctfe.h \
+	apply.c sideeffect.c libmscoff.c scanmscoff.c ctfe.h tokcache.h tokcache.c vtime.h vtime.c incremental.h incremental.c server.h server.c \
 	intrange.h intrange.c canthrow.c vergen.c
 
 
@@ -236,13 +236,14 @@ TKSRC= $(TK)\filespec.h $(TK)\mem.h $(TK)\list.h $(TK)\vec.h $(TKSRCC)
 
 # Root package
 ROOTSRCC=$(ROOT)\root.c $(ROOT)\array.c $(ROOT)\rmem.c $(ROOT)\stringtable.c \
-	$(ROOT)\man.c $(ROOT)\port.c $(ROOT)\async.c $(ROOT)\response.c \
+	$(ROOT)\man.c $(ROOT)\port.c $(ROOT)\async.c $(ROOT)\thread.c $(ROOT)\response.c \
 	$(ROOT)\speller.c $(ROOT)\aav.c $(ROOT)\longdouble.c $(ROOT)\dmgcmem.c
 ROOTSRC= $(ROOT)\root.h \
 	$(ROOT)\rmem.h $(ROOT)\port.h \
 	$(ROOT)\stringtable.h \
 	$(ROOT)\gnuc.h $(ROOT)\gnuc.c \
 	$(ROOT)\async.h \
+	$(ROOT)\thread.h \
 	$(ROOT)\speller.h \
 	$(ROOT)\aav.h \
 	$(ROOT)\longdouble.h \
@@ -659,6 +660,9 @@ speller.obj : $(ROOT)\speller.h $(ROOT)\speller.c
 stringtable.obj : $(ROOT)\stringtable.c
 	$(CC) -c $(CFLAGS) $(ROOT)\stringtable.c
 
+thread.obj : $(ROOT)\thread.h $(ROOT)\thread.c
+	$(CC) -c $(CFLAGS) $(ROOT)\thread.c
+
 # Root/GC -- Removed (look in history)
 #
 #bits.obj : $(ROOT)\gc\bits.h $(ROOT)\gc\bits.c
@@ -701,6 +705,7 @@ inifile.obj : $(TOTALH) inifile.c
 init.obj : $(TOTALH) init.h init.c
 inline.obj : $(TOTALH) inline.c
 interpret.obj : $(TOTALH) interpret.c declaration.h expression.h ctfe.h
+ctfecode.obj : $(TOTALH) ctfecode.c ctfe.h
 ctfexpr.obj : $(TOTALH) ctfeexpr.c ctfe.h
 intrange.obj : $(TOTALH) intrange.h intrange.c
 json.obj : $(TOTALH) json.h json.c
@@ -723,4 +728,8 @@ dsymbol.obj : $(TOTALH) identifier.h dsymbol.h dsymbol.c
 mtype.obj : $(TOTALH) mtype.h mtype.c
 utf.obj : utf.h utf.c
 template.obj : $(TOTALH) template.h template.c
+tokcache.obj : $(TOTALH) tokcache.h tokcache.c
+vtime.obj : $(TOTALH) vtime.h vtime.c
+incremental.obj : $(TOTALH) incremental.h incremental.c
+server.obj : $(TOTALH) server.h server.c
 version.obj : $(TOTALH) identifier.h dsymbol.h cond.h version.h version.c
@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+
+name=`basename $0 .sh`
+dir=${RESULTS_DIR}/runnable
+dmddir=${RESULTS_DIR}${SEP}runnable
+output_file=${dir}/${name}.sh.out
+srcdir=${dir}/${name}
+dmdsrcdir=${dmddir}${SEP}${name}
+
+die()
+{
+    cat ${output_file}
+    echo "$@"
+    rm -rf ${output_file} ${srcdir}
+    exit 1
+}
+
+rm -f ${output_file}
+rm -rf ${srcdir}
+mkdir -p ${srcdir}/src
+cp runnable/extra-files/${name}.d runnable/extra-files/${name}a.d runnable/extra-files/${name}b.d ${srcdir}
+cp runnable/extra-files/${name}c.d runnable/extra-files/${name}d.d ${srcdir}/src
+
+flags="-I${dmdsrcdir}"
+files="${dmdsrcdir}${SEP}${name}.d ${dmdsrcdir}${SEP}${name}a.d ${dmdsrcdir}${SEP}${name}b.d"
+modules="${name} ${name}a ${name}b"
+
+# Compile, checking the modules given are compiled and the others are up to date
+compile()
+{
+    $DMD -m${MODEL} -incremental -v -c -od${dmdsrcdir} ${flags} ${files} > ${output_file}
+    test $? -ne 0 &&
+        die "Error compiling"
+    for m in ${modules}; do
+        expected=uptodate
+        for c in "$@"; do
+            test $c = $m && expected=code
+        done
+        grep -q "^${expected} *${m}$" ${output_file} ||
+            die "Module ${m} should be ${expected}"
+    done
+}
+
+compile ${name} ${name}a ${name}b
+compile
+
+# Only the body of a function changes, which no other module needs
+sed -i.bak 's/x \* 2/x + x/' ${srcdir}/${name}a.d
+compile ${name}a
+
+# The body of a function another module evaluates at compile time
+sed -i.bak 's/x \* x/x \* x + 0/' ${srcdir}/${name}b.d
+compile ${name} ${name}b
+
+# The interface changes
+sed -i.bak 's/int x)/int x, int y = 0)/' ${srcdir}/${name}a.d
+compile ${name} ${name}a
+compile
+
+# Roots that import each other, where the import path can't find them
+flags=
+files="${dmdsrcdir}${SEP}src${SEP}${name}c.d ${dmdsrcdir}${SEP}src${SEP}${name}d.d"
+modules="${name}c ${name}d"
+compile ${name}c ${name}d
+compile
+
+sed -i.bak 's/\* 3/* 2 + x/' ${srcdir}/src/${name}c.d
+compile ${name}c
+
+sed -i.bak 's/return x;/return x + 0;/' ${srcdir}/src/${name}d.d
+compile ${name}d
+
+rm -rf ${srcdir}
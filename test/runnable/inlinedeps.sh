@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+
+name=`basename $0 .sh`
+dir=${RESULTS_DIR}/runnable
+dmddir=${RESULTS_DIR}${SEP}runnable
+output_file=${dir}/${name}.sh.out
+deps_file="${dmddir}${SEP}${name}.deps"
+
+die()
+{
+    cat ${output_file}
+    echo "---- deps file ----"
+    cat ${deps_file}
+    echo
+    echo "$@"
+    rm -f ${output_file} ${deps_file}
+    exit 1
+}
+
+rm -f ${output_file}
+
+$DMD -m${MODEL} -deps=${deps_file} -inline -release -noboundscheck -Irunnable -o- runnable/extra-files/${name}.d >> ${output_file}
+test $? -ne 0 &&
+    die "Error compiling"
+
+grep -q "^imports.${name}a .*imports.${name}b" ${deps_file} ||
+    die "Import in an inlined imported function should be in dependency file"
+
+echo "Dependencies file:" >> ${output_file}
+cat ${deps_file} >> ${output_file}
+echo >> ${output_file}
+
+rm ${deps_file}
@@ -0,0 +1,88 @@
+#!/usr/bin/env bash
+
+name=`basename $0 .sh`
+dir=${RESULTS_DIR}/runnable
+dmddir=${RESULTS_DIR}${SEP}runnable
+output_file=${dir}/${name}.sh.out
+srcdir=${dir}/${name}
+dmdsrcdir=${dmddir}${SEP}${name}
+socket=${srcdir}/socket
+
+flags="-m${MODEL} -v -c -od${dmdsrcdir} -I${dmdsrcdir}"
+
+die()
+{
+    kill ${server} 2> /dev/null
+    cat ${output_file}
+    echo "$@"
+    rm -rf ${output_file} ${srcdir}
+    exit 1
+}
+
+rm -f ${output_file}
+rm -rf ${srcdir}
+mkdir -p ${srcdir}
+cp runnable/extra-files/${name}.d runnable/extra-files/${name}b.d runnable/extra-files/${name}c.d ${srcdir}
+
+# With no server, the client compiles by itself
+$DMD --client=${socket} ${flags} ${dmdsrcdir}${SEP}${name}.d > ${output_file} ||
+    die "Error compiling without a server"
+
+$DMD --server=${socket} ${flags} > ${srcdir}/server.log 2>&1 &
+server=$!
+for i in `seq 50`; do
+    test -S ${socket} && break
+    sleep 0.2
+done
+test -S ${socket} ||
+    die "The server didn't start"
+ls -l ${socket} | grep -q '^srw-------' ||
+    die "Only the server's user should be able to connect"
+
+# Compile, checking whether the import had to be analyzed
+compile()
+{
+    $DMD --client=${socket} ${flags} ${dmdsrcdir}${SEP}${name}.d > ${output_file} 2>&1 ||
+        die "Error compiling"
+    if grep -q "^import *${name}b" ${output_file}; then
+        test $1 = analyzed || die "${name}b should have been analyzed already"
+    else
+        test $1 = kept || die "${name}b should have been analyzed"
+    fi
+}
+
+compile analyzed
+compile kept
+compile kept
+
+# A compile that doesn't import what was analyzed gets none of what
+# analyzing it made: its object file is the one made without the server
+$DMD --client=${socket} ${flags} ${dmdsrcdir}${SEP}${name}c.d > ${output_file} 2>&1 ||
+    die "Error compiling ${name}c"
+nm ${srcdir}/${name}c${OBJ} > ${srcdir}/served.nm
+$DMD ${flags} ${dmdsrcdir}${SEP}${name}c.d > ${output_file} 2>&1 ||
+    die "Error compiling ${name}c without the server"
+nm ${srcdir}/${name}c${OBJ} > ${srcdir}/scratch.nm
+diff ${srcdir}/scratch.nm ${srcdir}/served.nm >> ${output_file} ||
+    die "${name}c should compile as it does without the server"
+
+# A change to the import must be seen
+sed -i.bak 's/= 42/= 43/' ${srcdir}/${name}b.d
+$DMD --client=${socket} ${flags} ${dmdsrcdir}${SEP}${name}.d > ${output_file} 2>&1 &&
+    die "The change to ${name}b should have been seen"
+grep -q "static assert" ${output_file} ||
+    die "Expected the static assert to fail"
+
+# Whether the server analyzes it again before the next compile or
+# during it depends on timing
+mv ${srcdir}/${name}b.d.bak ${srcdir}/${name}b.d
+$DMD --client=${socket} ${flags} ${dmdsrcdir}${SEP}${name}.d > ${output_file} 2>&1 ||
+    die "Error compiling"
+compile kept
+
+kill ${server}
+wait ${server}
+test -e ${socket} &&
+    die "The server didn't remove its socket"
+
+rm -rf ${srcdir}
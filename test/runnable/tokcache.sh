@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+
+dir=${RESULTS_DIR}/runnable
+dmddir=${RESULTS_DIR}${SEP}runnable
+output_file=${dir}/tokcache.sh.out
+cachedir=${dmddir}${SEP}tokcache_dir
+
+die()
+{
+    cat ${output_file}
+    echo "$@"
+    rm -f ${output_file}
+    exit 1
+}
+
+rm -f ${output_file}
+rm -rf ${dir}/tokcache_dir ${dir}/tokcache_first
+
+# Compile and run, checking the tokens of each module were $1ed
+# through a .tok file in the cache
+compile()
+{
+    $DMD -m${MODEL} -Irunnable -cache=${cachedir} -v -od${dmddir} -of${dmddir}${SEP}tokcache${EXE} runnable/extra-files/tokcache.d > ${output_file}
+    test $? -ne 0 &&
+        die "Error compiling"
+    for m in extra-files.tokcache imports.tokcachea; do
+        tok=`sed -n "s/^$1 *runnable.${m}\.d	(\(.*\))$/\1/p" ${output_file}`
+        test -n "${tok}" ||
+            die "Tokens of ${m} should be $1ed"
+        test -f "${tok}" ||
+            die "Cache should hold ${tok}"
+    done
+
+    ./${dir}/tokcache >> ${output_file} ||
+        die "Error running"
+}
+
+# First compile fills the cache
+compile record
+cp -r ${dir}/tokcache_dir ${dir}/tokcache_first
+
+# The second one replays from it, and leaves it alone
+compile replay
+diff -r ${dir}/tokcache_dir ${dir}/tokcache_first > /dev/null ||
+    die "Cache should be unchanged by replaying it"
+
+rm -rf ${dir}/{tokcache${OBJ},tokcache${EXE},tokcache_dir,tokcache_first}
@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+
+name=`basename $0 .sh`
+dir=${RESULTS_DIR}/runnable
+dmddir=${RESULTS_DIR}${SEP}runnable
+output_file=${dir}/${name}.sh.out
+json_file=${dir}/${name}.templates.json
+
+die()
+{
+    cat ${output_file}
+    echo "---- templates json file ----"
+    cat ${json_file}
+    echo
+    echo "$@"
+    rm -f ${output_file} ${dir}/${name}.json ${json_file}
+    exit 1
+}
+
+rm -f ${output_file} ${dir}/${name}.json ${json_file}
+
+$DMD -m${MODEL} -vtemplates -X -Xf${dmddir}${SEP}${name}.json -o- runnable/extra-files/${name}.d >> ${output_file}
+test $? -ne 0 &&
+    die "Error compiling"
+
+# Fib!22 makes 23 instances, and reuses them 20 times
+grep -q " 23 *20 *0 .* ${name}\.Fib " ${output_file} ||
+    die "Wrong counts for Fib"
+
+# Each call of twice() fails one of the two constraints
+grep -q " 2 *0 *3 *2 *1  ${name}\.twice " ${output_file} ||
+    die "Wrong counts for the first twice"
+
+grep -q '"name" : "vtemplates.S",' ${json_file} ||
+    die "No S in templates json file"
+
+rm -f ${dir}/${name}.json ${json_file}
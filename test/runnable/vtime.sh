@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+
+name=`basename $0 .sh`
+dir=${RESULTS_DIR}/runnable
+dmddir=${RESULTS_DIR}${SEP}runnable
+output_file=${dir}/${name}.sh.out
+trace_file=${dir}/${name}.trace.json
+
+die()
+{
+    cat ${output_file}
+    echo "---- trace file ----"
+    cat ${trace_file}
+    echo
+    echo "$@"
+    rm -f ${output_file} ${trace_file}
+    exit 1
+}
+
+rm -f ${output_file} ${trace_file}
+
+$DMD -m${MODEL} -vtime=${dmddir}${SEP}${name}.trace.json -o- runnable/extra-files/${name}.d >> ${output_file}
+test $? -ne 0 &&
+    die "Error compiling"
+
+grep -q "^semantic3 " ${output_file} ||
+    die "No semantic3 phase in report"
+
+grep -q " ${name}$" ${output_file} ||
+    die "Module ${name} not in report"
+
+head -1 ${trace_file} | grep -q '^{"traceEvents":\[$' ||
+    die "Trace file does not start the event list"
+
+grep -q '"name":"semantic3 '${name}'","cat":"module"' ${trace_file} ||
+    die "No semantic3 event for module ${name} in trace file"
+
+tail -1 ${trace_file} | grep -q '^\]}$' ||
+    die "Trace file does not end the event list"
+
+rm -f ${trace_file}